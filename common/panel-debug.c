@@ -48,6 +48,7 @@ static const GDebugKey panel_debug_keys[] =
   { "display-layout", PANEL_DEBUG_DISPLAY_LAYOUT },
   { "external46", PANEL_DEBUG_EXTERNAL46 },
   { "external", PANEL_DEBUG_EXTERNAL },
+  { "launcher", PANEL_DEBUG_LAUNCHER },
   { "main", PANEL_DEBUG_MAIN },
   { "module-factory", PANEL_DEBUG_MODULE_FACTORY },
   { "module", PANEL_DEBUG_MODULE },
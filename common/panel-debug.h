@@ -36,13 +36,14 @@ typedef enum
   PANEL_DEBUG_DISPLAY_LAYOUT   = 1 << 6,
   PANEL_DEBUG_EXTERNAL         = 1 << 7,
   PANEL_DEBUG_EXTERNAL46       = 1 << 8,
-  PANEL_DEBUG_MAIN             = 1 << 9,
-  PANEL_DEBUG_MODULE           = 1 << 10,
-  PANEL_DEBUG_MODULE_FACTORY   = 1 << 11,
-  PANEL_DEBUG_POSITIONING      = 1 << 12,
-  PANEL_DEBUG_STRUTS           = 1 << 13,
-  PANEL_DEBUG_SYSTRAY          = 1 << 14,
-  PANEL_DEBUG_TASKLIST         = 1 << 15
+  PANEL_DEBUG_LAUNCHER         = 1 << 9,
+  PANEL_DEBUG_MAIN             = 1 << 10,
+  PANEL_DEBUG_MODULE           = 1 << 11,
+  PANEL_DEBUG_MODULE_FACTORY   = 1 << 12,
+  PANEL_DEBUG_POSITIONING      = 1 << 13,
+  PANEL_DEBUG_STRUTS           = 1 << 14,
+  PANEL_DEBUG_SYSTRAY          = 1 << 15,
+  PANEL_DEBUG_TASKLIST         = 1 << 16
 }
 PanelDebugFlag;
 
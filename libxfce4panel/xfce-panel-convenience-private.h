@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __XFCE_PANEL_CONVENIENCE_PRIVATE_H__
+#define __XFCE_PANEL_CONVENIENCE_PRIVATE_H__
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+/* the pixbuf cache of xfce_panel_pixbuf_from_source_at_size, used by
+ * XfcePanelImage to load images asynchronously */
+GdkPixbuf *_xfce_panel_pixbuf_cache_lookup        (const gchar  *source,
+                                                   GtkIconTheme *icon_theme,
+                                                   gint          dest_width,
+                                                   gint          dest_height,
+                                                   gboolean     *found);
+
+void       _xfce_panel_pixbuf_cache_insert        (const gchar  *source,
+                                                   GtkIconTheme *icon_theme,
+                                                   gint          dest_width,
+                                                   gint          dest_height,
+                                                   GdkPixbuf    *pixbuf);
+
+/* returns the shared pixbuf from the cache, it must not be modified */
+GdkPixbuf *_xfce_panel_pixbuf_from_source_at_size (const gchar  *source,
+                                                   GtkIconTheme *icon_theme,
+                                                   gint          dest_width,
+                                                   gint          dest_height);
+
+G_END_DECLS
+
+#endif /* !__XFCE_PANEL_CONVENIENCE_PRIVATE_H__ */
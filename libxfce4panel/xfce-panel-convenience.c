@@ -24,16 +24,51 @@
 #ifdef HAVE_MATH_H
 #include <math.h>
 #endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
 
+#include <glib/gstdio.h>
 #include <libxfce4util/libxfce4util.h>
 #include <gtk/gtk.h>
 
 #include <libxfce4panel/xfce-panel-macros.h>
 #include <libxfce4panel/xfce-panel-convenience.h>
+#include <libxfce4panel/xfce-panel-convenience-private.h>
 #include <libxfce4panel/libxfce4panel-alias.h>
 
 
 
+/* number of recently loaded pixbufs kept in the cache */
+#define PIXBUF_CACHE_SIZE (64)
+
+
+
+typedef struct
+{
+  gchar     *key;
+
+  /* NULL if nothing was found */
+  GdkPixbuf *pixbuf;
+
+  /* modification time of absolute sources */
+  gint64     mtime;
+}
+PixbufCacheEntry;
+
+
+
+/* cache of loaded pixbufs shared by all the users in this process,
+ * the key is the icon theme, size and source */
+static GHashTable *pixbuf_cache = NULL;
+static GQueue      pixbuf_cache_lru = G_QUEUE_INIT;
+static guint       pixbuf_cache_hits = 0;
+static guint       pixbuf_cache_misses = 0;
+static gboolean    pixbuf_cache_debug = FALSE;
+G_LOCK_DEFINE_STATIC (pixbuf_cache);
+
+
+
 /**
  * SECTION: convenience
  * @title: Convenience Functions
@@ -163,36 +198,86 @@ xfce_panel_get_channel_name (void)
 
 
 
-/**
- * xfce_panel_pixbuf_from_source_at_size:
- * @source: string that contains the location of an icon
- * @icon_theme: (allow-none): icon theme or %NULL to use the default icon theme
- * @dest_width: the maximum returned width of the GdkPixbuf
- * @dest_height: the maximum returned height of the GdkPixbuf
- *
- * Try to load a pixbuf from a source string. The source could be
- * an abolute path, an icon name or a filename that points to a
- * file in the pixmaps directory.
- *
- * This function is particularly usefull for loading names from
- * the Icon key of desktop files.
- *
- * The pixbuf is never bigger than @dest_width and @dest_height.
- * If it is when loaded from the disk, the pixbuf is scaled
- * preserving the aspect ratio.
- *
- * Returns: (transfer full): a GdkPixbuf or %NULL if nothing was found. The value should
- *          be released with g_object_unref when no longer used.
- *
- * See also: XfcePanelImage
- *
- * Since: 4.10
- **/
-GdkPixbuf *
-xfce_panel_pixbuf_from_source_at_size (const gchar  *source,
-                                       GtkIconTheme *icon_theme,
-                                       gint          dest_width,
-                                       gint          dest_height)
+static void
+xfce_panel_pixbuf_cache_remove (GList *link)
+{
+  PixbufCacheEntry *entry = link->data;
+
+  g_hash_table_remove (pixbuf_cache, entry->key);
+  g_queue_delete_link (&pixbuf_cache_lru, link);
+
+  if (entry->pixbuf != NULL)
+    g_object_unref (G_OBJECT (entry->pixbuf));
+  g_free (entry->key);
+  g_slice_free (PixbufCacheEntry, entry);
+}
+
+
+
+static void
+xfce_panel_pixbuf_cache_theme_changed (GtkIconTheme *icon_theme)
+{
+  G_LOCK (pixbuf_cache);
+
+  /* the cache is small, so simply drop everything */
+  while (!g_queue_is_empty (&pixbuf_cache_lru))
+    xfce_panel_pixbuf_cache_remove (pixbuf_cache_lru.head);
+
+  if (pixbuf_cache_debug)
+    g_printerr (PACKAGE_NAME "(icons): icon theme changed, cache cleared "
+                "(%u hits, %u misses)\n", pixbuf_cache_hits, pixbuf_cache_misses);
+
+  G_UNLOCK (pixbuf_cache);
+}
+
+
+
+static void
+xfce_panel_pixbuf_cache_theme_finalized (gpointer  data,
+                                         GObject  *icon_theme)
+{
+  gchar *prefix;
+  GList *link, *next;
+
+  /* the keys contain the address of the theme, so drop its entries
+   * before another theme is allocated at the same address */
+  prefix = g_strdup_printf ("%p:", (gpointer) icon_theme);
+
+  G_LOCK (pixbuf_cache);
+
+  for (link = pixbuf_cache_lru.head; link != NULL; link = next)
+    {
+      next = link->next;
+      if (g_str_has_prefix (((PixbufCacheEntry *) link->data)->key, prefix))
+        xfce_panel_pixbuf_cache_remove (link);
+    }
+
+  G_UNLOCK (pixbuf_cache);
+
+  g_free (prefix);
+}
+
+
+
+static gint64
+xfce_panel_pixbuf_cache_mtime (const gchar *source)
+{
+  GStatBuf st;
+
+  if (!g_path_is_absolute (source)
+      || g_stat (source, &st) != 0)
+    return 0;
+
+  return st.st_mtime;
+}
+
+
+
+static GdkPixbuf *
+xfce_panel_pixbuf_load_at_size (const gchar  *source,
+                                GtkIconTheme *icon_theme,
+                                gint          dest_width,
+                                gint          dest_height)
 {
   GdkPixbuf *pixbuf = NULL;
   gchar     *p;
@@ -204,11 +289,6 @@ xfce_panel_pixbuf_from_source_at_size (const gchar  *source,
   GError    *error = NULL;
   gint       size = MIN (dest_width, dest_height);
 
-  g_return_val_if_fail (source != NULL, NULL);
-  g_return_val_if_fail (icon_theme == NULL || GTK_IS_ICON_THEME (icon_theme), NULL);
-  g_return_val_if_fail (dest_width > 0, NULL);
-  g_return_val_if_fail (dest_height > 0, NULL);
-
   if (G_UNLIKELY (g_path_is_absolute (source)))
     {
       pixbuf = gdk_pixbuf_new_from_file (source, &error);
@@ -221,9 +301,6 @@ xfce_panel_pixbuf_from_source_at_size (const gchar  *source,
     }
   else
     {
-      if (G_UNLIKELY (icon_theme == NULL))
-        icon_theme = gtk_icon_theme_get_default ();
-
       /* try to load from the icon theme */
       pixbuf = gtk_icon_theme_load_icon (icon_theme, source, size, 0, NULL);
       if (G_UNLIKELY (pixbuf == NULL))
@@ -255,9 +332,6 @@ xfce_panel_pixbuf_from_source_at_size (const gchar  *source,
 
   if (G_UNLIKELY (pixbuf == NULL))
     {
-      if (G_UNLIKELY (icon_theme == NULL))
-        icon_theme = gtk_icon_theme_get_default ();
-
       /* bit ugly as a fallback, but in most cases better then no icon */
       pixbuf = gtk_icon_theme_load_icon (icon_theme, "image-missing",
                                          size, GTK_ICON_LOOKUP_USE_BUILTIN, NULL);
@@ -293,6 +367,229 @@ xfce_panel_pixbuf_from_source_at_size (const gchar  *source,
 
 
 
+/*
+ * _xfce_panel_pixbuf_cache_lookup:
+ *
+ * Returns a new reference of the cached pixbuf, which can be %NULL for
+ * missing icons, and sets @found. Safe to call from any thread.
+ */
+GdkPixbuf *
+_xfce_panel_pixbuf_cache_lookup (const gchar  *source,
+                                 GtkIconTheme *icon_theme,
+                                 gint          dest_width,
+                                 gint          dest_height,
+                                 gboolean     *found)
+{
+  GdkPixbuf        *pixbuf = NULL;
+  gchar            *key;
+  GList            *link;
+  PixbufCacheEntry *entry;
+  const gchar      *value;
+  const GDebugKey   debug_keys[] = { { "icons", 1 } };
+
+  *found = FALSE;
+
+  G_LOCK (pixbuf_cache);
+
+  if (G_UNLIKELY (pixbuf_cache == NULL))
+    {
+      pixbuf_cache = g_hash_table_new (g_str_hash, g_str_equal);
+
+      /* print the cache statistics with PANEL_DEBUG=icons */
+      value = g_getenv ("PANEL_DEBUG");
+      if (value != NULL)
+        pixbuf_cache_debug = g_parse_debug_string (value, debug_keys,
+                                                   G_N_ELEMENTS (debug_keys)) != 0;
+    }
+
+  key = g_strdup_printf ("%p:%dx%d:%s", icon_theme, dest_width, dest_height, source);
+  link = g_hash_table_lookup (pixbuf_cache, key);
+  g_free (key);
+
+  if (link != NULL)
+    {
+      /* absolute files are reloaded when they are modified */
+      entry = link->data;
+      if (entry->mtime == xfce_panel_pixbuf_cache_mtime (source))
+        {
+          /* move to the front of the queue */
+          g_queue_unlink (&pixbuf_cache_lru, link);
+          g_queue_push_head_link (&pixbuf_cache_lru, link);
+
+          if (entry->pixbuf != NULL)
+            pixbuf = g_object_ref (G_OBJECT (entry->pixbuf));
+          *found = TRUE;
+        }
+      else
+        {
+          xfce_panel_pixbuf_cache_remove (link);
+        }
+    }
+
+  if (*found)
+    pixbuf_cache_hits++;
+  else
+    pixbuf_cache_misses++;
+
+  if (!*found && pixbuf_cache_debug)
+    g_printerr (PACKAGE_NAME "(icons): load \"%s\" at %dx%d (%u hits, %u misses)\n",
+                source, dest_width, dest_height, pixbuf_cache_hits, pixbuf_cache_misses);
+
+  G_UNLOCK (pixbuf_cache);
+
+  return pixbuf;
+}
+
+
+
+/*
+ * _xfce_panel_pixbuf_cache_insert:
+ *
+ * Remembers the result of loading @source, @pixbuf can be %NULL if
+ * nothing was found. Safe to call from any thread, but the icon theme
+ * is only watched if this is called from the main thread.
+ */
+void
+_xfce_panel_pixbuf_cache_insert (const gchar  *source,
+                                 GtkIconTheme *icon_theme,
+                                 gint          dest_width,
+                                 gint          dest_height,
+                                 GdkPixbuf    *pixbuf)
+{
+  PixbufCacheEntry *entry;
+  gchar            *key;
+
+  key = g_strdup_printf ("%p:%dx%d:%s", icon_theme, dest_width, dest_height, source);
+
+  G_LOCK (pixbuf_cache);
+
+  /* another thread might have loaded the same pixbuf meanwhile */
+  if (pixbuf_cache != NULL
+      && !g_hash_table_contains (pixbuf_cache, key))
+    {
+      /* drop the cache when the theme changes or is destroyed */
+      if (g_object_get_data (G_OBJECT (icon_theme), "xfce-panel-pixbuf-cache") == NULL)
+        {
+          g_object_set_data (G_OBJECT (icon_theme), "xfce-panel-pixbuf-cache", GINT_TO_POINTER (1));
+          g_signal_connect (G_OBJECT (icon_theme), "changed",
+              G_CALLBACK (xfce_panel_pixbuf_cache_theme_changed), NULL);
+          g_object_weak_ref (G_OBJECT (icon_theme),
+              xfce_panel_pixbuf_cache_theme_finalized, NULL);
+        }
+
+      /* also remember missing icons, so we don't search for them again */
+      entry = g_slice_new0 (PixbufCacheEntry);
+      entry->key = key;
+      entry->pixbuf = pixbuf != NULL ? g_object_ref (G_OBJECT (pixbuf)) : NULL;
+      entry->mtime = xfce_panel_pixbuf_cache_mtime (source);
+
+      g_queue_push_head (&pixbuf_cache_lru, entry);
+      g_hash_table_insert (pixbuf_cache, entry->key, pixbuf_cache_lru.head);
+
+      /* drop the least recently used pixbufs */
+      while (g_queue_get_length (&pixbuf_cache_lru) > PIXBUF_CACHE_SIZE)
+        xfce_panel_pixbuf_cache_remove (pixbuf_cache_lru.tail);
+    }
+  else
+    {
+      g_free (key);
+    }
+
+  G_UNLOCK (pixbuf_cache);
+}
+
+
+
+/*
+ * _xfce_panel_pixbuf_from_source_at_size:
+ *
+ * Same as xfce_panel_pixbuf_from_source_at_size, but returns a
+ * reference of the cached pixbuf, which must not be modified.
+ */
+GdkPixbuf *
+_xfce_panel_pixbuf_from_source_at_size (const gchar  *source,
+                                        GtkIconTheme *icon_theme,
+                                        gint          dest_width,
+                                        gint          dest_height)
+{
+  GdkPixbuf *pixbuf;
+  gboolean   found;
+
+  g_return_val_if_fail (source != NULL, NULL);
+  g_return_val_if_fail (icon_theme == NULL || GTK_IS_ICON_THEME (icon_theme), NULL);
+  g_return_val_if_fail (dest_width > 0, NULL);
+  g_return_val_if_fail (dest_height > 0, NULL);
+
+  if (G_UNLIKELY (icon_theme == NULL))
+    icon_theme = gtk_icon_theme_get_default ();
+
+  pixbuf = _xfce_panel_pixbuf_cache_lookup (source, icon_theme, dest_width, dest_height, &found);
+  if (found)
+    return pixbuf;
+
+  pixbuf = xfce_panel_pixbuf_load_at_size (source, icon_theme, dest_width, dest_height);
+  _xfce_panel_pixbuf_cache_insert (source, icon_theme, dest_width, dest_height, pixbuf);
+
+  return pixbuf;
+}
+
+
+
+/**
+ * xfce_panel_pixbuf_from_source_at_size:
+ * @source: string that contains the location of an icon
+ * @icon_theme: (allow-none): icon theme or %NULL to use the default icon theme
+ * @dest_width: the maximum returned width of the GdkPixbuf
+ * @dest_height: the maximum returned height of the GdkPixbuf
+ *
+ * Try to load a pixbuf from a source string. The source could be
+ * an abolute path, an icon name or a filename that points to a
+ * file in the pixmaps directory.
+ *
+ * This function is particularly usefull for loading names from
+ * the Icon key of desktop files.
+ *
+ * The pixbuf is never bigger than @dest_width and @dest_height.
+ * If it is when loaded from the disk, the pixbuf is scaled
+ * preserving the aspect ratio.
+ *
+ * Recently loaded pixbufs are cached until the icon theme changes,
+ * the returned pixbuf is a copy that can be modified.
+ *
+ * Returns: (transfer full): a GdkPixbuf or %NULL if nothing was found. The value should
+ *          be released with g_object_unref when no longer used.
+ *
+ * See also: XfcePanelImage
+ *
+ * Since: 4.10
+ **/
+GdkPixbuf *
+xfce_panel_pixbuf_from_source_at_size (const gchar  *source,
+                                       GtkIconTheme *icon_theme,
+                                       gint          dest_width,
+                                       gint          dest_height)
+{
+  GdkPixbuf *pixbuf;
+  GdkPixbuf *copy;
+
+  g_return_val_if_fail (source != NULL, NULL);
+  g_return_val_if_fail (icon_theme == NULL || GTK_IS_ICON_THEME (icon_theme), NULL);
+  g_return_val_if_fail (dest_width > 0, NULL);
+  g_return_val_if_fail (dest_height > 0, NULL);
+
+  pixbuf = _xfce_panel_pixbuf_from_source_at_size (source, icon_theme, dest_width, dest_height);
+  if (G_UNLIKELY (pixbuf == NULL))
+    return NULL;
+
+  /* callers can modify the pixbuf, so don't hand out the cached one */
+  copy = gdk_pixbuf_copy (pixbuf);
+  g_object_unref (G_OBJECT (pixbuf));
+
+  return copy;
+}
+
+
+
 /**
  * xfce_panel_pixbuf_from_source:
  * @source: string that contains the location of an icon
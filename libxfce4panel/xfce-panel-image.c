@@ -34,6 +34,7 @@
 #include <libxfce4panel/xfce-panel-macros.h>
 #include <libxfce4panel/xfce-panel-image.h>
 #include <libxfce4panel/xfce-panel-convenience.h>
+#include <libxfce4panel/xfce-panel-convenience-private.h>
 #include <libxfce4panel/libxfce4panel-alias.h>
 
 
@@ -78,6 +79,11 @@ struct _XfcePanelImagePrivate
   /* internal cached pixbuf (resized) */
   GdkPixbuf *cache;
 
+#if GTK_CHECK_VERSION (3, 0, 0)
+  /* the cached pixbuf for drawing at the scale factor of the widget */
+  cairo_surface_t *surface;
+#endif
+
   /* source name */
   gchar     *source;
 
@@ -93,8 +99,26 @@ struct _XfcePanelImagePrivate
 
   /* idle load timeout */
   guint      idle_load_id;
+
+#if GTK_CHECK_VERSION (3, 0, 0)
+  /* pending asynchronous load of the source */
+  GCancellable *load_cancellable;
+#endif
 };
 
+#if GTK_CHECK_VERSION (3, 0, 0)
+typedef struct
+{
+  XfcePanelImage *image;
+  GCancellable   *cancellable;
+  gchar          *source;
+  GtkIconTheme   *icon_theme;
+  gint            dest_width;
+  gint            dest_height;
+}
+XfcePanelImageLoad;
+#endif
+
 enum
 {
   PROP_0,
@@ -142,6 +166,12 @@ static void       xfce_panel_image_style_set            (GtkWidget       *widget
 #endif
 static gboolean   xfce_panel_image_load                 (gpointer         data);
 static void       xfce_panel_image_load_destroy         (gpointer         data);
+static void       xfce_panel_image_set_cache            (XfcePanelImage  *image,
+                                                         GdkPixbuf       *pixbuf);
+#if GTK_CHECK_VERSION (3, 0, 0)
+static void       xfce_panel_image_load_cancel          (XfcePanelImage  *image);
+static void       xfce_panel_image_scale_factor_changed (XfcePanelImage  *image);
+#endif
 static GdkPixbuf *xfce_panel_image_scale_pixbuf         (GdkPixbuf       *source,
                                                          gint             dest_width,
                                                          gint             dest_height);
@@ -231,6 +261,12 @@ xfce_panel_image_init (XfcePanelImage *image)
   image->priv->width = -1;
   image->priv->height = -1;
   image->priv->force_icon_sizes = FALSE;
+
+#if GTK_CHECK_VERSION (3, 0, 0)
+  /* reload the image at the new scale */
+  g_signal_connect (G_OBJECT (image), "notify::scale-factor",
+      G_CALLBACK (xfce_panel_image_scale_factor_changed), NULL);
+#endif
 }
 
 
@@ -471,17 +507,29 @@ xfce_panel_image_size_allocate (GtkWidget     *widget,
       priv->width = allocation->width;
       priv->height = allocation->height;
 
-      /* free cache */
-      xfce_panel_image_unref_null (priv->cache);
+      /* stop loading the image for the old size */
+      if (priv->idle_load_id != 0)
+        g_source_remove (priv->idle_load_id);
+#if GTK_CHECK_VERSION (3, 0, 0)
+      xfce_panel_image_load_cancel (XFCE_PANEL_IMAGE (widget));
+#endif
 
       if (priv->pixbuf == NULL)
         {
-          /* delay icon loading */
+#if !GTK_CHECK_VERSION (3, 0, 0)
+          /* free cache */
+          xfce_panel_image_set_cache (XFCE_PANEL_IMAGE (widget), NULL);
+#endif
+
+          /* delay icon loading, the old image is drawn until the new one is loaded */
           priv->idle_load_id = gdk_threads_add_idle_full (G_PRIORITY_DEFAULT_IDLE, xfce_panel_image_load,
                                                           widget, xfce_panel_image_load_destroy);
         }
       else
         {
+          /* free cache */
+          xfce_panel_image_set_cache (XFCE_PANEL_IMAGE (widget), NULL);
+
           /* directly render pixbufs */
           xfce_panel_image_load (widget);
         }
@@ -497,42 +545,42 @@ xfce_panel_image_draw (GtkWidget *widget,
 {
   XfcePanelImagePrivate *priv = XFCE_PANEL_IMAGE (widget)->priv;
   gint                   source_width, source_height;
+  gint                   pixbuf_width, pixbuf_height;
   gint                   dest_x, dest_y;
-  GdkPixbuf             *rendered = NULL;
-  GdkPixbuf             *pixbuf = priv->cache;
-  GtkStyleContext       *context;
-  GdkScreen             *screen;
-  GtkIconTheme          *icon_theme;
-  GtkIconInfo           *icon_info;
+  gdouble                scale, x_scale, y_scale;
 
-  if (G_LIKELY (pixbuf != NULL))
+  if (G_LIKELY (priv->cache != NULL))
     {
-      /* get the size of the cache pixbuf */
-      source_width = gdk_pixbuf_get_width (pixbuf);
-      source_height = gdk_pixbuf_get_height (pixbuf);
+      pixbuf_width = gdk_pixbuf_get_width (priv->cache);
+      pixbuf_height = gdk_pixbuf_get_height (priv->cache);
 
-      /* position */
-      dest_x = (priv->width - source_width) / 2;
-      dest_y = (priv->height - source_height) / 2;
-
-      context = gtk_widget_get_style_context (widget);
-
-      if (!gtk_widget_is_sensitive (widget))
+      /* convert the pixbuf once, so drawing is a plain blit */
+      if (priv->surface == NULL)
         {
-          screen = gtk_widget_get_screen (widget);
-          icon_theme = gtk_icon_theme_get_for_screen (screen);
-          icon_info = gtk_icon_info_new_for_pixbuf (icon_theme, pixbuf);
-          rendered = gtk_icon_info_load_icon (icon_info, NULL);
-
-          if (G_LIKELY (rendered != NULL))
-            pixbuf = rendered;
+          /* the pixbuf is loaded at the device size, but pixbufs that are
+           * never scaled up (small files, fixed size icons) can be smaller;
+           * draw those at their own size, as far as they fit the allocation */
+          x_scale = (gdouble) pixbuf_width / MAX (MIN (pixbuf_width, priv->width), 1);
+          y_scale = (gdouble) pixbuf_height / MAX (MIN (pixbuf_height, priv->height), 1);
+          scale = CLAMP (MAX (x_scale, y_scale), 1.0, gtk_widget_get_scale_factor (widget));
+
+          priv->surface = gdk_cairo_surface_create_from_pixbuf (priv->cache, 1,
+                                                                gtk_widget_get_window (widget));
+          cairo_surface_set_device_scale (priv->surface, scale, scale);
         }
 
-      /* draw the icon */
-      gtk_render_icon (context, cr, pixbuf, dest_x, dest_y);
+      /* get the size of the cache pixbuf in logical pixels */
+      cairo_surface_get_device_scale (priv->surface, &scale, NULL);
+      source_width = rint (pixbuf_width / scale);
+      source_height = rint (pixbuf_height / scale);
 
-      if (rendered != NULL)
-        g_object_unref (G_OBJECT (rendered));
+      /* position */
+      dest_x = (priv->width - source_width) / 2;
+      dest_y = (priv->height - source_height) / 2;
+
+      /* draw the icon, this also applies the state effects */
+      gtk_render_icon_surface (gtk_widget_get_style_context (widget), cr,
+                               priv->surface, dest_x, dest_y);
     }
 
   return FALSE;
@@ -670,6 +718,244 @@ xfce_panel_image_style_set (GtkWidget *widget,
 
 
 
+static void
+xfce_panel_image_set_cache (XfcePanelImage *image,
+                            GdkPixbuf      *pixbuf)
+{
+  XfcePanelImagePrivate *priv = image->priv;
+
+  xfce_panel_image_unref_null (priv->cache);
+  priv->cache = pixbuf;
+
+#if GTK_CHECK_VERSION (3, 0, 0)
+  /* the surface is created again on the next draw */
+  if (priv->surface != NULL)
+    {
+      cairo_surface_destroy (priv->surface);
+      priv->surface = NULL;
+    }
+#endif
+}
+
+
+
+#if GTK_CHECK_VERSION (3, 0, 0)
+static void
+xfce_panel_image_scale_factor_changed (XfcePanelImage *image)
+{
+  XfcePanelImagePrivate *priv = image->priv;
+
+  if (priv->surface != NULL)
+    {
+      cairo_surface_destroy (priv->surface);
+      priv->surface = NULL;
+    }
+
+  /* unset the size to force an update */
+  priv->width = priv->height = -1;
+  gtk_widget_queue_resize (GTK_WIDGET (image));
+}
+
+
+
+static void
+xfce_panel_image_load_free (XfcePanelImageLoad *load)
+{
+  g_object_unref (G_OBJECT (load->image));
+  g_object_unref (G_OBJECT (load->cancellable));
+  g_object_unref (G_OBJECT (load->icon_theme));
+  g_free (load->source);
+  g_slice_free (XfcePanelImageLoad, load);
+}
+
+
+
+static void
+xfce_panel_image_load_cancel (XfcePanelImage *image)
+{
+  XfcePanelImagePrivate *priv = image->priv;
+
+  if (priv->load_cancellable != NULL)
+    {
+      g_cancellable_cancel (priv->load_cancellable);
+      g_object_unref (G_OBJECT (priv->load_cancellable));
+      priv->load_cancellable = NULL;
+    }
+}
+
+
+
+static void
+xfce_panel_image_load_finish (XfcePanelImageLoad *load,
+                              GdkPixbuf          *pixbuf)
+{
+  XfcePanelImagePrivate *priv = load->image->priv;
+  GdkPixbuf             *scaled;
+
+  panel_return_if_fail (priv->load_cancellable == load->cancellable);
+
+  if (G_LIKELY (pixbuf != NULL))
+    {
+      /* icons from the theme can be bigger than requested */
+      scaled = xfce_panel_image_scale_pixbuf (pixbuf, load->dest_width, load->dest_height);
+      _xfce_panel_pixbuf_cache_insert (load->source, load->icon_theme,
+                                       load->dest_width, load->dest_height, scaled);
+    }
+  else
+    {
+      /* let the synchronous code try the fallbacks and the missing image */
+      scaled = _xfce_panel_pixbuf_from_source_at_size (load->source, load->icon_theme,
+                                                       load->dest_width, load->dest_height);
+    }
+
+  xfce_panel_image_set_cache (load->image, scaled);
+
+  g_object_unref (G_OBJECT (priv->load_cancellable));
+  priv->load_cancellable = NULL;
+
+  gtk_widget_queue_draw (GTK_WIDGET (load->image));
+}
+
+
+
+static void
+xfce_panel_image_load_thread (GTask        *task,
+                              gpointer      source_object,
+                              gpointer      task_data,
+                              GCancellable *cancellable)
+{
+  XfcePanelImageLoad *load = task_data;
+  GdkPixbuf          *pixbuf;
+  gint                width, height;
+  GError             *error = NULL;
+
+  /* decode at the destination size, but never scale up */
+  if (gdk_pixbuf_get_file_info (load->source, &width, &height) != NULL
+      && (width > load->dest_width || height > load->dest_height))
+    pixbuf = gdk_pixbuf_new_from_file_at_scale (load->source, load->dest_width,
+                                                load->dest_height, TRUE, &error);
+  else
+    pixbuf = gdk_pixbuf_new_from_file (load->source, &error);
+
+  if (G_LIKELY (pixbuf != NULL))
+    g_task_return_pointer (task, pixbuf, g_object_unref);
+  else
+    g_task_return_error (task, error);
+}
+
+
+
+static void
+xfce_panel_image_load_file_ready (GObject      *source_object,
+                                  GAsyncResult *result,
+                                  gpointer      user_data)
+{
+  XfcePanelImageLoad *load = g_task_get_task_data (G_TASK (result));
+  GdkPixbuf          *pixbuf;
+  GError             *error = NULL;
+
+  pixbuf = g_task_propagate_pointer (G_TASK (result), &error);
+  if (error != NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        xfce_panel_image_load_finish (load, NULL);
+      g_error_free (error);
+      return;
+    }
+
+  xfce_panel_image_load_finish (load, pixbuf);
+  g_object_unref (G_OBJECT (pixbuf));
+}
+
+
+
+static void
+xfce_panel_image_load_icon_ready (GObject      *source_object,
+                                  GAsyncResult *result,
+                                  gpointer      user_data)
+{
+  XfcePanelImageLoad *load = user_data;
+  GdkPixbuf          *pixbuf;
+
+  pixbuf = gtk_icon_info_load_icon_finish (GTK_ICON_INFO (source_object), result, NULL);
+
+  if (!g_cancellable_is_cancelled (load->cancellable))
+    xfce_panel_image_load_finish (load, pixbuf);
+
+  if (pixbuf != NULL)
+    g_object_unref (G_OBJECT (pixbuf));
+  xfce_panel_image_load_free (load);
+}
+
+
+
+static gboolean
+xfce_panel_image_load_async (XfcePanelImage *image,
+                             GtkIconTheme   *icon_theme,
+                             gint            dest_w,
+                             gint            dest_h)
+{
+  XfcePanelImagePrivate *priv = image->priv;
+  XfcePanelImageLoad    *load;
+  GdkPixbuf             *pixbuf;
+  gboolean               found;
+  GtkIconInfo           *icon_info;
+  GTask                 *task;
+
+  if (G_UNLIKELY (icon_theme == NULL))
+    icon_theme = gtk_icon_theme_get_default ();
+
+  /* nothing to do if the image was loaded before */
+  pixbuf = _xfce_panel_pixbuf_cache_lookup (priv->source, icon_theme, dest_w, dest_h, &found);
+  if (found)
+    {
+      xfce_panel_image_set_cache (image, pixbuf);
+      return FALSE;
+    }
+
+  load = g_slice_new0 (XfcePanelImageLoad);
+  load->image = g_object_ref (G_OBJECT (image));
+  load->source = g_strdup (priv->source);
+  load->icon_theme = g_object_ref (G_OBJECT (icon_theme));
+  load->dest_width = dest_w;
+  load->dest_height = dest_h;
+  load->cancellable = g_cancellable_new ();
+
+  priv->load_cancellable = g_object_ref (G_OBJECT (load->cancellable));
+
+  if (g_path_is_absolute (priv->source))
+    {
+      /* decoding a file is thread safe */
+      task = g_task_new (image, load->cancellable, xfce_panel_image_load_file_ready, NULL);
+      g_task_set_task_data (task, load, (GDestroyNotify) xfce_panel_image_load_free);
+      g_task_run_in_thread (task, xfce_panel_image_load_thread);
+      g_object_unref (G_OBJECT (task));
+
+      return TRUE;
+    }
+
+  /* the icon theme is not thread safe, so lookup the icon here
+   * and let gtk decode it in a thread */
+  icon_info = gtk_icon_theme_lookup_icon (icon_theme, priv->source, MIN (dest_w, dest_h), 0);
+  if (G_LIKELY (icon_info != NULL))
+    {
+      gtk_icon_info_load_icon_async (icon_info, load->cancellable,
+                                     xfce_panel_image_load_icon_ready, load);
+      g_object_unref (G_OBJECT (icon_info));
+
+      return TRUE;
+    }
+
+  /* no icon with this name, try the fallbacks */
+  xfce_panel_image_load_finish (load, NULL);
+  xfce_panel_image_load_free (load);
+
+  return FALSE;
+}
+#endif
+
+
+
 static gboolean
 xfce_panel_image_load (gpointer data)
 {
@@ -698,6 +984,12 @@ xfce_panel_image_load (gpointer data)
       dest_h = dest_w;
     }
 
+#if GTK_CHECK_VERSION (3, 0, 0)
+  /* load the image in device pixels */
+  dest_w *= gtk_widget_get_scale_factor (GTK_WIDGET (data));
+  dest_h *= gtk_widget_get_scale_factor (GTK_WIDGET (data));
+#endif
+
   if (priv->pixbuf != NULL)
     {
       /* use the pixbuf set by the user */
@@ -706,7 +998,8 @@ xfce_panel_image_load (gpointer data)
       if (G_LIKELY (pixbuf != NULL))
         {
           /* scale the icon to the correct size */
-          priv->cache = xfce_panel_image_scale_pixbuf (pixbuf, dest_w, dest_h);
+          xfce_panel_image_set_cache (XFCE_PANEL_IMAGE (data),
+              xfce_panel_image_scale_pixbuf (pixbuf, dest_w, dest_h));
           g_object_unref (G_OBJECT (pixbuf));
         }
     }
@@ -716,7 +1009,14 @@ xfce_panel_image_load (gpointer data)
       if (G_LIKELY (screen != NULL))
         icon_theme = gtk_icon_theme_get_for_screen (screen);
 
-      priv->cache = xfce_panel_pixbuf_from_source_at_size (priv->source, icon_theme, dest_w, dest_h);
+#if GTK_CHECK_VERSION (3, 0, 0)
+      /* decode and scale in a thread, unless cached */
+      if (xfce_panel_image_load_async (XFCE_PANEL_IMAGE (data), icon_theme, dest_w, dest_h))
+        return FALSE;
+#else
+      xfce_panel_image_set_cache (XFCE_PANEL_IMAGE (data),
+          _xfce_panel_pixbuf_from_source_at_size (priv->source, icon_theme, dest_w, dest_h));
+#endif
     }
 
   if (G_LIKELY (priv->cache != NULL))
@@ -958,6 +1258,10 @@ xfce_panel_image_clear (XfcePanelImage *image)
   if (priv->idle_load_id != 0)
     g_source_remove (priv->idle_load_id);
 
+#if GTK_CHECK_VERSION (3, 0, 0)
+  xfce_panel_image_load_cancel (image);
+#endif
+
   if (priv->source != NULL)
     {
      g_free (priv->source);
@@ -965,7 +1269,7 @@ xfce_panel_image_clear (XfcePanelImage *image)
     }
 
   xfce_panel_image_unref_null (priv->pixbuf);
-  xfce_panel_image_unref_null (priv->cache);
+  xfce_panel_image_set_cache (image, NULL);
 
   /* reset values */
   priv->width = -1;
@@ -0,0 +1,473 @@
+/*
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <common/panel-private.h>
+
+#include "applicationsmenu-search.h"
+
+
+
+/* lower scores are shown first */
+enum
+{
+  SEARCH_SCORE_NAME_PREFIX,
+  SEARCH_SCORE_NAME_WORD,
+  SEARCH_SCORE_WORD,
+  SEARCH_SCORE_SUBSTRING
+};
+
+typedef struct
+{
+  GarconMenuItem *item;
+
+  /* normalized and casefolded name, used to sort the results */
+  const gchar    *name;
+
+  /* all casefolded words of the item, each one prefixed with a
+   * space, the words of the name come first */
+  const gchar    *haystack;
+  gsize           name_len;
+}
+SearchItem;
+
+typedef struct
+{
+  const gchar *word;
+  guint        item;
+}
+SearchWord;
+
+typedef struct
+{
+  const SearchItem *item;
+  guint             score;
+}
+SearchResult;
+
+struct _ApplicationsMenuSearch
+{
+  /* all visible items in the menu */
+  GArray       *items;
+
+  /* words of all items, sorted for prefix lookups */
+  GArray       *words;
+
+  /* storage for the strings */
+  GStringChunk *strings;
+};
+
+
+
+static gchar *
+applications_menu_search_fold (const gchar *str)
+{
+  gchar *normalized, *casefolded;
+
+  /* the items and the query are compared in this form */
+  normalized = g_utf8_normalize (str, -1, G_NORMALIZE_ALL);
+  if (G_UNLIKELY (normalized == NULL))
+    return NULL;
+
+  casefolded = g_utf8_casefold (normalized, -1);
+  g_free (normalized);
+
+  return casefolded;
+}
+
+
+
+static void
+applications_menu_search_append_words (GString     *haystack,
+                                       const gchar *str)
+{
+  gchar       *casefolded;
+  const gchar *p;
+  gunichar     c;
+  gboolean     in_word = FALSE;
+
+  if (str == NULL || *str == '\0')
+    return;
+
+  casefolded = applications_menu_search_fold (str);
+  if (G_UNLIKELY (casefolded == NULL))
+    return;
+
+  /* split the string in alphanumeric words */
+  for (p = casefolded; *p != '\0'; p = g_utf8_next_char (p))
+    {
+      c = g_utf8_get_char (p);
+      if (g_unichar_isalnum (c))
+        {
+          if (!in_word)
+            g_string_append_c (haystack, ' ');
+          g_string_append_unichar (haystack, c);
+          in_word = TRUE;
+        }
+      else
+        {
+          in_word = FALSE;
+        }
+    }
+
+  g_free (casefolded);
+}
+
+
+
+static void
+applications_menu_search_add_item (ApplicationsMenuSearch *search,
+                                   GarconMenuItem         *item)
+{
+  SearchItem   search_item;
+  SearchWord   word;
+  GString     *haystack;
+  gchar       *name;
+  const gchar *command;
+  gchar       *exec;
+  gchar      **words;
+  guint        i;
+#if GARCON_CHECK_VERSION (0, 6, 2)
+  GList       *li;
+#endif
+
+  if (G_UNLIKELY (garcon_menu_item_get_name (item) == NULL))
+    return;
+
+  haystack = g_string_new (NULL);
+
+  /* the name goes first, so we know if a term matched the name */
+  applications_menu_search_append_words (haystack, garcon_menu_item_get_name (item));
+  search_item.name_len = haystack->len;
+
+  applications_menu_search_append_words (haystack, garcon_menu_item_get_generic_name (item));
+
+#if GARCON_CHECK_VERSION (0, 6, 2)
+  for (li = garcon_menu_item_get_keywords (item); li != NULL; li = li->next)
+    applications_menu_search_append_words (haystack, li->data);
+#endif
+
+  /* the name of the executable */
+  command = garcon_menu_item_get_command (item);
+  if (command != NULL)
+    {
+      exec = g_strndup (command, strcspn (command, " "));
+      name = g_path_get_basename (exec);
+      applications_menu_search_append_words (haystack, name);
+      g_free (name);
+      g_free (exec);
+    }
+
+  if (haystack->len > 0)
+    {
+      search_item.item = GARCON_MENU_ITEM (g_object_ref (G_OBJECT (item)));
+      search_item.haystack = g_string_chunk_insert (search->strings, haystack->str);
+
+      name = applications_menu_search_fold (garcon_menu_item_get_name (item));
+      search_item.name = g_string_chunk_insert (search->strings, name != NULL ? name : "");
+      g_free (name);
+
+      g_array_append_val (search->items, search_item);
+
+      /* add the words to the index */
+      words = g_strsplit (haystack->str + 1, " ", -1);
+      for (i = 0; words[i] != NULL; i++)
+        {
+          word.word = g_string_chunk_insert_const (search->strings, words[i]);
+          word.item = search->items->len - 1;
+          g_array_append_val (search->words, word);
+        }
+      g_strfreev (words);
+    }
+
+  g_string_free (haystack, TRUE);
+}
+
+
+
+static void
+applications_menu_search_collect (ApplicationsMenuSearch *search,
+                                  GarconMenu             *menu,
+                                  GHashTable             *desktop_ids)
+{
+  GList          *li, *items, *menus;
+  GarconMenuItem *item;
+  const gchar    *desktop_id;
+
+  items = garcon_menu_get_items (menu);
+  for (li = items; li != NULL; li = li->next)
+    {
+      item = GARCON_MENU_ITEM (li->data);
+      if (!garcon_menu_element_get_visible (GARCON_MENU_ELEMENT (item)))
+        continue;
+
+      /* items can be in multiple categories */
+      desktop_id = garcon_menu_item_get_desktop_id (item);
+      if (desktop_id == NULL || !g_hash_table_add (desktop_ids, (gpointer) desktop_id))
+        continue;
+
+      applications_menu_search_add_item (search, item);
+    }
+  g_list_free (items);
+
+  menus = garcon_menu_get_menus (menu);
+  for (li = menus; li != NULL; li = li->next)
+    if (garcon_menu_element_get_visible (GARCON_MENU_ELEMENT (li->data)))
+      applications_menu_search_collect (search, li->data, desktop_ids);
+  g_list_free (menus);
+}
+
+
+
+static gint
+applications_menu_search_word_compare (gconstpointer a,
+                                       gconstpointer b)
+{
+  const SearchWord *word_a = a;
+  const SearchWord *word_b = b;
+  gint              result;
+
+  result = strcmp (word_a->word, word_b->word);
+  if (result == 0)
+    return (gint) word_a->item - (gint) word_b->item;
+
+  return result;
+}
+
+
+
+static gint
+applications_menu_search_result_compare (gconstpointer a,
+                                         gconstpointer b)
+{
+  const SearchResult *result_a = a;
+  const SearchResult *result_b = b;
+
+  if (result_a->score != result_b->score)
+    return (gint) result_a->score - (gint) result_b->score;
+
+  return g_utf8_collate (result_a->item->name, result_b->item->name);
+}
+
+
+
+static gboolean
+applications_menu_search_match (const SearchItem  *item,
+                                gchar            **needles)
+{
+  guint i;
+
+  for (i = 0; needles[i] != NULL; i++)
+    if (strstr (item->haystack, needles[i]) == NULL)
+      return FALSE;
+
+  return TRUE;
+}
+
+
+
+/**
+ * applications_menu_search_new:
+ * @menu : a loaded #GarconMenu.
+ *
+ * Creates an index of the names, generic names, keywords and
+ * executables of all visible items in @menu. This does not touch
+ * any widgets, so it is safe to call from a thread.
+ **/
+ApplicationsMenuSearch *
+applications_menu_search_new (GarconMenu *menu)
+{
+  ApplicationsMenuSearch *search;
+  GHashTable             *desktop_ids;
+
+  panel_return_val_if_fail (GARCON_IS_MENU (menu), NULL);
+
+  search = g_slice_new0 (ApplicationsMenuSearch);
+  search->items = g_array_new (FALSE, FALSE, sizeof (SearchItem));
+  search->words = g_array_new (FALSE, FALSE, sizeof (SearchWord));
+  search->strings = g_string_chunk_new (4096);
+
+  desktop_ids = g_hash_table_new (g_str_hash, g_str_equal);
+  applications_menu_search_collect (search, menu, desktop_ids);
+  g_hash_table_destroy (desktop_ids);
+
+  g_array_sort (search->words, applications_menu_search_word_compare);
+
+  return search;
+}
+
+
+
+void
+applications_menu_search_free (ApplicationsMenuSearch *search)
+{
+  guint i;
+
+  if (search == NULL)
+    return;
+
+  for (i = 0; i < search->items->len; i++)
+    g_object_unref (G_OBJECT (g_array_index (search->items, SearchItem, i).item));
+
+  g_array_free (search->items, TRUE);
+  g_array_free (search->words, TRUE);
+  g_string_chunk_free (search->strings);
+  g_slice_free (ApplicationsMenuSearch, search);
+}
+
+
+
+/**
+ * applications_menu_search_lookup:
+ * @search      : an #ApplicationsMenuSearch.
+ * @query       : the text typed by the user.
+ * @max_results : maximum number of items to return.
+ *
+ * Every word in @query has to match the start of a word of the item.
+ * The candidates for the first word are found with a binary search in
+ * the sorted word list. If nothing matches, items that contain all the
+ * words anywhere are returned.
+ *
+ * Returns: array of #GarconMenuItem<!-- -->s owned by @search, free the
+ *          array with g_ptr_array_free().
+ **/
+GPtrArray *
+applications_menu_search_lookup (ApplicationsMenuSearch *search,
+                                 const gchar            *query,
+                                 guint                   max_results)
+{
+  GPtrArray        *results;
+  GArray           *matches;
+  GString          *terms;
+  gchar           **needles;
+  gchar            *needle;
+  guint8           *seen;
+  const SearchWord *word;
+  const SearchItem *item;
+  SearchResult      match;
+  const gchar      *first;
+  gsize             first_len;
+  guint             lower, upper, middle;
+  guint             i;
+
+  panel_return_val_if_fail (search != NULL, NULL);
+
+  results = g_ptr_array_new ();
+
+  /* split the query the same way as the items */
+  terms = g_string_new (NULL);
+  applications_menu_search_append_words (terms, query);
+  if (terms->len == 0)
+    {
+      g_string_free (terms, TRUE);
+      return results;
+    }
+
+  /* the first word is matched with the index, the others with " word"
+   * in the haystack, so they match the start of a word too */
+  needles = g_strsplit (terms->str + 1, " ", -1);
+  first = needles[0];
+  first_len = strlen (first);
+  for (i = 1; needles[i] != NULL; i++)
+    {
+      needle = g_strconcat (" ", needles[i], NULL);
+      g_free (needles[i]);
+      needles[i] = needle;
+    }
+
+  matches = g_array_new (FALSE, FALSE, sizeof (SearchResult));
+  seen = g_new0 (guint8, search->items->len);
+
+  /* find the first word that is not smaller than the term */
+  lower = 0;
+  upper = search->words->len;
+  while (lower < upper)
+    {
+      middle = lower + (upper - lower) / 2;
+      word = &g_array_index (search->words, SearchWord, middle);
+      if (strcmp (word->word, first) < 0)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  /* walk all words starting with the term */
+  for (i = lower; i < search->words->len; i++)
+    {
+      word = &g_array_index (search->words, SearchWord, i);
+      if (strncmp (word->word, first, first_len) != 0)
+        break;
+
+      if (seen[word->item])
+        continue;
+      seen[word->item] = TRUE;
+
+      item = &g_array_index (search->items, SearchItem, word->item);
+      if (!applications_menu_search_match (item, needles + 1))
+        continue;
+
+      match.item = item;
+      needle = g_strconcat (" ", first, NULL);
+      if (strncmp (item->name, first, first_len) == 0)
+        match.score = SEARCH_SCORE_NAME_PREFIX;
+      else if (g_strstr_len (item->haystack, item->name_len, needle) != NULL)
+        match.score = SEARCH_SCORE_NAME_WORD;
+      else
+        match.score = SEARCH_SCORE_WORD;
+      g_free (needle);
+
+      g_array_append_val (matches, match);
+    }
+
+  /* be less strict if nothing was found */
+  if (matches->len == 0)
+    {
+      for (i = 1; needles[i] != NULL; i++)
+        memmove (needles[i], needles[i] + 1, strlen (needles[i]));
+
+      for (i = 0; i < search->items->len; i++)
+        {
+          item = &g_array_index (search->items, SearchItem, i);
+          if (applications_menu_search_match (item, needles))
+            {
+              match.item = item;
+              match.score = SEARCH_SCORE_SUBSTRING;
+              g_array_append_val (matches, match);
+            }
+        }
+    }
+
+  g_array_sort (matches, applications_menu_search_result_compare);
+
+  for (i = 0; i < matches->len && i < max_results; i++)
+    g_ptr_array_add (results, g_array_index (matches, SearchResult, i).item->item);
+
+  g_array_free (matches, TRUE);
+  g_free (seen);
+  g_strfreev (needles);
+  g_string_free (terms, TRUE);
+
+  return results;
+}
@@ -20,6 +20,7 @@
 #include <config.h>
 #endif
 
+#include <gio/gdesktopappinfo.h>
 #include <exo/exo.h>
 #include <garcon/garcon.h>
 #include <garcon-gtk/garcon-gtk.h>
@@ -32,6 +33,7 @@
 #include <common/panel-debug.h>
 
 #include "applicationsmenu.h"
+#include "applicationsmenu-search.h"
 #include "applicationsmenu-dialog_ui.h"
 
 
@@ -40,6 +42,8 @@
 #define DEFAULT_ICON_NAME "xfce4-panel-menu"
 #define DEFAULT_ICON_SIZE (16)
 #define DEFAULT_EDITOR    "menulibre"
+#define RELOAD_DELAY      (1000)
+#define SEARCH_MAX_ITEMS  (20)
 
 
 struct _ApplicationsMenuPluginClass
@@ -59,6 +63,9 @@ struct _ApplicationsMenuPlugin
 
   guint            is_constructed : 1;
 
+  /* whether the menu is shown at the pointer */
+  guint            popup_at_pointer : 1;
+
   guint            show_button_title : 1;
   gchar           *button_title;
   gchar           *button_icon;
@@ -72,8 +79,32 @@ struct _ApplicationsMenuPlugin
 
   gulong           style_set_id;
   gulong           screen_changed_id;
+
+  /* loading the menu in a thread */
+  GCancellable    *load_cancellable;
+
+  /* loaded menu waiting for the gtk menu to be hidden */
+  gpointer         load_pending;
+  guint            load_pending_id;
+
+  /* reload the menu after desktop files changed */
+  GarconMenu      *garcon_menu;
+  gulong           reload_required_id;
+  guint            reload_timeout_id;
+
+  /* type-ahead search in the applications */
+  ApplicationsMenuSearch *search;
+  GtkWidget       *search_menu;
+  GString         *search_query;
 };
 
+typedef struct
+{
+  GarconMenu             *menu;
+  ApplicationsMenuSearch *search;
+}
+ApplicationsMenuLoad;
+
 enum
 {
   PROP_0,
@@ -113,7 +144,23 @@ static gboolean  applications_menu_plugin_menu                 (GtkWidget
                                                                 ApplicationsMenuPlugin *plugin);
 static void      applications_menu_plugin_menu_deactivate      (GtkWidget              *menu,
                                                                 GtkWidget              *button);
+static void      applications_menu_plugin_menu_hide            (ApplicationsMenuPlugin *plugin);
+static void      applications_menu_plugin_menu_map             (ApplicationsMenuPlugin *plugin);
+static gboolean  applications_menu_plugin_menu_key_press_event (GtkWidget              *menu,
+                                                                GdkEventKey            *event,
+                                                                ApplicationsMenuPlugin *plugin);
+static gboolean  applications_menu_plugin_search_key_press_event (GtkWidget              *menu,
+                                                                  GdkEventKey            *event,
+                                                                  ApplicationsMenuPlugin *plugin);
+static void      applications_menu_plugin_search_popup         (ApplicationsMenuPlugin *plugin,
+                                                                const gchar            *query,
+                                                                GdkEvent               *event);
 static void      applications_menu_plugin_set_garcon_menu      (ApplicationsMenuPlugin *plugin);
+static void      applications_menu_plugin_watch_menu           (ApplicationsMenuPlugin *plugin,
+                                                                GarconMenu             *menu);
+static void      applications_menu_plugin_load_ready           (GObject                *source_object,
+                                                                GAsyncResult           *result,
+                                                                gpointer                user_data);
 static void      applications_menu_button_theme_changed        (ApplicationsMenuPlugin *plugin);
 
 
@@ -239,6 +286,21 @@ applications_menu_plugin_init (ApplicationsMenuPlugin *plugin)
   plugin->menu = garcon_gtk_menu_new (NULL);
   g_signal_connect (G_OBJECT (plugin->menu), "selection-done",
       G_CALLBACK (applications_menu_plugin_menu_deactivate), plugin->button);
+  g_signal_connect (G_OBJECT (plugin->menu), "key-press-event",
+      G_CALLBACK (applications_menu_plugin_menu_key_press_event), plugin);
+  g_signal_connect_swapped (G_OBJECT (plugin->menu), "hide",
+      G_CALLBACK (applications_menu_plugin_menu_hide), plugin);
+  g_signal_connect_swapped (G_OBJECT (plugin->menu), "map",
+      G_CALLBACK (applications_menu_plugin_menu_map), plugin);
+
+  /* menu with the search results */
+  plugin->search_query = g_string_new (NULL);
+  plugin->search_menu = gtk_menu_new ();
+  gtk_menu_attach_to_widget (GTK_MENU (plugin->search_menu), plugin->button, NULL);
+  g_signal_connect (G_OBJECT (plugin->search_menu), "selection-done",
+      G_CALLBACK (applications_menu_plugin_menu_deactivate), plugin->button);
+  g_signal_connect (G_OBJECT (plugin->search_menu), "key-press-event",
+      G_CALLBACK (applications_menu_plugin_search_key_press_event), plugin);
 
   plugin->style_set_id = g_signal_connect_swapped (G_OBJECT (plugin->button), "style-set",
                                                    G_CALLBACK (applications_menu_button_theme_changed), plugin);
@@ -447,9 +509,33 @@ applications_menu_plugin_free_data (XfcePanelPlugin *panel_plugin)
 {
   ApplicationsMenuPlugin *plugin = XFCE_APPLICATIONS_MENU_PLUGIN (panel_plugin);
 
+  /* stop watching the menu */
+  applications_menu_plugin_watch_menu (plugin, NULL);
+  if (plugin->reload_timeout_id != 0)
+    g_source_remove (plugin->reload_timeout_id);
+
+  /* stop loading the menu */
+  if (plugin->load_cancellable != NULL)
+    {
+      g_cancellable_cancel (plugin->load_cancellable);
+      g_object_unref (G_OBJECT (plugin->load_cancellable));
+      plugin->load_cancellable = NULL;
+    }
+
   if (plugin->menu != NULL)
     gtk_widget_destroy (plugin->menu);
 
+  /* drop the menu that was not handed over yet */
+  if (plugin->load_pending_id != 0)
+    g_source_remove (plugin->load_pending_id);
+  if (plugin->load_pending != NULL)
+    applications_menu_plugin_load_free (plugin->load_pending);
+
+  if (plugin->search_menu != NULL)
+    gtk_widget_destroy (plugin->search_menu);
+  applications_menu_search_free (plugin->search);
+  g_string_free (plugin->search_query, TRUE);
+
   if (plugin->style_set_id != 0)
     {
       g_signal_handler_disconnect (plugin->button, plugin->style_set_id);
@@ -705,6 +791,15 @@ applications_menu_plugin_remote_event (XfcePanelPlugin *panel_plugin,
       && panel_utils_grab_available ())
     {
       if (value != NULL
+          && G_VALUE_HOLDS_STRING (value)
+          && plugin->search != NULL)
+        {
+          /* show the search results at the button */
+          plugin->popup_at_pointer = FALSE;
+          gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (plugin->button), TRUE);
+          applications_menu_plugin_search_popup (plugin, g_value_get_string (value), NULL);
+        }
+      else if (value != NULL
           && G_VALUE_HOLDS_BOOLEAN (value)
           && g_value_get_boolean (value))
         {
@@ -742,6 +837,282 @@ applications_menu_plugin_menu_deactivate (GtkWidget *menu,
 
 
 
+static void
+applications_menu_plugin_load_free (gpointer data)
+{
+  ApplicationsMenuLoad *load = data;
+
+  g_object_unref (G_OBJECT (load->menu));
+  applications_menu_search_free (load->search);
+  g_slice_free (ApplicationsMenuLoad, load);
+}
+
+
+
+static void
+applications_menu_plugin_load_thread (GTask        *task,
+                                      gpointer      source_object,
+                                      gpointer      task_data,
+                                      GCancellable *cancellable)
+{
+  GarconMenu           *menu = GARCON_MENU (task_data);
+  ApplicationsMenuLoad *load;
+  GError               *error = NULL;
+
+  /* parse the menu file and all the desktop files, the items end up
+   * in garcon's item cache, so loading the menu again when the gtk
+   * menu is mapped does not read them again */
+  if (garcon_menu_load (menu, cancellable, &error))
+    {
+      load = g_slice_new0 (ApplicationsMenuLoad);
+      load->menu = GARCON_MENU (g_object_ref (G_OBJECT (menu)));
+
+      /* build the search index while we're here */
+      if (!g_cancellable_is_cancelled (cancellable))
+        load->search = applications_menu_search_new (menu);
+
+      g_task_return_pointer (task, load, applications_menu_plugin_load_free);
+    }
+  else
+    {
+      g_task_return_error (task, error);
+    }
+}
+
+
+
+static void
+applications_menu_plugin_load_apply (ApplicationsMenuPlugin *plugin,
+                                     ApplicationsMenuLoad   *load)
+{
+  panel_return_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin));
+  panel_return_if_fail (GARCON_GTK_IS_MENU (plugin->menu));
+
+  /* hand over the loaded menu */
+  garcon_gtk_menu_set_menu (GARCON_GTK_MENU (plugin->menu), load->menu);
+  applications_menu_plugin_watch_menu (plugin, load->menu);
+
+  /* take the search index, the results in the search menu hold
+   * their own references on the items */
+  applications_menu_search_free (plugin->search);
+  plugin->search = load->search;
+  load->search = NULL;
+
+  applications_menu_plugin_load_free (load);
+}
+
+
+
+static gboolean
+applications_menu_plugin_load_pending_idle (gpointer user_data)
+{
+  ApplicationsMenuPlugin *plugin = XFCE_APPLICATIONS_MENU_PLUGIN (user_data);
+  ApplicationsMenuLoad   *load;
+
+  /* the menu was opened again before we got here */
+  if (gtk_widget_get_visible (plugin->menu))
+    return FALSE;
+
+  load = plugin->load_pending;
+  plugin->load_pending = NULL;
+  if (load != NULL)
+    applications_menu_plugin_load_apply (plugin, load);
+
+  return FALSE;
+}
+
+
+
+static void
+applications_menu_plugin_load_pending_idle_destroyed (gpointer user_data)
+{
+  XFCE_APPLICATIONS_MENU_PLUGIN (user_data)->load_pending_id = 0;
+}
+
+
+
+static void
+applications_menu_plugin_menu_hide (ApplicationsMenuPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin));
+
+  /* replace the menu in an idle, the activated item is
+   * only handled after the menu is hidden */
+  if (plugin->load_pending != NULL
+      && plugin->load_pending_id == 0)
+    {
+      plugin->load_pending_id =
+          gdk_threads_add_idle_full (G_PRIORITY_LOW,
+                                     applications_menu_plugin_load_pending_idle, plugin,
+                                     applications_menu_plugin_load_pending_idle_destroyed);
+    }
+}
+
+
+
+static void
+applications_menu_plugin_load_ready (GObject      *source_object,
+                                     GAsyncResult *result,
+                                     gpointer      user_data)
+{
+  ApplicationsMenuPlugin *plugin = XFCE_APPLICATIONS_MENU_PLUGIN (source_object);
+  ApplicationsMenuLoad   *load;
+  GError                 *error = NULL;
+
+  load = g_task_propagate_pointer (G_TASK (result), &error);
+  if (G_UNLIKELY (load == NULL))
+    {
+      /* the plugin is destroyed or a new menu is loading */
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to load the applications menu: %s", error->message);
+      g_error_free (error);
+
+      return;
+    }
+
+  g_object_unref (G_OBJECT (plugin->load_cancellable));
+  plugin->load_cancellable = NULL;
+
+  /* don't replace the menu under the user, this is done
+   * when the menu is hidden */
+  if (gtk_widget_get_visible (plugin->menu))
+    {
+      if (plugin->load_pending != NULL)
+        applications_menu_plugin_load_free (plugin->load_pending);
+      plugin->load_pending = load;
+
+      panel_debug (PANEL_DEBUG_APPLICATIONSMENU, "menu loaded in the background, "
+                   "waiting until it is hidden");
+
+      return;
+    }
+
+  applications_menu_plugin_load_apply (plugin, load);
+
+  panel_debug (PANEL_DEBUG_APPLICATIONSMENU, "menu loaded in the background");
+}
+
+
+
+static void
+applications_menu_plugin_load_async (ApplicationsMenuPlugin *plugin,
+                                     GarconMenu             *menu)
+{
+  GFile      *file;
+  GarconMenu *load_menu;
+  GTask      *task;
+
+  panel_return_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin));
+  panel_return_if_fail (GARCON_IS_MENU (menu));
+
+  /* abort the previous load */
+  if (plugin->load_cancellable != NULL)
+    {
+      g_cancellable_cancel (plugin->load_cancellable);
+      g_object_unref (G_OBJECT (plugin->load_cancellable));
+    }
+  plugin->load_cancellable = g_cancellable_new ();
+
+  /* a menu that is still waiting to be handed over is outdated now */
+  if (plugin->load_pending != NULL)
+    {
+      applications_menu_plugin_load_free (plugin->load_pending);
+      plugin->load_pending = NULL;
+    }
+
+  /* load a copy, the gtk menu can still load its own menu if it is
+   * opened before the thread is finished */
+  file = garcon_menu_get_file (menu);
+  load_menu = garcon_menu_new (file);
+  g_object_unref (G_OBJECT (file));
+
+  task = g_task_new (plugin, plugin->load_cancellable,
+                     applications_menu_plugin_load_ready, NULL);
+  g_task_set_task_data (task, load_menu, g_object_unref);
+  g_task_run_in_thread (task, applications_menu_plugin_load_thread);
+  g_object_unref (G_OBJECT (task));
+}
+
+
+
+static gboolean
+applications_menu_plugin_reload_timeout (gpointer user_data)
+{
+  ApplicationsMenuPlugin *plugin = XFCE_APPLICATIONS_MENU_PLUGIN (user_data);
+
+  panel_return_val_if_fail (GARCON_IS_MENU (plugin->garcon_menu), FALSE);
+
+  /* don't replace the menu under the user, try again later */
+  if (gtk_widget_get_visible (plugin->menu))
+    return TRUE;
+
+  panel_debug (PANEL_DEBUG_APPLICATIONSMENU, "reloading the menu in the background");
+
+  applications_menu_plugin_load_async (plugin, plugin->garcon_menu);
+
+  return FALSE;
+}
+
+
+
+static void
+applications_menu_plugin_reload_timeout_destroyed (gpointer user_data)
+{
+  XFCE_APPLICATIONS_MENU_PLUGIN (user_data)->reload_timeout_id = 0;
+}
+
+
+
+static void
+applications_menu_plugin_reload_required (GarconMenu             *menu,
+                                          ApplicationsMenuPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin));
+  panel_return_if_fail (plugin->garcon_menu == menu);
+
+  /* installing or upgrading packages changes many desktop files in a
+   * short time, wait until it settles before reloading the menu once */
+  if (plugin->reload_timeout_id != 0)
+    g_source_remove (plugin->reload_timeout_id);
+
+  plugin->reload_timeout_id =
+      gdk_threads_add_timeout_full (G_PRIORITY_LOW, RELOAD_DELAY,
+                                    applications_menu_plugin_reload_timeout, plugin,
+                                    applications_menu_plugin_reload_timeout_destroyed);
+}
+
+
+
+static void
+applications_menu_plugin_watch_menu (ApplicationsMenuPlugin *plugin,
+                                     GarconMenu             *menu)
+{
+  panel_return_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin));
+  panel_return_if_fail (menu == NULL || GARCON_IS_MENU (menu));
+
+  if (plugin->garcon_menu != NULL)
+    {
+      g_signal_handler_disconnect (G_OBJECT (plugin->garcon_menu), plugin->reload_required_id);
+      g_object_unref (G_OBJECT (plugin->garcon_menu));
+      plugin->garcon_menu = NULL;
+    }
+
+  if (menu != NULL)
+    {
+      plugin->garcon_menu = GARCON_MENU (g_object_ref (G_OBJECT (menu)));
+      plugin->reload_required_id = g_signal_connect (G_OBJECT (menu), "reload-required",
+          G_CALLBACK (applications_menu_plugin_reload_required), plugin);
+
+      /* the gtk menu would also load the menu again on the next popup,
+       * on the main thread, so we're the only one that reloads */
+      g_signal_handlers_disconnect_matched (G_OBJECT (menu), G_SIGNAL_MATCH_ID | G_SIGNAL_MATCH_DATA,
+                                            g_signal_lookup ("reload-required", GARCON_TYPE_MENU),
+                                            0, NULL, NULL, plugin->menu);
+    }
+}
+
+
+
 static void
 applications_menu_plugin_set_garcon_menu (ApplicationsMenuPlugin *plugin)
 {
@@ -777,11 +1148,324 @@ applications_menu_plugin_set_garcon_menu (ApplicationsMenuPlugin *plugin)
   g_free (filename);
     }
 
+  /* pre-warm the menu, so the first popup is as fast as the next ones */
+  applications_menu_plugin_watch_menu (plugin, menu);
+  applications_menu_plugin_load_async (plugin, menu);
+
   g_object_unref (G_OBJECT (menu));
 }
 
 
 
+static void
+applications_menu_plugin_popup (ApplicationsMenuPlugin *plugin,
+                                GtkWidget              *menu,
+                                GdkEvent               *event)
+{
+  panel_return_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin));
+  panel_return_if_fail (GTK_IS_MENU (menu));
+
+  if (plugin->popup_at_pointer)
+    {
+      gtk_menu_popup_at_pointer (GTK_MENU (menu), event);
+    }
+  else
+    {
+      gtk_menu_popup_at_widget (GTK_MENU (menu), plugin->button,
+                                xfce_panel_plugin_get_orientation (XFCE_PANEL_PLUGIN (plugin)) == GTK_ORIENTATION_VERTICAL
+                                ? GDK_GRAVITY_NORTH_EAST : GDK_GRAVITY_SOUTH_WEST,
+                                GDK_GRAVITY_NORTH_WEST,
+                                event);
+    }
+}
+
+
+
+static void
+applications_menu_plugin_search_activate (GtkWidget              *mi,
+                                          ApplicationsMenuPlugin *plugin)
+{
+  GarconMenuItem      *item;
+  GFile               *file;
+  gchar               *filename;
+  GDesktopAppInfo     *info = NULL;
+  GdkAppLaunchContext *context;
+  GError              *error = NULL;
+
+  item = g_object_get_data (G_OBJECT (mi), "garcon-menu-item");
+  panel_return_if_fail (GARCON_IS_MENU_ITEM (item));
+
+  file = garcon_menu_item_get_file (item);
+  filename = g_file_get_path (file);
+  g_object_unref (G_OBJECT (file));
+
+  if (G_LIKELY (filename != NULL))
+    info = g_desktop_app_info_new_from_filename (filename);
+  g_free (filename);
+
+  context = gdk_display_get_app_launch_context (gtk_widget_get_display (mi));
+  gdk_app_launch_context_set_screen (context, gtk_widget_get_screen (mi));
+  gdk_app_launch_context_set_timestamp (context, gtk_get_current_event_time ());
+
+  /* launch the application like the menu does, this handles field
+   * codes, startup notification and terminal applications */
+  if (info == NULL
+      || !g_app_info_launch (G_APP_INFO (info), NULL,
+                             G_APP_LAUNCH_CONTEXT (context), &error))
+    {
+      xfce_dialog_show_error (NULL, error,
+                              _("Failed to execute command \"%s\"."),
+                              garcon_menu_item_get_command (item));
+      if (error != NULL)
+        g_error_free (error);
+    }
+
+  g_object_unref (G_OBJECT (context));
+  if (info != NULL)
+    g_object_unref (G_OBJECT (info));
+}
+
+
+
+static GtkWidget *
+applications_menu_plugin_search_item (ApplicationsMenuPlugin *plugin,
+                                      GarconMenuItem         *item)
+{
+  GarconGtkMenu *menu = GARCON_GTK_MENU (plugin->menu);
+  GtkWidget     *mi;
+  GtkWidget     *image;
+  const gchar   *name = NULL;
+  const gchar   *icon_name;
+  GIcon         *icon;
+
+  if (garcon_gtk_menu_get_show_generic_names (menu))
+    name = garcon_menu_item_get_generic_name (item);
+  if (panel_str_is_empty (name))
+    name = garcon_menu_item_get_name (item);
+
+  mi = gtk_image_menu_item_new_with_label (name);
+  g_object_set_data_full (G_OBJECT (mi), "garcon-menu-item",
+                          g_object_ref (G_OBJECT (item)), g_object_unref);
+  g_signal_connect (G_OBJECT (mi), "activate",
+      G_CALLBACK (applications_menu_plugin_search_activate), plugin);
+
+  if (garcon_gtk_menu_get_show_tooltips (menu))
+    gtk_widget_set_tooltip_text (mi, garcon_menu_item_get_comment (item));
+
+  icon_name = garcon_menu_item_get_icon_name (item);
+  if (garcon_gtk_menu_get_show_menu_icons (menu)
+      && !panel_str_is_empty (icon_name))
+    {
+      icon = g_icon_new_for_string (icon_name, NULL);
+      if (G_LIKELY (icon != NULL))
+        {
+          image = gtk_image_new_from_gicon (icon, GTK_ICON_SIZE_MENU);
+          gtk_image_menu_item_set_image (GTK_IMAGE_MENU_ITEM (mi), image);
+          g_object_unref (G_OBJECT (icon));
+        }
+    }
+
+  return mi;
+}
+
+
+
+static void
+applications_menu_plugin_search_update (ApplicationsMenuPlugin *plugin)
+{
+  GtkWidget *mi;
+  GtkWidget *first = NULL;
+  GPtrArray *items;
+  gchar     *label;
+  guint      i;
+
+  panel_return_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin));
+  panel_return_if_fail (plugin->search != NULL);
+
+  gtk_container_foreach (GTK_CONTAINER (plugin->search_menu),
+                         (GtkCallback) gtk_widget_destroy, NULL);
+
+  /* show what the user typed */
+  if (plugin->search_query->len > 0)
+    label = g_strdup_printf (_("Search: %s"), plugin->search_query->str);
+  else
+    label = g_strdup (_("Type to search applications"));
+  mi = gtk_menu_item_new_with_label (label);
+  gtk_widget_set_sensitive (mi, FALSE);
+  gtk_menu_shell_append (GTK_MENU_SHELL (plugin->search_menu), mi);
+  gtk_widget_show (mi);
+  g_free (label);
+
+  items = applications_menu_search_lookup (plugin->search, plugin->search_query->str,
+                                           SEARCH_MAX_ITEMS);
+  if (items->len > 0)
+    {
+      mi = gtk_separator_menu_item_new ();
+      gtk_menu_shell_append (GTK_MENU_SHELL (plugin->search_menu), mi);
+      gtk_widget_show (mi);
+
+      for (i = 0; i < items->len; i++)
+        {
+          mi = applications_menu_plugin_search_item (plugin, g_ptr_array_index (items, i));
+          gtk_menu_shell_append (GTK_MENU_SHELL (plugin->search_menu), mi);
+          gtk_widget_show (mi);
+
+          if (first == NULL)
+            first = mi;
+        }
+    }
+  else if (plugin->search_query->len > 0)
+    {
+      mi = gtk_menu_item_new_with_label (_("No applications found"));
+      gtk_widget_set_sensitive (mi, FALSE);
+      gtk_menu_shell_append (GTK_MENU_SHELL (plugin->search_menu), mi);
+      gtk_widget_show (mi);
+    }
+  g_ptr_array_free (items, TRUE);
+
+  /* so enter starts the best match */
+  if (first != NULL)
+    gtk_menu_shell_select_item (GTK_MENU_SHELL (plugin->search_menu), first);
+
+  if (gtk_widget_get_visible (plugin->search_menu))
+    gtk_menu_reposition (GTK_MENU (plugin->search_menu));
+}
+
+
+
+static void
+applications_menu_plugin_search_popup (ApplicationsMenuPlugin *plugin,
+                                       const gchar            *query,
+                                       GdkEvent               *event)
+{
+  panel_return_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin));
+  panel_return_if_fail (plugin->search != NULL);
+
+  g_string_assign (plugin->search_query, query != NULL ? query : "");
+  applications_menu_plugin_search_update (plugin);
+
+  applications_menu_plugin_popup (plugin, plugin->search_menu, event);
+}
+
+
+
+static gboolean
+applications_menu_plugin_search_key_press_event (GtkWidget              *menu,
+                                                 GdkEventKey            *event,
+                                                 ApplicationsMenuPlugin *plugin)
+{
+  gunichar     c;
+  const gchar *prev;
+
+  panel_return_val_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin), FALSE);
+
+  if (plugin->search == NULL
+      || PANEL_HAS_FLAG (event->state, GDK_CONTROL_MASK | GDK_MOD1_MASK))
+    return FALSE;
+
+  if (event->keyval == GDK_KEY_BackSpace)
+    {
+      if (plugin->search_query->len > 0)
+        {
+          prev = g_utf8_find_prev_char (plugin->search_query->str,
+                                        plugin->search_query->str + plugin->search_query->len);
+          g_string_truncate (plugin->search_query, prev - plugin->search_query->str);
+          applications_menu_plugin_search_update (plugin);
+        }
+
+      return TRUE;
+    }
+
+  /* a space still activates the selected item in an empty search */
+  c = gdk_keyval_to_unicode (event->keyval);
+  if (g_unichar_isgraph (c)
+      || (c == ' ' && plugin->search_query->len > 0))
+    {
+      g_string_append_unichar (plugin->search_query, c);
+      applications_menu_plugin_search_update (plugin);
+
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+
+
+static gboolean
+applications_menu_plugin_menu_key_press_event (GtkWidget              *menu,
+                                               GdkEventKey            *event,
+                                               ApplicationsMenuPlugin *plugin)
+{
+  gunichar c;
+
+  panel_return_val_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin), FALSE);
+
+  /* the index is not ready yet, let the menu handle the key */
+  if (plugin->search == NULL
+      || PANEL_HAS_FLAG (event->state, GDK_CONTROL_MASK | GDK_MOD1_MASK))
+    return FALSE;
+
+  /* start searching when the user types in the menu */
+  c = gdk_keyval_to_unicode (event->keyval);
+  if (!g_unichar_isgraph (c))
+    return FALSE;
+
+  /* hide the menu (and its submenus) without untoggling the button,
+   * the search menu takes over */
+  g_signal_handlers_block_by_func (G_OBJECT (plugin->menu),
+      applications_menu_plugin_menu_deactivate, plugin->button);
+  gtk_menu_popdown (GTK_MENU (plugin->menu));
+  g_signal_handlers_unblock_by_func (G_OBJECT (plugin->menu),
+      applications_menu_plugin_menu_deactivate, plugin->button);
+
+  g_string_truncate (plugin->search_query, 0);
+  g_string_append_unichar (plugin->search_query, c);
+  applications_menu_plugin_search_popup (plugin, plugin->search_query->str, (GdkEvent *) event);
+
+  return TRUE;
+}
+
+
+
+static void
+applications_menu_plugin_menu_connect_submenus (GtkWidget              *widget,
+                                                ApplicationsMenuPlugin *plugin)
+{
+  GtkWidget *submenu;
+
+  if (!GTK_IS_MENU_ITEM (widget))
+    return;
+
+  submenu = gtk_menu_item_get_submenu (GTK_MENU_ITEM (widget));
+  if (submenu == NULL)
+    return;
+
+  /* the submenu has the keyboard grab when it is open, so it needs
+   * its own handler to start searching */
+  if (g_signal_handler_find (G_OBJECT (submenu), G_SIGNAL_MATCH_FUNC | G_SIGNAL_MATCH_DATA,
+                             0, 0, NULL, G_CALLBACK (applications_menu_plugin_menu_key_press_event), plugin) == 0)
+    g_signal_connect (G_OBJECT (submenu), "key-press-event",
+        G_CALLBACK (applications_menu_plugin_menu_key_press_event), plugin);
+
+  gtk_container_foreach (GTK_CONTAINER (submenu),
+      (GtkCallback) applications_menu_plugin_menu_connect_submenus, plugin);
+}
+
+
+
+static void
+applications_menu_plugin_menu_map (ApplicationsMenuPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin));
+
+  /* the gtk menu (re)builds its items before it is mapped */
+  gtk_container_foreach (GTK_CONTAINER (plugin->menu),
+      (GtkCallback) applications_menu_plugin_menu_connect_submenus, plugin);
+}
+
+
+
 static gboolean
 applications_menu_plugin_menu (GtkWidget              *button,
                                GdkEventButton         *event,
@@ -800,11 +1484,8 @@ applications_menu_plugin_menu (GtkWidget              *button,
     gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (button), TRUE);
 
   /* show the menu */
-  gtk_menu_popup_at_widget (GTK_MENU (plugin->menu), button,
-                            xfce_panel_plugin_get_orientation (XFCE_PANEL_PLUGIN (plugin)) == GTK_ORIENTATION_VERTICAL
-                            ? GDK_GRAVITY_NORTH_EAST : GDK_GRAVITY_SOUTH_WEST,
-                            GDK_GRAVITY_NORTH_WEST,
-                            (GdkEvent *) event);
+  plugin->popup_at_pointer = (button == NULL);
+  applications_menu_plugin_popup (plugin, plugin->menu, (GdkEvent *) event);
 
   return TRUE;
 }
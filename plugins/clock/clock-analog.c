@@ -46,6 +46,9 @@ static void      xfce_clock_analog_get_property  (GObject              *object,
                                                   GValue               *value,
                                                   GParamSpec           *pspec);
 static void      xfce_clock_analog_finalize      (GObject              *object);
+static void      xfce_clock_analog_style_updated (GtkWidget            *widget);
+static void      xfce_clock_analog_state_flags_changed (GtkWidget      *widget,
+                                                  GtkStateFlags         previous_state);
 static gboolean  xfce_clock_analog_draw          (GtkWidget            *widget,
                                                   cairo_t              *cr);
 static void      xfce_clock_analog_draw_ticks    (cairo_t              *cr,
@@ -86,6 +89,12 @@ struct _XfceClockAnalog
 
   guint               show_seconds : 1;
   ClockTime          *time;
+
+  /* cached ticks of the clock face */
+  cairo_surface_t    *background;
+  gint                background_width;
+  gint                background_height;
+  gint                background_scale;
 };
 
 
@@ -107,6 +116,8 @@ xfce_clock_analog_class_init (XfceClockAnalogClass *klass)
 
   gtkwidget_class = GTK_WIDGET_CLASS (klass);
   gtkwidget_class->draw = xfce_clock_analog_draw;
+  gtkwidget_class->style_updated = xfce_clock_analog_style_updated;
+  gtkwidget_class->state_flags_changed = xfce_clock_analog_state_flags_changed;
 
   g_object_class_install_property (gobject_class,
                                    PROP_SIZE_RATIO,
@@ -137,6 +148,7 @@ static void
 xfce_clock_analog_init (XfceClockAnalog *analog)
 {
   analog->show_seconds = FALSE;
+  analog->background = NULL;
 }
 
 
@@ -197,17 +209,53 @@ xfce_clock_analog_get_property (GObject    *object,
 
 
 
+static void
+xfce_clock_analog_clear_background (XfceClockAnalog *analog)
+{
+  if (analog->background != NULL)
+    {
+      cairo_surface_destroy (analog->background);
+      analog->background = NULL;
+    }
+}
+
+
+
 static void
 xfce_clock_analog_finalize (GObject *object)
 {
   /* stop the timeout */
   clock_time_timeout_free (XFCE_CLOCK_ANALOG (object)->timeout);
 
+  xfce_clock_analog_clear_background (XFCE_CLOCK_ANALOG (object));
+
   (*G_OBJECT_CLASS (xfce_clock_analog_parent_class)->finalize) (object);
 }
 
 
 
+static void
+xfce_clock_analog_style_updated (GtkWidget *widget)
+{
+  (*GTK_WIDGET_CLASS (xfce_clock_analog_parent_class)->style_updated) (widget);
+
+  /* the ticks are drawn in the foreground color */
+  xfce_clock_analog_clear_background (XFCE_CLOCK_ANALOG (widget));
+}
+
+
+
+static void
+xfce_clock_analog_state_flags_changed (GtkWidget     *widget,
+                                       GtkStateFlags  previous_state)
+{
+  (*GTK_WIDGET_CLASS (xfce_clock_analog_parent_class)->state_flags_changed) (widget, previous_state);
+
+  xfce_clock_analog_clear_background (XFCE_CLOCK_ANALOG (widget));
+}
+
+
+
 static gboolean
 xfce_clock_analog_draw (GtkWidget *widget,
                         cairo_t   *cr)
@@ -219,6 +267,8 @@ xfce_clock_analog_draw (GtkWidget *widget,
   GtkAllocation    allocation;
   GtkStyleContext *ctx;
   GdkRGBA          fg_rgba;
+  gint             scale;
+  cairo_t         *bg_cr;
 
   panel_return_val_if_fail (XFCE_CLOCK_IS_ANALOG (analog), FALSE);
   panel_return_val_if_fail (cr != NULL, FALSE);
@@ -232,14 +282,39 @@ xfce_clock_analog_draw (GtkWidget *widget,
   /* get the local time */
   time = clock_time_get_time (analog->time);
 
-  /* set the line properties */
-  cairo_set_line_width (cr, 1);
   ctx = gtk_widget_get_style_context (widget);
   gtk_style_context_get_color (ctx, gtk_widget_get_state_flags (widget), &fg_rgba);
-  gdk_cairo_set_source_rgba (cr, &fg_rgba);
 
-  /* draw the ticks */
-  xfce_clock_analog_draw_ticks (cr, xc, yc, radius);
+  /* the ticks only change with the size, so draw them once on
+   * a surface and only draw the pointers on every update */
+  scale = gtk_widget_get_scale_factor (widget);
+  if (analog->background == NULL
+      || analog->background_width != allocation.width
+      || analog->background_height != allocation.height
+      || analog->background_scale != scale)
+    {
+      xfce_clock_analog_clear_background (analog);
+
+      analog->background = gdk_window_create_similar_surface (gtk_widget_get_window (widget),
+                                                              CAIRO_CONTENT_COLOR_ALPHA,
+                                                              allocation.width,
+                                                              allocation.height);
+      analog->background_width = allocation.width;
+      analog->background_height = allocation.height;
+      analog->background_scale = scale;
+
+      bg_cr = cairo_create (analog->background);
+      gdk_cairo_set_source_rgba (bg_cr, &fg_rgba);
+      xfce_clock_analog_draw_ticks (bg_cr, xc, yc, radius);
+      cairo_destroy (bg_cr);
+    }
+
+  cairo_set_source_surface (cr, analog->background, 0, 0);
+  cairo_paint (cr);
+
+  /* set the line properties */
+  cairo_set_line_width (cr, 1);
+  gdk_cairo_set_source_rgba (cr, &fg_rgba);
 
   if (analog->show_seconds)
     {
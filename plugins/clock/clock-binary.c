@@ -42,6 +42,9 @@ static void      xfce_clock_binary_get_property  (GObject              *object,
                                                   GValue               *value,
                                                   GParamSpec           *pspec);
 static void      xfce_clock_binary_finalize      (GObject              *object);
+static void      xfce_clock_binary_style_updated (GtkWidget            *widget);
+static void      xfce_clock_binary_state_flags_changed (GtkWidget      *widget,
+                                                  GtkStateFlags         previous_state);
 static gboolean  xfce_clock_binary_draw          (GtkWidget            *widget,
                                                   cairo_t              *cr);
 static gboolean  xfce_clock_binary_update        (XfceClockBinary      *binary,
@@ -78,6 +81,12 @@ struct _XfceClockBinary
   guint     show_grid : 1;
 
   ClockTime *time;
+
+  /* cached grid and inactive dots */
+  cairo_surface_t *background;
+  gint             background_width;
+  gint             background_height;
+  gint             background_scale;
 };
 
 
@@ -99,6 +108,8 @@ xfce_clock_binary_class_init (XfceClockBinaryClass *klass)
 
   gtkwidget_class = GTK_WIDGET_CLASS (klass);
   gtkwidget_class->draw = xfce_clock_binary_draw;
+  gtkwidget_class->style_updated = xfce_clock_binary_style_updated;
+  gtkwidget_class->state_flags_changed = xfce_clock_binary_state_flags_changed;
 
   g_object_class_install_property (gobject_class,
                                    PROP_SIZE_RATIO,
@@ -153,7 +164,19 @@ xfce_clock_binary_init (XfceClockBinary *binary)
   binary->true_binary = FALSE;
   binary->show_inactive = TRUE;
   binary->show_grid = FALSE;
+  binary->background = NULL;
+}
+
+
 
+static void
+xfce_clock_binary_clear_background (XfceClockBinary *binary)
+{
+  if (binary->background != NULL)
+    {
+      cairo_surface_destroy (binary->background);
+      binary->background = NULL;
+    }
 }
 
 
@@ -194,6 +217,9 @@ xfce_clock_binary_set_property (GObject      *object,
       break;
     }
 
+  /* all properties change the layout of the background */
+  xfce_clock_binary_clear_background (binary);
+
   /* reschedule the timeout and resize */
   clock_time_timeout_set_interval (binary->timeout,
       binary->show_seconds ? CLOCK_INTERVAL_SECOND : CLOCK_INTERVAL_MINUTE);
@@ -251,15 +277,40 @@ xfce_clock_binary_finalize (GObject *object)
   /* stop the timeout */
   clock_time_timeout_free (XFCE_CLOCK_BINARY (object)->timeout);
 
+  xfce_clock_binary_clear_background (XFCE_CLOCK_BINARY (object));
+
   (*G_OBJECT_CLASS (xfce_clock_binary_parent_class)->finalize) (object);
 }
 
 
 
+static void
+xfce_clock_binary_style_updated (GtkWidget *widget)
+{
+  (*GTK_WIDGET_CLASS (xfce_clock_binary_parent_class)->style_updated) (widget);
+
+  /* the grid, padding and inactive dots depend on the style */
+  xfce_clock_binary_clear_background (XFCE_CLOCK_BINARY (widget));
+}
+
+
+
+static void
+xfce_clock_binary_state_flags_changed (GtkWidget     *widget,
+                                       GtkStateFlags  previous_state)
+{
+  (*GTK_WIDGET_CLASS (xfce_clock_binary_parent_class)->state_flags_changed) (widget, previous_state);
+
+  xfce_clock_binary_clear_background (XFCE_CLOCK_BINARY (widget));
+}
+
+
+
 static void
 xfce_clock_binary_draw_true_binary (XfceClockBinary *binary,
                                     cairo_t         *cr,
-                                    GtkAllocation   *alloc)
+                                    GtkAllocation   *alloc,
+                                    gboolean         background)
 {
   GDateTime        *time;
   gint              row, rows;
@@ -324,14 +375,16 @@ xfce_clock_binary_draw_true_binary (XfceClockBinary *binary,
           remain_w -= w;
           offset_x += w;
 
-          if (ticks >= binary_table[col])
+          /* the background has all dots inactive, the active dots
+           * are drawn on top of it */
+          if (background)
             {
-              gdk_cairo_set_source_rgba (cr, &active_rgba);
-              ticks -= binary_table[col];
+              gdk_cairo_set_source_rgba (cr, &inactive_rgba);
             }
-          else if (binary->show_inactive)
+          else if (ticks >= binary_table[col])
             {
-              gdk_cairo_set_source_rgba (cr, &inactive_rgba);
+              gdk_cairo_set_source_rgba (cr, &active_rgba);
+              ticks -= binary_table[col];
             }
           else
             {
@@ -354,8 +407,9 @@ xfce_clock_binary_draw_true_binary (XfceClockBinary *binary,
 
 static void
 xfce_clock_binary_draw_binary (XfceClockBinary *binary,
-                                     cairo_t         *cr,
-                                     GtkAllocation   *alloc)
+                               cairo_t         *cr,
+                               GtkAllocation   *alloc,
+                               gboolean         background)
 {
   static gint       binary_table[] = { 80, 40, 20, 10, 8, 4, 2, 1 };
   GDateTime        *time;
@@ -422,14 +476,14 @@ xfce_clock_binary_draw_binary (XfceClockBinary *binary,
           offset_y += h;
 
           digit = row + (4 * (col % 2));
-          if (ticks >= binary_table[digit])
+          if (background)
             {
-              gdk_cairo_set_source_rgba (cr, &active_rgba);
-              ticks -= binary_table[digit];
+              gdk_cairo_set_source_rgba (cr, &inactive_rgba);
             }
-          else if (binary->show_inactive)
+          else if (ticks >= binary_table[digit])
             {
-              gdk_cairo_set_source_rgba (cr, &inactive_rgba);
+              gdk_cairo_set_source_rgba (cr, &active_rgba);
+              ticks -= binary_table[digit];
             }
           else
             {
@@ -464,6 +518,9 @@ xfce_clock_binary_draw (GtkWidget *widget,
   GtkStyleContext  *ctx;
   GdkRGBA           grid_rgba;
   GtkBorder         padding;
+  GtkAllocation     allocation;
+  gint              scale;
+  cairo_t          *bg_cr;
 
   panel_return_val_if_fail (XFCE_CLOCK_IS_BINARY (binary), FALSE);
   //panel_return_val_if_fail (gtk_widget_get_has_window (widget), FALSE);
@@ -474,7 +531,8 @@ xfce_clock_binary_draw (GtkWidget *widget,
   pad_x = MAX (padding.left, padding.right);
   pad_y = MAX (padding.top, padding.bottom);
 
-  gtk_widget_get_allocation (widget, &alloc);
+  gtk_widget_get_allocation (widget, &allocation);
+  alloc = allocation;
   alloc.width -= 1 + 2 * pad_x;
   alloc.height -= 1 + 2 * pad_y;
   alloc.x = pad_x + 1;
@@ -492,45 +550,79 @@ xfce_clock_binary_draw (GtkWidget *widget,
   alloc.height -= diff;
   alloc.y += diff / 2;
 
-  if (binary->show_grid)
+  /* the grid and inactive dots only change with the size, so draw
+   * them once on a surface and only draw the active dots on updates */
+  scale = gtk_widget_get_scale_factor (widget);
+  if (binary->background == NULL
+      || binary->background_width != allocation.width
+      || binary->background_height != allocation.height
+      || binary->background_scale != scale)
     {
-      gtk_style_context_get_color (ctx, gtk_widget_get_state_flags (widget),
-                                   &grid_rgba);
-      grid_rgba.alpha = 0.4;
-      gdk_cairo_set_source_rgba (cr, &grid_rgba);
-      cairo_set_line_width (cr, 1);
+      xfce_clock_binary_clear_background (binary);
 
-      remain_w = alloc.width;
-      remain_h = alloc.height;
-      x = alloc.x - 0.5;
-      y = alloc.y - 0.5;
+      binary->background = gdk_window_create_similar_surface (gtk_widget_get_window (widget),
+                                                              CAIRO_CONTENT_COLOR_ALPHA,
+                                                              allocation.width,
+                                                              allocation.height);
+      binary->background_width = allocation.width;
+      binary->background_height = allocation.height;
+      binary->background_scale = scale;
 
-      cairo_rectangle (cr, x, y, alloc.width, alloc.height);
-      cairo_stroke (cr);
+      bg_cr = cairo_create (binary->background);
 
-      for (col = 0; col < cols - 1; col++)
+      if (binary->show_grid)
         {
-          w = remain_w / (cols - col);
-          x += w; remain_w -= w;
-          cairo_move_to (cr, x, alloc.y);
-          cairo_rel_line_to (cr, 0, alloc.height);
-          cairo_stroke (cr);
+          gtk_style_context_get_color (ctx, gtk_widget_get_state_flags (widget),
+                                       &grid_rgba);
+          grid_rgba.alpha = 0.4;
+          gdk_cairo_set_source_rgba (bg_cr, &grid_rgba);
+          cairo_set_line_width (bg_cr, 1);
+
+          remain_w = alloc.width;
+          remain_h = alloc.height;
+          x = alloc.x - 0.5;
+          y = alloc.y - 0.5;
+
+          cairo_rectangle (bg_cr, x, y, alloc.width, alloc.height);
+          cairo_stroke (bg_cr);
+
+          for (col = 0; col < cols - 1; col++)
+            {
+              w = remain_w / (cols - col);
+              x += w; remain_w -= w;
+              cairo_move_to (bg_cr, x, alloc.y);
+              cairo_rel_line_to (bg_cr, 0, alloc.height);
+              cairo_stroke (bg_cr);
+            }
+
+          for (row = 0; row < rows - 1; row++)
+            {
+              h = remain_h / (rows - row);
+              y += h; remain_h -= h;
+              cairo_move_to (bg_cr, alloc.x, y);
+              cairo_rel_line_to (bg_cr, alloc.width, 0);
+              cairo_stroke (bg_cr);
+            }
         }
 
-      for (row = 0; row < rows - 1; row++)
+      if (binary->show_inactive)
         {
-          h = remain_h / (rows - row);
-          y += h; remain_h -= h;
-          cairo_move_to (cr, alloc.x, y);
-          cairo_rel_line_to (cr, alloc.width, 0);
-          cairo_stroke (cr);
+          if (binary->true_binary)
+            xfce_clock_binary_draw_true_binary (binary, bg_cr, &alloc, TRUE);
+          else
+            xfce_clock_binary_draw_binary (binary, bg_cr, &alloc, TRUE);
         }
+
+      cairo_destroy (bg_cr);
     }
 
+  cairo_set_source_surface (cr, binary->background, 0, 0);
+  cairo_paint (cr);
+
   if (binary->true_binary)
-    xfce_clock_binary_draw_true_binary (binary, cr, &alloc);
+    xfce_clock_binary_draw_true_binary (binary, cr, &alloc, FALSE);
   else
-    xfce_clock_binary_draw_binary (binary, cr, &alloc);
+    xfce_clock_binary_draw_binary (binary, cr, &alloc, FALSE);
 
   return FALSE;
 }
@@ -35,6 +35,11 @@
 #define RELATIVE_DIGIT (5 * RELATIVE_SPACE)
 #define RELATIVE_DOTS  (3 * RELATIVE_SPACE)
 
+/* glyphs 0-9, A and P are the digits, followed by the dots */
+#define GLYPH_DOTS     (12)
+#define N_GLYPHS       (13)
+#define GLYPH_PADDING  (2)
+
 
 
 static void      xfce_clock_lcd_set_property (GObject           *object,
@@ -46,6 +51,9 @@ static void      xfce_clock_lcd_get_property (GObject           *object,
                                               GValue            *value,
                                               GParamSpec        *pspec);
 static void      xfce_clock_lcd_finalize     (GObject           *object);
+static void      xfce_clock_lcd_style_updated (GtkWidget        *widget);
+static void      xfce_clock_lcd_state_flags_changed (GtkWidget  *widget,
+                                              GtkStateFlags      previous_state);
 static gboolean  xfce_clock_lcd_draw         (GtkWidget         *widget,
                                               cairo_t           *cr);
 static gdouble   xfce_clock_lcd_get_ratio    (XfceClockLcd      *lcd);
@@ -92,6 +100,11 @@ struct _XfceClockLcd
   guint               flash_separators : 1;
 
   ClockTime          *time;
+
+  /* rendered digits and dots, reused until the size changes */
+  cairo_surface_t    *glyphs[N_GLYPHS];
+  gdouble             glyphs_size;
+  gint                glyphs_scale;
 };
 
 typedef struct
@@ -120,6 +133,8 @@ xfce_clock_lcd_class_init (XfceClockLcdClass *klass)
 
   gtkwidget_class = GTK_WIDGET_CLASS (klass);
   gtkwidget_class->draw = xfce_clock_lcd_draw;
+  gtkwidget_class->style_updated = xfce_clock_lcd_style_updated;
+  gtkwidget_class->state_flags_changed = xfce_clock_lcd_state_flags_changed;
 
   g_object_class_install_property (gobject_class,
                                    PROP_SIZE_RATIO,
@@ -174,6 +189,8 @@ xfce_clock_lcd_init (XfceClockLcd *lcd)
   lcd->show_meridiem = FALSE;
   lcd->show_military = TRUE;
   lcd->flash_separators = FALSE;
+  lcd->glyphs_size = 0.0;
+  lcd->glyphs_scale = 0;
 }
 
 
@@ -264,17 +281,108 @@ xfce_clock_lcd_get_property (GObject    *object,
 
 
 
+static void
+xfce_clock_lcd_clear_glyphs (XfceClockLcd *lcd)
+{
+  guint i;
+
+  for (i = 0; i < N_GLYPHS; i++)
+    {
+      if (lcd->glyphs[i] != NULL)
+        {
+          cairo_surface_destroy (lcd->glyphs[i]);
+          lcd->glyphs[i] = NULL;
+        }
+    }
+}
+
+
+
 static void
 xfce_clock_lcd_finalize (GObject *object)
 {
   /* stop the timeout */
   clock_time_timeout_free (XFCE_CLOCK_LCD (object)->timeout);
 
+  xfce_clock_lcd_clear_glyphs (XFCE_CLOCK_LCD (object));
+
   (*G_OBJECT_CLASS (xfce_clock_lcd_parent_class)->finalize) (object);
 }
 
 
 
+static void
+xfce_clock_lcd_style_updated (GtkWidget *widget)
+{
+  (*GTK_WIDGET_CLASS (xfce_clock_lcd_parent_class)->style_updated) (widget);
+
+  /* the glyphs are drawn in the foreground color */
+  xfce_clock_lcd_clear_glyphs (XFCE_CLOCK_LCD (widget));
+}
+
+
+
+static void
+xfce_clock_lcd_state_flags_changed (GtkWidget     *widget,
+                                    GtkStateFlags  previous_state)
+{
+  (*GTK_WIDGET_CLASS (xfce_clock_lcd_parent_class)->state_flags_changed) (widget, previous_state);
+
+  xfce_clock_lcd_clear_glyphs (XFCE_CLOCK_LCD (widget));
+}
+
+
+
+static gdouble
+xfce_clock_lcd_paint_glyph (XfceClockLcd  *lcd,
+                            cairo_t       *cr,
+                            guint          glyph,
+                            gdouble        size,
+                            gdouble        offset_x,
+                            gdouble        offset_y,
+                            const GdkRGBA *rgba)
+{
+  gdouble  width;
+  cairo_t *glyph_cr;
+
+  panel_return_val_if_fail (glyph < N_GLYPHS, offset_x);
+
+  if (lcd->glyphs[glyph] == NULL)
+    {
+      width = size * (glyph == GLYPH_DOTS ? RELATIVE_SPACE : RELATIVE_DIGIT);
+      lcd->glyphs[glyph] = gdk_window_create_similar_surface (gtk_widget_get_window (GTK_WIDGET (lcd)),
+                                                              CAIRO_CONTENT_COLOR_ALPHA,
+                                                              ceil (width) + 2 * GLYPH_PADDING,
+                                                              ceil (size) + 2 * GLYPH_PADDING);
+
+      /* draw the glyph once, the clear lines of the digit only
+       * affect the glyph itself so no group is needed */
+      glyph_cr = cairo_create (lcd->glyphs[glyph]);
+      gdk_cairo_set_source_rgba (glyph_cr, rgba);
+      cairo_set_line_width (glyph_cr, MAX (size * 0.05, 1.5));
+
+      if (glyph == GLYPH_DOTS)
+        xfce_clock_lcd_draw_dots (glyph_cr, size, GLYPH_PADDING, GLYPH_PADDING);
+      else
+        xfce_clock_lcd_draw_digit (glyph_cr, glyph, size, GLYPH_PADDING, GLYPH_PADDING);
+
+      cairo_destroy (glyph_cr);
+    }
+
+  /* paint on whole pixels to keep the cached glyphs sharp */
+  cairo_set_source_surface (cr, lcd->glyphs[glyph],
+                            rint (offset_x) - GLYPH_PADDING,
+                            rint (offset_y) - GLYPH_PADDING);
+  cairo_paint (cr);
+
+  if (glyph == GLYPH_DOTS)
+    return (offset_x + size * RELATIVE_SPACE * 2);
+  else
+    return (offset_x + size * (RELATIVE_DIGIT + RELATIVE_SPACE));
+}
+
+
+
 static gboolean
 xfce_clock_lcd_draw (GtkWidget *widget,
                      cairo_t   *cr)
@@ -288,6 +396,7 @@ xfce_clock_lcd_draw (GtkWidget *widget,
   GtkAllocation allocation;
   GtkStyleContext *ctx;
   GdkRGBA          fg_rgba;
+  gint             scale;
 
   panel_return_val_if_fail (XFCE_CLOCK_IS_LCD (lcd), FALSE);
   panel_return_val_if_fail (cr != NULL, FALSE);
@@ -299,10 +408,18 @@ xfce_clock_lcd_draw (GtkWidget *widget,
   gtk_widget_get_allocation (widget, &allocation);
   size = MIN ((gdouble) allocation.width / ratio, allocation.height);
 
-  /* set correct color */
+  /* get the color of the glyphs */
   ctx = gtk_widget_get_style_context (widget);
   gtk_style_context_get_color (ctx, gtk_widget_get_state_flags (widget), &fg_rgba);
-  gdk_cairo_set_source_rgba (cr, &fg_rgba);
+
+  /* render the glyphs again when the size changed */
+  scale = gtk_widget_get_scale_factor (widget);
+  if (lcd->glyphs_size != size || lcd->glyphs_scale != scale)
+    {
+      xfce_clock_lcd_clear_glyphs (lcd);
+      lcd->glyphs_size = size;
+      lcd->glyphs_scale = scale;
+    }
 
   /* begin offsets */
   offset_x = rint ((allocation.width - (size * ratio)) / 2.00);
@@ -312,11 +429,6 @@ xfce_clock_lcd_draw (GtkWidget *widget,
   offset_x = MAX (0.00, offset_x);
   offset_y = MAX (0.00, offset_y);
 
-  cairo_push_group (cr);
-
-  /* width of the clear line */
-  cairo_set_line_width (cr, MAX (size * 0.05, 1.5));
-
   /* get the local time */
   time = clock_time_get_time (lcd->time);
 
@@ -341,11 +453,11 @@ xfce_clock_lcd_draw (GtkWidget *widget,
   if (ticks >= 10)
     {
       /* draw the number and increase the offset */
-      offset_x = xfce_clock_lcd_draw_digit (cr, ticks >= 20 ? 2 : 1, size, offset_x, offset_y);
+      offset_x = xfce_clock_lcd_paint_glyph (lcd, cr, ticks >= 20 ? 2 : 1, size, offset_x, offset_y, &fg_rgba);
     }
 
   /* draw the other number of the hour and increase the offset */
-  offset_x = xfce_clock_lcd_draw_digit (cr, ticks % 10, size, offset_x, offset_y);
+  offset_x = xfce_clock_lcd_paint_glyph (lcd, cr, ticks % 10, size, offset_x, offset_y, &fg_rgba);
 
   for (i = 0; i < 2; i++)
     {
@@ -369,13 +481,13 @@ xfce_clock_lcd_draw (GtkWidget *widget,
       if (lcd->flash_separators && (g_date_time_get_second (time) % 2) == 1)
         offset_x += size * RELATIVE_SPACE * 2;
       else
-        offset_x = xfce_clock_lcd_draw_dots (cr, size, offset_x, offset_y);
+        offset_x = xfce_clock_lcd_paint_glyph (lcd, cr, GLYPH_DOTS, size, offset_x, offset_y, &fg_rgba);
 
       /* draw the first digit */
-      offset_x = xfce_clock_lcd_draw_digit (cr, (ticks - (ticks % 10)) / 10, size, offset_x, offset_y);
+      offset_x = xfce_clock_lcd_paint_glyph (lcd, cr, (ticks - (ticks % 10)) / 10, size, offset_x, offset_y, &fg_rgba);
 
       /* draw the second digit */
-      offset_x = xfce_clock_lcd_draw_digit (cr, ticks % 10, size, offset_x, offset_y);
+      offset_x = xfce_clock_lcd_paint_glyph (lcd, cr, ticks % 10, size, offset_x, offset_y, &fg_rgba);
     }
 
   if (lcd->show_meridiem)
@@ -384,13 +496,10 @@ xfce_clock_lcd_draw (GtkWidget *widget,
       ticks = g_date_time_get_hour (time) >= 12 ? 11 : 10;
 
       /* draw the digit */
-      offset_x = xfce_clock_lcd_draw_digit (cr, ticks, size, offset_x, offset_y);
+      offset_x = xfce_clock_lcd_paint_glyph (lcd, cr, ticks, size, offset_x, offset_y, &fg_rgba);
     }
 
-  /* drop the pushed group */
   g_date_time_unref (time);
-  cairo_pop_group_to_source (cr);
-  cairo_paint (cr);
 
   return FALSE;
 }
@@ -16,6 +16,22 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_TIMERFD_H
+#include <sys/timerfd.h>
+#endif
 
 #include <glib.h>
 
@@ -31,11 +47,21 @@ static void                 clock_time_set_property   (GObject          *object,
                                                        guint             prop_id,
                                                        const GValue     *value,
                                                        GParamSpec       *pspec);
+static void                 clock_time_scheduler_arm  (void);
+static void                 clock_time_scheduler_reschedule (ClockTime  *time);
 
 
 
 #define DEFAULT_TIMEZONE ""
 
+/* how often clocks that only change on timezone transitions are
+ * checked, in case the transition is beyond the timezone data */
+#define TRANSITION_RECHECK (G_GINT64_CONSTANT (7) * 24 * 3600 * G_USEC_PER_SEC)
+
+#if defined (HAVE_SYS_TIMERFD_H) && defined (TFD_TIMER_CANCEL_ON_SET)
+#define CLOCK_TIME_USE_TIMERFD 1
+#endif
+
 enum
 {
   PROP_0,
@@ -58,8 +84,10 @@ struct _ClockTime
 struct _ClockTimeTimeout
 {
   guint       interval;
-  guint       timeout_id;
-  guint       restart : 1;
+
+  /* wall-clock time of the next update in microseconds */
+  gint64      next;
+
   ClockTime  *time;
   guint       time_changed_id;
 };
@@ -72,6 +100,19 @@ enum
 
 static guint clock_time_signals[LAST_SIGNAL] = { 0, };
 
+/* a single timer drives the timeouts of all clocks in the process */
+static GSList *scheduler_timeouts = NULL;
+static guint   scheduler_source_id = 0;
+#ifdef CLOCK_TIME_USE_TIMERFD
+static gint    scheduler_fd = -1;
+#endif
+
+/* the current time per timezone and the formatted strings of all
+ * clocks in the process, only valid during one wall-clock second */
+static gint64      cache_second = -1;
+static GHashTable *cache_times = NULL;
+static GHashTable *cache_strings = NULL;
+
 
 XFCE_PANEL_DEFINE_TYPE (ClockTime, clock_time, G_TYPE_OBJECT)
 
@@ -180,6 +221,9 @@ clock_time_set_property (GObject      *object,
               time->timezone = g_time_zone_new (str_value);
             }
 
+          /* boundaries of hours and days depend on the timezone */
+          clock_time_scheduler_reschedule (time);
+
           g_signal_emit (G_OBJECT (time), clock_time_signals[TIME_CHANGED], 0);
         }
       break;
@@ -192,19 +236,60 @@ clock_time_set_property (GObject      *object,
 
 
 
+static gint64
+clock_time_cache_validate (void)
+{
+  gint64 now;
+
+  now = g_get_real_time () / G_USEC_PER_SEC;
+
+  if (G_UNLIKELY (cache_times == NULL))
+    {
+      cache_times = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                           (GDestroyNotify) g_date_time_unref);
+      cache_strings = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    }
+
+  /* drop everything from the previous second */
+  if (cache_second != now)
+    {
+      g_hash_table_remove_all (cache_times);
+      g_hash_table_remove_all (cache_strings);
+      cache_second = now;
+    }
+
+  return now;
+}
+
+
+
 GDateTime *
 clock_time_get_time (ClockTime *time)
 {
   GDateTime *date_time;
+  GDateTime *date_time_utc;
+  gint64     now;
 
   panel_return_val_if_fail (XFCE_IS_CLOCK_TIME (time), NULL);
 
-  if (time->timezone != NULL)
-    date_time = g_date_time_new_now (time->timezone);
-  else
-    date_time = g_date_time_new_now_local ();
+  /* clocks in the same timezone share the time of this second */
+  now = clock_time_cache_validate ();
+  date_time = g_hash_table_lookup (cache_times, time->timezone_name);
+  if (date_time == NULL)
+    {
+      date_time_utc = g_date_time_new_from_unix_utc (now);
+
+      if (time->timezone != NULL)
+        date_time = g_date_time_to_timezone (date_time_utc, time->timezone);
+      else
+        date_time = g_date_time_to_local (date_time_utc);
+
+      g_date_time_unref (date_time_utc);
+
+      g_hash_table_insert (cache_times, g_strdup (time->timezone_name), date_time);
+    }
 
-  return date_time;
+  return g_date_time_ref (date_time);
 }
 
 
@@ -215,20 +300,35 @@ clock_time_strdup_strftime (ClockTime       *time,
 {
   GDateTime *date_time;
   gchar     *str;
+  gchar     *key;
 
   panel_return_val_if_fail (XFCE_IS_CLOCK_TIME (time), NULL);
 
+  /* labels and tooltips of clocks in the same timezone with the same
+   * format only need to be formatted once each second */
+  clock_time_cache_validate ();
+  key = g_strconcat (time->timezone_name, "\n", format, NULL);
+  if (g_hash_table_lookup_extended (cache_strings, key, NULL, (gpointer *) &str))
+    {
+      g_free (key);
+      return g_strdup (str);
+    }
+
   date_time = clock_time_get_time (time);
   str = g_date_time_format (date_time, format);
 
   g_date_time_unref (date_time);
 
   /* Explicitely return NULL if a format specifier fails */
-  if (!str ||
-      g_strcmp0 (str, "") == 0)
-    return NULL;
-  else
-    return str;
+  if (str != NULL && *str == '\0')
+    {
+      g_free (str);
+      str = NULL;
+    }
+
+  g_hash_table_insert (cache_strings, key, str);
+
+  return g_strdup (str);
 }
 
 
@@ -237,85 +337,404 @@ guint
 clock_time_interval_from_format (const gchar *format)
 {
   const gchar *p;
+  guint        interval = CLOCK_INTERVAL_TRANSITION;
 
   if (G_UNLIKELY (panel_str_is_empty (format)))
       return CLOCK_INTERVAL_MINUTE;
 
+  /* find the coarsest interval at which the formatted string can
+   * still change, so clocks don't wake up more than needed */
   for (p = format; *p != '\0'; ++p)
     {
-      if (p[0] == '%' && p[1] != '\0')
+      if (*p != '%')
+        continue;
+
+      /* skip the padding flags and alternative modifiers */
+      do
+        ++p;
+      while (*p != '\0' && strchr ("_-0^#EO:", *p) != NULL);
+
+      switch (*p)
         {
-          switch (*++p)
-            {
-            case 'c':
-            case 'N':
-            case 'r':
-            case 's':
-            case 'S':
-            case 'T':
-            case 'X':
-              return CLOCK_INTERVAL_SECOND;
-            }
+        case '\0':
+          return interval;
+
+        case 'c':
+        case 'N':
+        case 'r':
+        case 's':
+        case 'S':
+        case 'T':
+        case 'X':
+          return CLOCK_INTERVAL_SECOND;
+
+        case 'H':
+        case 'I':
+        case 'k':
+        case 'l':
+        case 'p':
+        case 'P':
+          interval = MIN (interval, CLOCK_INTERVAL_HOUR);
+          break;
+
+        case 'a':
+        case 'A':
+        case 'b':
+        case 'B':
+        case 'C':
+        case 'd':
+        case 'D':
+        case 'e':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'h':
+        case 'j':
+        case 'm':
+        case 'u':
+        case 'U':
+        case 'V':
+        case 'w':
+        case 'W':
+        case 'x':
+        case 'y':
+        case 'Y':
+          interval = MIN (interval, CLOCK_INTERVAL_DAY);
+          break;
+
+        case 'z':
+        case 'Z':
+        case 'n':
+        case 't':
+        case '%':
+          /* only change on timezone transitions or never */
+          break;
+
+        default:
+          /* minutes and unknown specifiers */
+          interval = MIN (interval, CLOCK_INTERVAL_MINUTE);
+          break;
         }
     }
 
-  return CLOCK_INTERVAL_MINUTE;
+  return interval;
 }
 
 
 
-static gboolean
-clock_time_timeout_running (gpointer user_data)
+static GTimeZone *
+clock_time_get_timezone (ClockTime *time)
 {
-  ClockTimeTimeout *timeout = user_data;
-  GDateTime        *time;
+  if (time->timezone != NULL)
+    return g_time_zone_ref (time->timezone);
+
+  return g_time_zone_new_local ();
+}
+
+
+
+static gint64
+clock_time_get_utc_offset (ClockTime *time,
+                           gint64     now)
+{
+  GTimeZone *tz;
+  gint       interval;
+  gint64     offset;
+
+  tz = clock_time_get_timezone (time);
+
+  interval = g_time_zone_find_interval (tz, G_TIME_TYPE_UNIVERSAL,
+                                        now / G_USEC_PER_SEC);
+  offset = (gint64) g_time_zone_get_offset (tz, interval) * G_USEC_PER_SEC;
+
+  g_time_zone_unref (tz);
+
+  return offset;
+}
 
-  g_signal_emit (G_OBJECT (timeout->time), clock_time_signals[TIME_CHANGED], 0);
 
-  /* check if the timeout still runs in time if updating once a minute */
-  if (timeout->interval == CLOCK_INTERVAL_MINUTE)
+
+static gint64
+clock_time_get_transition (ClockTime *time,
+                           gint64     now,
+                           gint64     limit)
+{
+  GTimeZone *tz;
+  gint       interval;
+  gint64     lower, upper, middle;
+
+  lower = now / G_USEC_PER_SEC;
+  upper = limit / G_USEC_PER_SEC;
+  if (upper <= lower)
+    return limit;
+
+  tz = clock_time_get_timezone (time);
+
+  /* bisect the first second in another interval of the timezone; the
+   * interval index only grows, so this also finds a transition that
+   * is reverted again before the limit */
+  interval = g_time_zone_find_interval (tz, G_TIME_TYPE_UNIVERSAL, lower);
+  if (g_time_zone_find_interval (tz, G_TIME_TYPE_UNIVERSAL, upper) == interval)
+    {
+      g_time_zone_unref (tz);
+      return limit;
+    }
+
+  while (upper - lower > 1)
     {
-      /* sync again when we don't run on time */
-      time = clock_time_get_time (timeout->time);
-      timeout->restart = (g_date_time_get_second (time) != 0);
+      middle = lower + (upper - lower) / 2;
+      if (g_time_zone_find_interval (tz, G_TIME_TYPE_UNIVERSAL, middle) == interval)
+        lower = middle;
+      else
+        upper = middle;
     }
 
-  return !timeout->restart;
+  g_time_zone_unref (tz);
+
+  return MIN (upper * G_USEC_PER_SEC, limit);
+}
+
+
+
+static gint64
+clock_time_timeout_next (ClockTimeTimeout *timeout,
+                         gint64            now)
+{
+  gint64 interval;
+  gint64 offset;
+  gint64 next;
+
+  if (timeout->interval == CLOCK_INTERVAL_TRANSITION)
+    {
+      next = now + TRANSITION_RECHECK;
+    }
+  else
+    {
+      /* align on the boundary in the clock's timezone, so a minute clock
+       * also ticks on time in zones with a non-whole-hour offset */
+      interval = (gint64) timeout->interval * G_USEC_PER_SEC;
+      offset = clock_time_get_utc_offset (timeout->time, now);
+      next = ((now + offset) / interval + 1) * interval - offset;
+    }
+
+  /* hours and days move with the utc offset, so also update on the
+   * transition and align on the new offset from there */
+  if (timeout->interval >= CLOCK_INTERVAL_HOUR)
+    next = clock_time_get_transition (timeout->time, now, next);
+
+  return next;
 }
 
 
 
 static void
-clock_time_timeout_destroyed (gpointer user_data)
+clock_time_scheduler_update (gboolean clock_changed)
 {
-  ClockTimeTimeout *timeout = user_data;
+  GSList           *li;
+  GSList           *due = NULL;
+  GSList           *emitted = NULL;
+  ClockTimeTimeout *timeout;
+  gint64            now;
 
-  timeout->timeout_id = 0;
+  now = g_get_real_time ();
 
-  if (G_UNLIKELY (timeout->restart))
-    clock_time_timeout_set_interval (timeout, timeout->interval);
+  /* after a clock change all deadlines are meaningless, so update
+   * every clock and schedule again from the new time */
+  for (li = scheduler_timeouts; li != NULL; li = li->next)
+    {
+      timeout = li->data;
+      if (clock_changed || timeout->next <= now)
+        {
+          due = g_slist_prepend (due, timeout);
+          timeout->next = clock_time_timeout_next (timeout, now);
+        }
+    }
+
+  clock_time_scheduler_arm ();
+
+  for (li = due; li != NULL; li = li->next)
+    {
+      /* a signal handler could have freed the timeout */
+      timeout = li->data;
+      if (g_slist_find (scheduler_timeouts, timeout) == NULL)
+        continue;
+
+      /* the signal reaches all handlers of the time object, so emit
+       * it only once when timeouts of the same object are due */
+      if (g_slist_find (emitted, timeout->time) != NULL)
+        continue;
+      emitted = g_slist_prepend (emitted, timeout->time);
+
+      g_signal_emit (G_OBJECT (timeout->time), clock_time_signals[TIME_CHANGED], 0);
+    }
+
+  g_slist_free (emitted);
+  g_slist_free (due);
 }
 
 
 
+static void
+clock_time_scheduler_stop (void)
+{
+  if (scheduler_source_id != 0)
+    {
+      g_source_remove (scheduler_source_id);
+      scheduler_source_id = 0;
+    }
+
+#ifdef CLOCK_TIME_USE_TIMERFD
+  if (scheduler_fd != -1)
+    {
+      close (scheduler_fd);
+      scheduler_fd = -1;
+    }
+#endif
+}
+
+
+
+static void
+clock_time_scheduler_reschedule (ClockTime *time)
+{
+  GSList           *li;
+  ClockTimeTimeout *timeout;
+  gint64            now;
+
+  now = g_get_real_time ();
+
+  for (li = scheduler_timeouts; li != NULL; li = li->next)
+    {
+      timeout = li->data;
+      if (timeout->time == time)
+        timeout->next = clock_time_timeout_next (timeout, now);
+    }
+
+  clock_time_scheduler_arm ();
+}
+
+
+
+#ifdef CLOCK_TIME_USE_TIMERFD
 static gboolean
-clock_time_timeout_sync (gpointer user_data)
+clock_time_scheduler_watch (GIOChannel   *source,
+                            GIOCondition  condition,
+                            gpointer      user_data)
 {
-  ClockTimeTimeout *timeout = user_data;
+  guint64  expirations;
+  gboolean clock_changed = FALSE;
 
-  g_signal_emit (G_OBJECT (timeout->time), clock_time_signals[TIME_CHANGED], 0);
+  if (read (scheduler_fd, &expirations, sizeof (expirations)) < 0)
+    {
+      /* the realtime clock was set (manually or by ntp), the
+       * timer is cancelled and needs to be re-armed */
+      if (errno == ECANCELED)
+        clock_changed = TRUE;
+      else
+        return TRUE;
+    }
+
+  clock_time_scheduler_update (clock_changed);
+
+  return TRUE;
+}
+
+
+
+static gboolean
+clock_time_scheduler_arm_timerfd (gint64 deadline)
+{
+  struct itimerspec  spec = { { 0, 0 }, { 0, 0 } };
+  GIOChannel        *channel;
+
+  if (scheduler_fd == -1)
+    {
+      scheduler_fd = timerfd_create (CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+      if (G_UNLIKELY (scheduler_fd == -1))
+        return FALSE;
+
+      channel = g_io_channel_unix_new (scheduler_fd);
+      scheduler_source_id = g_io_add_watch (channel, G_IO_IN,
+                                            clock_time_scheduler_watch, NULL);
+      g_io_channel_unref (channel);
+    }
+
+  spec.it_value.tv_sec = deadline / G_USEC_PER_SEC;
+  spec.it_value.tv_nsec = (deadline % G_USEC_PER_SEC) * 1000;
+
+  /* an absolute timer on the realtime clock also fires directly after
+   * resume when the deadline passed during suspend */
+  if (timerfd_settime (scheduler_fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+                       &spec, NULL) == 0)
+    return TRUE;
+
+  /* kernel without cancel-on-set support, use the fallback timeout */
+  clock_time_scheduler_stop ();
+
+  return FALSE;
+}
+#endif
+
+
+
+static gboolean
+clock_time_scheduler_timeout (gpointer user_data)
+{
+  scheduler_source_id = 0;
 
-  /* start the real timeout */
-  timeout->timeout_id = g_timeout_add_seconds_full (G_PRIORITY_DEFAULT, timeout->interval,
-                                                    clock_time_timeout_running, timeout,
-                                                    clock_time_timeout_destroyed);
+  clock_time_scheduler_update (FALSE);
 
-  /* stop the sync timeout */
+  /* the update armed a new timeout */
   return FALSE;
 }
 
 
 
+static void
+clock_time_scheduler_arm (void)
+{
+  GSList           *li;
+  ClockTimeTimeout *timeout;
+  gint64            deadline = G_MAXINT64;
+  gint64            delay;
+#ifdef CLOCK_TIME_USE_TIMERFD
+  static gboolean   use_timerfd = TRUE;
+#endif
+
+  for (li = scheduler_timeouts; li != NULL; li = li->next)
+    {
+      timeout = li->data;
+      deadline = MIN (deadline, timeout->next);
+    }
+
+  if (scheduler_timeouts == NULL)
+    {
+      /* no clocks left, release the timer */
+      clock_time_scheduler_stop ();
+      return;
+    }
+
+#ifdef CLOCK_TIME_USE_TIMERFD
+  if (use_timerfd)
+    {
+      if (clock_time_scheduler_arm_timerfd (deadline))
+        return;
+
+      use_timerfd = FALSE;
+    }
+#endif
+
+  if (scheduler_source_id != 0)
+    g_source_remove (scheduler_source_id);
+
+  /* round up, waking up early only results in another wakeup */
+  delay = (deadline - g_get_real_time () + 999) / 1000;
+  scheduler_source_id = g_timeout_add (MAX (delay, 0),
+                                       clock_time_scheduler_timeout, NULL);
+}
+
+
+
 ClockTimeTimeout *
 clock_time_timeout_new (guint       interval,
                         ClockTime  *time,
@@ -330,8 +749,7 @@ clock_time_timeout_new (guint       interval,
 
   timeout = g_slice_new0 (ClockTimeTimeout);
   timeout->interval = 0;
-  timeout->timeout_id = 0;
-  timeout->restart = FALSE;
+  timeout->next = 0;
   timeout->time = time;
 
   timeout->time_changed_id =
@@ -340,6 +758,8 @@ clock_time_timeout_new (guint       interval,
 
   g_object_ref (G_OBJECT (timeout->time));
 
+  scheduler_timeouts = g_slist_prepend (scheduler_timeouts, timeout);
+
   clock_time_timeout_set_interval (timeout, interval);
 
   return timeout;
@@ -351,55 +771,19 @@ void
 clock_time_timeout_set_interval (ClockTimeTimeout *timeout,
                                  guint             interval)
 {
-  GDateTime *time;
-  guint      next_interval;
-  gboolean   restart;
-
   panel_return_if_fail (timeout != NULL);
   panel_return_if_fail (interval > 0);
 
-  restart = timeout->restart;
-
-  /* leave if nothing changed and we're not restarting */
-  if (!restart && timeout->interval == interval)
+  /* leave if nothing changed */
+  if (timeout->interval == interval)
     return;
   timeout->interval = interval;
-  timeout->restart = FALSE;
-
-  /* stop running timeout */
-  if (G_LIKELY (timeout->timeout_id != 0))
-    g_source_remove (timeout->timeout_id);
-  timeout->timeout_id = 0;
 
-  /* run function when not restarting */
-  if (!restart)
-    g_signal_emit (G_OBJECT (timeout->time), clock_time_signals[TIME_CHANGED], 0);
-
-  /* get the seconds to the next internal */
-  if (interval == CLOCK_INTERVAL_MINUTE)
-    {
-      time = clock_time_get_time (timeout->time);
-      next_interval = 60 - g_date_time_get_second (time);
-    }
-  else
-    {
-      next_interval = 0;
-    }
+  /* schedule the next update on the boundary of the new interval */
+  timeout->next = clock_time_timeout_next (timeout, g_get_real_time ());
+  clock_time_scheduler_arm ();
 
-  if (next_interval > 0)
-    {
-      /* start the sync timeout */
-      timeout->timeout_id = g_timeout_add_seconds_full (G_PRIORITY_DEFAULT, next_interval,
-                                                        clock_time_timeout_sync,
-                                                        timeout, NULL);
-    }
-  else
-    {
-      /* directly start running the normal timeout */
-      timeout->timeout_id = g_timeout_add_seconds_full (G_PRIORITY_DEFAULT, interval,
-                                                        clock_time_timeout_running, timeout,
-                                                        clock_time_timeout_destroyed);
-    }
+  g_signal_emit (G_OBJECT (timeout->time), clock_time_signals[TIME_CHANGED], 0);
 }
 
 
@@ -409,15 +793,14 @@ clock_time_timeout_free (ClockTimeTimeout *timeout)
 {
   panel_return_if_fail (timeout != NULL);
 
-  timeout->restart = FALSE;
+  scheduler_timeouts = g_slist_remove (scheduler_timeouts, timeout);
+  clock_time_scheduler_arm ();
 
   if (timeout->time != NULL && timeout->time_changed_id != 0)
     g_signal_handler_disconnect (timeout->time, timeout->time_changed_id);
 
   g_object_unref (G_OBJECT (timeout->time));
 
-  if (G_LIKELY (timeout->timeout_id != 0))
-    g_source_remove (timeout->timeout_id);
   g_slice_free (ClockTimeTimeout, timeout);
 }
 
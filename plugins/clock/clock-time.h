@@ -25,8 +25,13 @@
 
 G_BEGIN_DECLS
 
-#define CLOCK_INTERVAL_SECOND (1)
-#define CLOCK_INTERVAL_MINUTE (60)
+#define CLOCK_INTERVAL_SECOND     (1)
+#define CLOCK_INTERVAL_MINUTE     (60)
+#define CLOCK_INTERVAL_HOUR       (3600)
+#define CLOCK_INTERVAL_DAY        (86400)
+
+/* only update on timezone transitions (e.g. daylight saving time) */
+#define CLOCK_INTERVAL_TRANSITION (G_MAXUINT)
 
 typedef struct _ClockTime          ClockTime;
 typedef struct _ClockTimeClass     ClockTimeClass;
@@ -20,6 +20,10 @@
 #include <config.h>
 #endif
 
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
 #include <exo/exo.h>
 #include <gio/gio.h>
 #include <libxfce4ui/libxfce4ui.h>
@@ -37,6 +41,19 @@
 #include "directorymenu-dialog_ui.h"
 
 #define DEFAULT_ICON_NAME "folder"
+#define DEFAULT_CACHE_SIZE (16)
+#define ENUMERATE_BATCH   (200)
+#define ENUMERATE_ATTRS   G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME \
+                          "," G_FILE_ATTRIBUTE_STANDARD_NAME \
+                          "," G_FILE_ATTRIBUTE_STANDARD_TYPE \
+                          "," G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN \
+                          "," G_FILE_ATTRIBUTE_STANDARD_ICON
+
+/* directories with more files only get rows for a window of the listing */
+#define VIRTUAL_THRESHOLD (1000)
+#define VIRTUAL_ROWS      (150)
+#define VIRTUAL_STEP      (10)
+#define VIRTUAL_INTERVAL  (50)
 
 
 struct _DirectoryMenuPluginClass
@@ -56,20 +73,88 @@ struct _DirectoryMenuPlugin
   gchar           *file_pattern;
   guint            hidden_files : 1;
 
-  GSList          *patterns;
+  /* compiled file patterns */
+  guint            patterns_match_all : 1;
+  GHashTable      *patterns_names;
+  GHashTable      *patterns_suffixes;
+  GRegex          *patterns_globs;
+
+  /* recently used directory listings, most recent first */
+  GHashTable      *cache;
+  GQueue           cache_lru;
+  guint            cache_size;
+  guint            cache_serial;
 
   /* temp item we store here when the
    * properties dialog is opened */
   GtkWidget       *dialog_icon;
 };
 
+typedef struct
+{
+  DirectoryMenuPlugin *plugin;
+  GtkWidget           *menu;
+  GFile               *dir;
+  GCancellable        *cancellable;
+
+  /* the visible files */
+  GPtrArray           *infos;
+
+  /* cache serial when the load started */
+  guint                cache_serial;
+
+  /* placeholder while the directory is enumerated */
+  GtkWidget           *separator;
+  GtkWidget           *loading;
+}
+DirectoryMenuLoad;
+
+typedef struct
+{
+  DirectoryMenuPlugin *plugin;
+  GFile               *dir;
+
+  /* filtered and sorted files in the directory */
+  GPtrArray           *infos;
+
+  /* drop the entry when the directory changes */
+  GFileMonitor        *monitor;
+
+  /* link in the lru queue */
+  GList               *link;
+}
+DirectoryMenuCacheEntry;
+
+typedef struct
+{
+  DirectoryMenuPlugin *plugin;
+  GtkWidget           *menu;
+  GFile               *dir;
+  GPtrArray           *infos;
+
+  /* index of the first visible info and the rows of the
+   * visible infos, NULL if the info was skipped */
+  guint                offset;
+  GPtrArray           *rows;
+
+  /* items above and below the rows to move the window */
+  GtkWidget           *prev;
+  GtkWidget           *next;
+
+  /* scrolls while the prev or next item is selected */
+  guint                scroll_timeout_id;
+  gint                 scroll_step;
+}
+DirectoryMenuWindow;
+
 enum
 {
   PROP_0,
   PROP_BASE_DIRECTORY,
   PROP_ICON_NAME,
   PROP_FILE_PATTERN,
-  PROP_HIDDEN_FILES
+  PROP_HIDDEN_FILES,
+  PROP_CACHE_SIZE
 };
 
 
@@ -83,7 +168,10 @@ static void      directory_menu_plugin_set_property         (GObject
                                                              const GValue        *value,
                                                              GParamSpec          *pspec);
 static void      directory_menu_plugin_construct            (XfcePanelPlugin     *panel_plugin);
+static void      directory_menu_plugin_compile_patterns     (DirectoryMenuPlugin *plugin);
 static void      directory_menu_plugin_free_file_patterns   (DirectoryMenuPlugin *plugin);
+static void      directory_menu_plugin_cache_clear          (DirectoryMenuPlugin *plugin);
+static void      directory_menu_plugin_cache_trim           (DirectoryMenuPlugin *plugin);
 static void      directory_menu_plugin_free_data            (XfcePanelPlugin     *panel_plugin);
 static gboolean  directory_menu_plugin_size_changed         (XfcePanelPlugin     *panel_plugin,
                                                              gint                 size);
@@ -93,6 +181,8 @@ static gboolean  directory_menu_plugin_remote_event         (XfcePanelPlugin
                                                              const GValue        *value);
 static void      directory_menu_plugin_menu                 (GtkWidget           *button,
                                                              DirectoryMenuPlugin *plugin);
+static void      directory_menu_plugin_menu_load            (GtkWidget           *menu,
+                                                             DirectoryMenuPlugin *plugin);
 
 
 
@@ -102,6 +192,9 @@ XFCE_PANEL_DEFINE_PLUGIN (DirectoryMenuPlugin, directory_menu_plugin)
 
 
 static GQuark menu_file = 0;
+static GQuark menu_load = 0;
+static GQuark collate_key = 0;
+static GQuark menu_window = 0;
 
 
 static void
@@ -149,7 +242,17 @@ directory_menu_plugin_class_init (DirectoryMenuPluginClass *klass)
                                                          FALSE,
                                                          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class,
+                                   PROP_CACHE_SIZE,
+                                   g_param_spec_uint ("cache-size",
+                                                      NULL, NULL,
+                                                      0, 1024, DEFAULT_CACHE_SIZE,
+                                                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   menu_file = g_quark_from_static_string ("dir-menu-file");
+  menu_load = g_quark_from_static_string ("dir-menu-load");
+  collate_key = g_quark_from_static_string ("dir-menu-collate-key");
+  menu_window = g_quark_from_static_string ("dir-menu-window");
 }
 
 
@@ -168,6 +271,10 @@ directory_menu_plugin_init (DirectoryMenuPlugin *plugin)
   plugin->icon = gtk_image_new_from_icon_name (DEFAULT_ICON_NAME, GTK_ICON_SIZE_BUTTON);
   gtk_container_add (GTK_CONTAINER (plugin->button), plugin->icon);
   gtk_widget_show (plugin->icon);
+
+  plugin->cache = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+  g_queue_init (&plugin->cache_lru);
+  plugin->cache_size = DEFAULT_CACHE_SIZE;
 }
 
 
@@ -204,6 +311,10 @@ directory_menu_plugin_get_property (GObject    *object,
       g_value_set_boolean (value, plugin->hidden_files);
       break;
 
+    case PROP_CACHE_SIZE:
+      g_value_set_uint (value, plugin->cache_size);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -220,8 +331,6 @@ directory_menu_plugin_set_property (GObject      *object,
 {
   DirectoryMenuPlugin  *plugin = XFCE_DIRECTORY_MENU_PLUGIN (object);
   gchar                *display_name;
-  gchar               **array;
-  guint                 i;
   gint                  icon_size;
   const gchar          *path;
 
@@ -257,22 +366,20 @@ directory_menu_plugin_set_property (GObject      *object,
       g_free (plugin->file_pattern);
       plugin->file_pattern = g_value_dup_string (value);
 
-      directory_menu_plugin_free_file_patterns (plugin);
-
-      array = g_strsplit (plugin->file_pattern, ";", -1);
-      if (G_LIKELY (array != NULL))
-        {
-          for (i = 0; array[i] != NULL; i++)
-            if (!panel_str_is_empty (array[i]))
-                plugin->patterns = g_slist_prepend (plugin->patterns,
-                    g_pattern_spec_new (array[i]));
+      directory_menu_plugin_compile_patterns (plugin);
 
-          g_strfreev (array);
-        }
+      /* the cached listings are filtered */
+      directory_menu_plugin_cache_clear (plugin);
       break;
 
     case PROP_HIDDEN_FILES:
       plugin->hidden_files = g_value_get_boolean (value);
+      directory_menu_plugin_cache_clear (plugin);
+      break;
+
+    case PROP_CACHE_SIZE:
+      plugin->cache_size = g_value_get_uint (value);
+      directory_menu_plugin_cache_trim (plugin);
       break;
 
     default:
@@ -293,6 +400,7 @@ directory_menu_plugin_construct (XfcePanelPlugin *panel_plugin)
     { "icon-name", G_TYPE_STRING },
     { "file-pattern", G_TYPE_STRING },
     { "hidden-files", G_TYPE_BOOLEAN },
+    { "cache-size", G_TYPE_UINT },
     { NULL }
   };
 
@@ -314,17 +422,111 @@ directory_menu_plugin_construct (XfcePanelPlugin *panel_plugin)
 
 
 static void
-directory_menu_plugin_free_file_patterns (DirectoryMenuPlugin *plugin)
+directory_menu_plugin_compile_patterns (DirectoryMenuPlugin *plugin)
 {
-  GSList *li;
+  gchar       **array;
+  const gchar  *pattern;
+  const gchar  *p;
+  GString      *globs;
+  guint         i;
+  GError       *error = NULL;
 
   panel_return_if_fail (XFCE_IS_DIRECTORY_MENU_PLUGIN (plugin));
 
-  for (li = plugin->patterns; li != NULL; li = li->next)
-    g_pattern_spec_free (li->data);
+  directory_menu_plugin_free_file_patterns (plugin);
+
+  if (panel_str_is_empty (plugin->file_pattern))
+    return;
+
+  /* split the patterns in literal names, extensions like "*.pdf" and
+   * other globs, so matching a file does not depend on the number of
+   * patterns: the first two are a hash lookup, the globs are combined
+   * in a single regular expression */
+  globs = g_string_new (NULL);
+  array = g_strsplit (plugin->file_pattern, ";", -1);
+  for (i = 0; array[i] != NULL; i++)
+    {
+      pattern = array[i];
+      if (panel_str_is_empty (pattern))
+        continue;
+
+      if (strcmp (pattern, "*") == 0)
+        {
+          plugin->patterns_match_all = TRUE;
+        }
+      else if (strpbrk (pattern, "*?") == NULL)
+        {
+          if (plugin->patterns_names == NULL)
+            plugin->patterns_names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+          g_hash_table_add (plugin->patterns_names, g_strdup (pattern));
+        }
+      else if (pattern[0] == '*' && pattern[1] == '.'
+               && strpbrk (pattern + 1, "*?") == NULL)
+        {
+          if (plugin->patterns_suffixes == NULL)
+            plugin->patterns_suffixes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+          g_hash_table_add (plugin->patterns_suffixes, g_strdup (pattern + 1));
+        }
+      else
+        {
+          g_string_append (globs, globs->len == 0 ? "(?:" : "|");
+          for (p = pattern; *p != '\0'; p = g_utf8_next_char (p))
+            {
+              if (*p == '*')
+                g_string_append (globs, ".*");
+              else if (*p == '?')
+                g_string_append_c (globs, '.');
+              else if (g_ascii_isalnum (*p) || (guchar) *p >= 0x80)
+                g_string_append_len (globs, p, g_utf8_next_char (p) - p);
+              else
+                g_string_append_printf (globs, "\\x{%x}", (guint) *p);
+            }
+        }
+    }
+  g_strfreev (array);
 
-  g_slist_free (plugin->patterns);
-  plugin->patterns = NULL;
+  if (globs->len > 0)
+    {
+      g_string_append (globs, ")\\z");
+      plugin->patterns_globs = g_regex_new (globs->str,
+                                            G_REGEX_ANCHORED | G_REGEX_DOTALL
+                                            | G_REGEX_OPTIMIZE,
+                                            0, &error);
+      if (G_UNLIKELY (plugin->patterns_globs == NULL))
+        {
+          g_warning ("Failed to compile file patterns: %s", error->message);
+          g_error_free (error);
+        }
+    }
+  g_string_free (globs, TRUE);
+}
+
+
+
+static void
+directory_menu_plugin_free_file_patterns (DirectoryMenuPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_DIRECTORY_MENU_PLUGIN (plugin));
+
+  plugin->patterns_match_all = FALSE;
+
+  if (plugin->patterns_names != NULL)
+    {
+      g_hash_table_destroy (plugin->patterns_names);
+      plugin->patterns_names = NULL;
+    }
+
+  if (plugin->patterns_suffixes != NULL)
+    {
+      g_hash_table_destroy (plugin->patterns_suffixes);
+      plugin->patterns_suffixes = NULL;
+    }
+
+  if (plugin->patterns_globs != NULL)
+    {
+      g_regex_unref (plugin->patterns_globs);
+      plugin->patterns_globs = NULL;
+    }
 }
 
 
@@ -339,6 +541,9 @@ directory_menu_plugin_free_data (XfcePanelPlugin *panel_plugin)
   g_free (plugin->file_pattern);
 
   directory_menu_plugin_free_file_patterns (plugin);
+
+  directory_menu_plugin_cache_clear (plugin);
+  g_hash_table_destroy (plugin->cache);
 }
 
 
@@ -519,12 +724,14 @@ directory_menu_plugin_selection_done (GtkWidget *menu,
 
 
 static gint
-directory_menu_plugin_menu_sort (gconstpointer a,
-                                 gconstpointer b)
+directory_menu_plugin_menu_sort (gconstpointer ptr_a,
+                                 gconstpointer ptr_b)
 {
-  GFileType type_a = g_file_info_get_file_type (G_FILE_INFO (a));
-  GFileType type_b = g_file_info_get_file_type (G_FILE_INFO (b));
-  gboolean  hidden_a, hidden_b;
+  GFileInfo *a = *((GFileInfo **) ptr_a);
+  GFileInfo *b = *((GFileInfo **) ptr_b);
+  GFileType  type_a = g_file_info_get_file_type (a);
+  GFileType  type_b = g_file_info_get_file_type (b);
+  gboolean   hidden_a, hidden_b;
 
   if (type_a != type_b)
     {
@@ -535,15 +742,16 @@ directory_menu_plugin_menu_sort (gconstpointer a,
         return 1;
     }
 
-  hidden_a = g_file_info_get_is_hidden (G_FILE_INFO (a));
-  hidden_b = g_file_info_get_is_hidden (G_FILE_INFO (b));
+  hidden_a = g_file_info_get_is_hidden (a);
+  hidden_b = g_file_info_get_is_hidden (b);
 
   /* sort hidden files above 'normal' files */
   if (hidden_a != hidden_b)
     return hidden_a ? -1 : 1;
 
-  return g_utf8_collate (g_file_info_get_display_name (G_FILE_INFO (a)),
-                         g_file_info_get_display_name (G_FILE_INFO (b)));
+  /* the collate keys are created once when the file is added */
+  return strcmp (g_object_get_qdata (G_OBJECT (a), collate_key),
+                 g_object_get_qdata (G_OBJECT (b), collate_key));
 }
 
 
@@ -759,9 +967,133 @@ directory_menu_plugin_menu_open_folder (GtkWidget *mi,
 
 
 
+static void
+directory_menu_plugin_cache_remove (DirectoryMenuCacheEntry *entry)
+{
+  DirectoryMenuPlugin *plugin = entry->plugin;
+
+  g_hash_table_remove (plugin->cache, entry->dir);
+  g_queue_delete_link (&plugin->cache_lru, entry->link);
+
+  g_file_monitor_cancel (entry->monitor);
+  g_object_unref (G_OBJECT (entry->monitor));
+  g_object_unref (G_OBJECT (entry->dir));
+  g_ptr_array_unref (entry->infos);
+  g_slice_free (DirectoryMenuCacheEntry, entry);
+}
+
+
+
+static void
+directory_menu_plugin_cache_changed (GFileMonitor            *monitor,
+                                     GFile                   *file,
+                                     GFile                   *other_file,
+                                     GFileMonitorEvent        event_type,
+                                     DirectoryMenuCacheEntry *entry)
+{
+  /* attribute changes don't affect the listing */
+  if (event_type == G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT
+      || event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED
+      || event_type == G_FILE_MONITOR_EVENT_CHANGED)
+    return;
+
+  directory_menu_plugin_cache_remove (entry);
+}
+
+
+
+static void
+directory_menu_plugin_cache_trim (DirectoryMenuPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_DIRECTORY_MENU_PLUGIN (plugin));
+
+  /* drop the least recently used listings */
+  while (g_queue_get_length (&plugin->cache_lru) > plugin->cache_size)
+    directory_menu_plugin_cache_remove (g_queue_peek_tail (&plugin->cache_lru));
+}
+
+
+
+static void
+directory_menu_plugin_cache_clear (DirectoryMenuPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_DIRECTORY_MENU_PLUGIN (plugin));
+
+  while (!g_queue_is_empty (&plugin->cache_lru))
+    directory_menu_plugin_cache_remove (g_queue_peek_head (&plugin->cache_lru));
+
+  /* loads that are still running have the old settings */
+  plugin->cache_serial++;
+}
+
+
+
+static GPtrArray *
+directory_menu_plugin_cache_lookup (DirectoryMenuPlugin *plugin,
+                                    GFile               *dir)
+{
+  DirectoryMenuCacheEntry *entry;
+
+  entry = g_hash_table_lookup (plugin->cache, dir);
+  if (entry == NULL)
+    return NULL;
+
+  /* move to the front of the queue */
+  g_queue_unlink (&plugin->cache_lru, entry->link);
+  g_queue_push_head_link (&plugin->cache_lru, entry->link);
+
+  return entry->infos;
+}
+
+
+
+static void
+directory_menu_plugin_cache_insert (DirectoryMenuPlugin *plugin,
+                                    GFile               *dir,
+                                    GPtrArray           *infos)
+{
+  DirectoryMenuCacheEntry *entry;
+  GFileMonitor            *monitor;
+
+  if (plugin->cache_size == 0
+      || g_hash_table_contains (plugin->cache, dir))
+    return;
+
+  /* only cache if we get notified about changes */
+  monitor = g_file_monitor_directory (dir, G_FILE_MONITOR_NONE, NULL, NULL);
+  if (G_UNLIKELY (monitor == NULL))
+    return;
+
+  entry = g_slice_new0 (DirectoryMenuCacheEntry);
+  entry->plugin = plugin;
+  entry->dir = g_object_ref (G_OBJECT (dir));
+  entry->infos = g_ptr_array_ref (infos);
+  entry->monitor = monitor;
+  g_signal_connect (G_OBJECT (monitor), "changed",
+      G_CALLBACK (directory_menu_plugin_cache_changed), entry);
+
+  g_queue_push_head (&plugin->cache_lru, entry);
+  entry->link = g_queue_peek_head_link (&plugin->cache_lru);
+  g_hash_table_insert (plugin->cache, entry->dir, entry);
+
+  directory_menu_plugin_cache_trim (plugin);
+}
+
+
+
 static void
 directory_menu_plugin_menu_unload (GtkWidget *menu)
 {
+  DirectoryMenuLoad *load;
+
+  /* stop enumerating the directory, the callback releases the load */
+  load = g_object_steal_qdata (G_OBJECT (menu), menu_load);
+  if (load != NULL)
+    g_cancellable_cancel (load->cancellable);
+
+  /* release the listing of a huge directory */
+  g_object_set_qdata (G_OBJECT (menu), menu_window, NULL);
+
   /* delay destruction so we can handle the activate event first */
   gtk_container_foreach (GTK_CONTAINER (menu),
      (GtkCallback) panel_utils_destroy_later, NULL);
@@ -769,28 +1101,609 @@ directory_menu_plugin_menu_unload (GtkWidget *menu)
 
 
 
-static void
-directory_menu_plugin_menu_load (GtkWidget           *menu,
-                                 DirectoryMenuPlugin *plugin)
+static gboolean
+directory_menu_plugin_menu_visible (DirectoryMenuPlugin *plugin,
+                                    GFileInfo           *info)
+{
+  const gchar *display_name;
+  const gchar *p;
+
+  /* skip hidden files if disabled by the user */
+  if (!plugin->hidden_files
+      && g_file_info_get_is_hidden (info))
+    return FALSE;
+
+  /* directories are always shown */
+  if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+    return TRUE;
+
+  /* if the file is not a directory, check the file patterns */
+  display_name = g_file_info_get_display_name (info);
+  if (G_UNLIKELY (display_name == NULL))
+    return FALSE;
+
+  if (plugin->patterns_match_all)
+    return TRUE;
+
+  if (plugin->patterns_names != NULL
+      && g_hash_table_contains (plugin->patterns_names, display_name))
+    return TRUE;
+
+  /* try every extension, so "*.gz" and "*.tar.gz" both match */
+  if (plugin->patterns_suffixes != NULL)
+    for (p = strchr (display_name, '.'); p != NULL; p = strchr (p + 1, '.'))
+      if (g_hash_table_contains (plugin->patterns_suffixes, p))
+        return TRUE;
+
+  if (plugin->patterns_globs != NULL)
+    return g_regex_match (plugin->patterns_globs, display_name, 0, NULL);
+
+  return FALSE;
+}
+
+
+
+static GtkWidget *
+directory_menu_plugin_menu_add_info (GtkWidget           *menu,
+                                     GFile               *dir,
+                                     GFileInfo           *info,
+                                     DirectoryMenuPlugin *plugin,
+                                     gint                 position)
 {
-  GFileEnumerator *iter;
-  GFileInfo       *info;
   GtkWidget       *mi;
   const gchar     *display_name;
-  GSList          *li, *infos = NULL;
-  GIcon           *icon;
+  GIcon           *icon = NULL;
   GtkWidget       *image;
   GtkWidget       *submenu;
   GFile           *file;
-  GFile           *dir;
-  gboolean         visible;
   GFileType        file_type;
 #ifdef HAVE_GIO_UNIX
-  GDesktopAppInfo *desktopinfo;
+  GDesktopAppInfo *desktopinfo = NULL;
   gchar           *path;
   const gchar     *description;
 #endif
 
+  file_type = g_file_info_get_file_type (info);
+
+  display_name = g_file_info_get_display_name (info);
+  if (G_UNLIKELY (display_name == NULL))
+    return NULL;
+
+  file = g_file_get_child (dir, g_file_info_get_name (info));
+
+#ifdef HAVE_GIO_UNIX
+  /* for native desktop files we make an exception and try
+   * to load them like a normal menu */
+  if (G_UNLIKELY (file_type != G_FILE_TYPE_DIRECTORY
+      && g_file_is_native (file)
+      && g_str_has_suffix (display_name, ".desktop")))
+    {
+      path = g_file_get_path (file);
+      desktopinfo = g_desktop_app_info_new_from_filename (path);
+      g_free (path);
+
+      if (G_LIKELY (desktopinfo != NULL))
+        {
+          display_name = g_app_info_get_name (G_APP_INFO (desktopinfo));
+          icon = g_app_info_get_icon (G_APP_INFO (desktopinfo));
+
+          /* ignore invalid or hidden files */
+          if (panel_str_is_empty (display_name)
+              || g_desktop_app_info_get_is_hidden (desktopinfo))
+            {
+              g_object_unref (G_OBJECT (desktopinfo));
+              g_object_unref (G_OBJECT (file));
+              return NULL;
+            }
+        }
+    }
+#endif
+
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  mi = gtk_image_menu_item_new_with_label (display_name);
+G_GNUC_END_IGNORE_DEPRECATIONS
+  gtk_menu_shell_insert (GTK_MENU_SHELL (menu), mi, position);
+  gtk_widget_show (mi);
+
+  if (G_LIKELY (icon == NULL))
+    icon = g_file_info_get_icon (info);
+  if (G_LIKELY (icon != NULL))
+    {
+      image = gtk_image_new_from_gicon (icon, GTK_ICON_SIZE_MENU);
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+      gtk_image_menu_item_set_image (GTK_IMAGE_MENU_ITEM (mi), image);
+G_GNUC_END_IGNORE_DEPRECATIONS
+      gtk_widget_show (image);
+    }
+
+  /* set a submenu for directories */
+  if (G_LIKELY (file_type == G_FILE_TYPE_DIRECTORY))
+    {
+      submenu = gtk_menu_new ();
+      gtk_menu_item_set_submenu (GTK_MENU_ITEM (mi), submenu);
+      g_object_set_qdata_full (G_OBJECT (submenu), menu_file, file, g_object_unref);
+
+      g_signal_connect (G_OBJECT (submenu), "show",
+          G_CALLBACK (directory_menu_plugin_menu_load), plugin);
+      g_signal_connect_after (G_OBJECT (submenu), "hide",
+          G_CALLBACK (directory_menu_plugin_menu_unload), NULL);
+    }
+#ifdef HAVE_GIO_UNIX
+  else if (G_UNLIKELY (desktopinfo != NULL))
+    {
+      description = g_app_info_get_description (G_APP_INFO (desktopinfo));
+      if (!panel_str_is_empty (description))
+        gtk_widget_set_tooltip_text (mi, description);
+
+      g_signal_connect_data (G_OBJECT (mi), "activate",
+          G_CALLBACK (directory_menu_plugin_menu_launch_desktop_file),
+          desktopinfo, (GClosureNotify) g_object_unref, 0);
+
+      g_object_unref (G_OBJECT (file));
+    }
+#endif
+  else
+    {
+      g_signal_connect_data (G_OBJECT (mi), "activate",
+          G_CALLBACK (directory_menu_plugin_menu_launch), file,
+          (GClosureNotify) g_object_unref, 0);
+    }
+
+  return mi;
+}
+
+
+
+static gint
+directory_menu_plugin_menu_window_position (DirectoryMenuWindow *window,
+                                            GtkWidget           *item)
+{
+  GList *children;
+  gint   position;
+
+  children = gtk_container_get_children (GTK_CONTAINER (window->menu));
+  position = g_list_index (children, item);
+  g_list_free (children);
+
+  return position;
+}
+
+
+
+static void
+directory_menu_plugin_menu_window_update (DirectoryMenuWindow *window)
+{
+  guint  n;
+  gchar *label;
+
+  n = window->offset;
+  label = g_strdup_printf (ngettext ("%u more item", "%u more items", n), n);
+  gtk_menu_item_set_label (GTK_MENU_ITEM (window->prev), label);
+  gtk_widget_set_sensitive (window->prev, n > 0);
+  g_free (label);
+
+  n = window->infos->len - window->offset - window->rows->len;
+  label = g_strdup_printf (ngettext ("%u more item", "%u more items", n), n);
+  gtk_menu_item_set_label (GTK_MENU_ITEM (window->next), label);
+  gtk_widget_set_sensitive (window->next, n > 0);
+  g_free (label);
+}
+
+
+
+static void
+directory_menu_plugin_menu_window_scroll (DirectoryMenuWindow *window,
+                                          gint                 delta)
+{
+  guint      n_rows = window->rows->len;
+  guint      offset;
+  guint      i, n;
+  gint       position;
+  GtkWidget *row;
+
+  offset = CLAMP ((gint) window->offset + delta, 0,
+                  (gint) (window->infos->len - n_rows));
+  if (offset == window->offset)
+    return;
+
+  if (offset > window->offset)
+    {
+      /* destroy the rows that scrolled out at the top */
+      n = MIN (offset - window->offset, n_rows);
+      for (i = 0; i < n; i++)
+        if ((row = g_ptr_array_index (window->rows, i)) != NULL)
+          gtk_widget_destroy (row);
+      g_ptr_array_remove_range (window->rows, 0, n);
+
+      /* append the new rows above the next item */
+      position = directory_menu_plugin_menu_window_position (window, window->next);
+      for (i = MAX (window->offset + n_rows, offset); i < offset + n_rows; i++)
+        {
+          row = directory_menu_plugin_menu_add_info (window->menu, window->dir,
+                                                     g_ptr_array_index (window->infos, i),
+                                                     window->plugin, position);
+          if (row != NULL)
+            position++;
+          g_ptr_array_add (window->rows, row);
+        }
+    }
+  else
+    {
+      /* destroy the rows that scrolled out at the bottom */
+      n = MIN (window->offset - offset, n_rows);
+      for (i = n_rows - n; i < n_rows; i++)
+        if ((row = g_ptr_array_index (window->rows, i)) != NULL)
+          gtk_widget_destroy (row);
+      g_ptr_array_remove_range (window->rows, n_rows - n, n);
+
+      /* prepend the new rows below the previous item */
+      position = directory_menu_plugin_menu_window_position (window, window->prev) + 1;
+      for (i = offset; i < MIN (window->offset, offset + n_rows); i++)
+        {
+          row = directory_menu_plugin_menu_add_info (window->menu, window->dir,
+                                                     g_ptr_array_index (window->infos, i),
+                                                     window->plugin, position);
+          if (row != NULL)
+            position++;
+          g_ptr_array_insert (window->rows, i - offset, row);
+        }
+    }
+
+  window->offset = offset;
+  directory_menu_plugin_menu_window_update (window);
+
+  if (gtk_widget_get_visible (window->menu))
+    gtk_menu_reposition (GTK_MENU (window->menu));
+}
+
+
+
+static gboolean
+directory_menu_plugin_menu_window_scroll_timeout (gpointer data)
+{
+  DirectoryMenuWindow *window = data;
+  guint                offset = window->offset;
+
+  directory_menu_plugin_menu_window_scroll (window, window->scroll_step);
+
+  /* stop at the start or end of the listing */
+  return window->offset != offset;
+}
+
+
+
+static void
+directory_menu_plugin_menu_window_scroll_timeout_destroyed (gpointer data)
+{
+  ((DirectoryMenuWindow *) data)->scroll_timeout_id = 0;
+}
+
+
+
+static void
+directory_menu_plugin_menu_window_select (GtkWidget           *item,
+                                          DirectoryMenuWindow *window)
+{
+  /* keep scrolling while the item is selected, like the menu arrows */
+  window->scroll_step = item == window->prev ? -VIRTUAL_STEP : VIRTUAL_STEP;
+  if (window->scroll_timeout_id == 0)
+    window->scroll_timeout_id = gdk_threads_add_timeout_full (G_PRIORITY_DEFAULT_IDLE,
+        VIRTUAL_INTERVAL, directory_menu_plugin_menu_window_scroll_timeout, window,
+        directory_menu_plugin_menu_window_scroll_timeout_destroyed);
+}
+
+
+
+static void
+directory_menu_plugin_menu_window_deselect (GtkWidget           *item,
+                                            DirectoryMenuWindow *window)
+{
+  if (window->scroll_timeout_id != 0)
+    g_source_remove (window->scroll_timeout_id);
+}
+
+
+
+static gboolean
+directory_menu_plugin_menu_window_button_release (GtkWidget           *item,
+                                                  GdkEventButton      *event,
+                                                  DirectoryMenuWindow *window)
+{
+  /* jump a whole window instead of closing the menu */
+  if (item == window->prev)
+    directory_menu_plugin_menu_window_scroll (window, -VIRTUAL_ROWS);
+  else
+    directory_menu_plugin_menu_window_scroll (window, VIRTUAL_ROWS);
+
+  return TRUE;
+}
+
+
+
+static void
+directory_menu_plugin_menu_window_free (gpointer data)
+{
+  DirectoryMenuWindow *window = data;
+
+  if (window->scroll_timeout_id != 0)
+    g_source_remove (window->scroll_timeout_id);
+
+  /* the items are destroyed later */
+  g_signal_handlers_disconnect_by_data (G_OBJECT (window->prev), window);
+  g_signal_handlers_disconnect_by_data (G_OBJECT (window->next), window);
+  g_object_unref (G_OBJECT (window->prev));
+  g_object_unref (G_OBJECT (window->next));
+
+  g_object_unref (G_OBJECT (window->dir));
+  g_ptr_array_unref (window->infos);
+  g_ptr_array_free (window->rows, TRUE);
+  g_slice_free (DirectoryMenuWindow, window);
+}
+
+
+
+static GtkWidget *
+directory_menu_plugin_menu_window_item (DirectoryMenuWindow *window,
+                                        const gchar         *icon_name)
+{
+  GtkWidget *mi;
+  GtkWidget *image;
+
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  mi = gtk_image_menu_item_new_with_label ("");
+G_GNUC_END_IGNORE_DEPRECATIONS
+  gtk_menu_shell_append (GTK_MENU_SHELL (window->menu), mi);
+  gtk_widget_show (mi);
+
+  image = gtk_image_new_from_icon_name (icon_name, GTK_ICON_SIZE_MENU);
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  gtk_image_menu_item_set_image (GTK_IMAGE_MENU_ITEM (mi), image);
+G_GNUC_END_IGNORE_DEPRECATIONS
+  gtk_widget_show (image);
+
+  /* the window data is released after the menu items are destroyed */
+  g_object_ref (G_OBJECT (mi));
+
+  g_signal_connect (G_OBJECT (mi), "select",
+      G_CALLBACK (directory_menu_plugin_menu_window_select), window);
+  g_signal_connect (G_OBJECT (mi), "deselect",
+      G_CALLBACK (directory_menu_plugin_menu_window_deselect), window);
+  g_signal_connect (G_OBJECT (mi), "button-release-event",
+      G_CALLBACK (directory_menu_plugin_menu_window_button_release), window);
+
+  return mi;
+}
+
+
+
+static void
+directory_menu_plugin_menu_window_new (GtkWidget           *menu,
+                                       GFile               *dir,
+                                       GPtrArray           *infos,
+                                       DirectoryMenuPlugin *plugin)
+{
+  DirectoryMenuWindow *window;
+  GtkWidget           *row;
+  guint                i;
+
+  window = g_slice_new0 (DirectoryMenuWindow);
+  window->plugin = plugin;
+  window->menu = menu;
+  window->dir = g_object_ref (G_OBJECT (dir));
+  window->infos = g_ptr_array_ref (infos);
+  window->rows = g_ptr_array_sized_new (VIRTUAL_ROWS);
+
+  /* only create rows, and thus load icons, for the first window,
+   * the others are created while scrolling */
+  window->prev = directory_menu_plugin_menu_window_item (window, "go-up");
+  for (i = 0; i < VIRTUAL_ROWS; i++)
+    {
+      row = directory_menu_plugin_menu_add_info (menu, dir,
+                                                 g_ptr_array_index (infos, i),
+                                                 plugin, -1);
+      g_ptr_array_add (window->rows, row);
+    }
+  window->next = directory_menu_plugin_menu_window_item (window, "go-down");
+
+  directory_menu_plugin_menu_window_update (window);
+
+  g_object_set_qdata_full (G_OBJECT (menu), menu_window, window,
+                           directory_menu_plugin_menu_window_free);
+}
+
+
+
+static void
+directory_menu_plugin_menu_load_free (DirectoryMenuLoad *load)
+{
+  /* the menu can be destroyed when the load was cancelled */
+  if (!g_cancellable_is_cancelled (load->cancellable))
+    g_object_steal_qdata (G_OBJECT (load->menu), menu_load);
+
+  g_object_unref (G_OBJECT (load->cancellable));
+  g_object_unref (G_OBJECT (load->dir));
+  g_ptr_array_unref (load->infos);
+  g_slice_free (DirectoryMenuLoad, load);
+}
+
+
+
+static void
+directory_menu_plugin_menu_add_infos (GtkWidget           *menu,
+                                      GFile               *dir,
+                                      GPtrArray           *infos,
+                                      DirectoryMenuPlugin *plugin)
+{
+  guint i;
+
+  /* thousands of widgets make the menu slow, so only show a window */
+  if (infos->len > VIRTUAL_THRESHOLD)
+    {
+      directory_menu_plugin_menu_window_new (menu, dir, infos, plugin);
+      return;
+    }
+
+  for (i = 0; i < infos->len; i++)
+    directory_menu_plugin_menu_add_info (menu, dir, g_ptr_array_index (infos, i), plugin, -1);
+}
+
+
+
+static void
+directory_menu_plugin_menu_load_finished (DirectoryMenuLoad *load,
+                                          gboolean           succeed)
+{
+  gtk_widget_destroy (load->loading);
+
+  /* sort once at the end */
+  g_ptr_array_sort (load->infos, directory_menu_plugin_menu_sort);
+
+  /* remember the listing if the filter did not change meanwhile */
+  if (succeed && load->cache_serial == load->plugin->cache_serial)
+    directory_menu_plugin_cache_insert (load->plugin, load->dir, load->infos);
+
+  if (load->infos->len > 0)
+    directory_menu_plugin_menu_add_infos (load->menu, load->dir, load->infos, load->plugin);
+  else
+    gtk_widget_destroy (load->separator);
+
+  /* the menu size changed */
+  if (gtk_widget_get_visible (load->menu))
+    gtk_menu_reposition (GTK_MENU (load->menu));
+}
+
+
+
+static void
+directory_menu_plugin_menu_load_next_files (GObject      *source_object,
+                                            GAsyncResult *result,
+                                            gpointer      user_data)
+{
+  GFileEnumerator   *iter = G_FILE_ENUMERATOR (source_object);
+  DirectoryMenuLoad *load = user_data;
+  GList             *infos, *li;
+  GFileInfo         *info;
+  gchar             *key;
+  gchar             *label;
+  GError            *error = NULL;
+
+  infos = g_file_enumerator_next_files_finish (iter, result, &error);
+
+  if (g_cancellable_is_cancelled (load->cancellable))
+    {
+      g_list_free_full (infos, g_object_unref);
+      if (error != NULL)
+        g_error_free (error);
+
+      directory_menu_plugin_menu_load_free (load);
+      return;
+    }
+
+  /* done, or an error occurred */
+  if (infos == NULL)
+    {
+      directory_menu_plugin_menu_load_finished (load, error == NULL);
+
+      if (G_UNLIKELY (error != NULL))
+        {
+          g_warning ("Failed to enumerate directory: %s", error->message);
+          g_error_free (error);
+        }
+
+      directory_menu_plugin_menu_load_free (load);
+      return;
+    }
+
+  for (li = infos; li != NULL; li = li->next)
+    {
+      info = G_FILE_INFO (li->data);
+      if (directory_menu_plugin_menu_visible (load->plugin, info))
+        {
+          key = g_utf8_collate_key_for_filename (g_file_info_get_display_name (info), -1);
+          g_object_set_qdata_full (G_OBJECT (info), collate_key, key, g_free);
+          g_ptr_array_add (load->infos, info);
+        }
+      else
+        {
+          g_object_unref (G_OBJECT (info));
+        }
+    }
+  g_list_free (infos);
+
+  /* show the progress */
+  label = g_strdup_printf (_("Loading... (%u)"), load->infos->len);
+  gtk_menu_item_set_label (GTK_MENU_ITEM (load->loading), label);
+  g_free (label);
+
+  g_file_enumerator_next_files_async (iter, ENUMERATE_BATCH, G_PRIORITY_DEFAULT,
+                                      load->cancellable,
+                                      directory_menu_plugin_menu_load_next_files,
+                                      load);
+}
+
+
+
+static void
+directory_menu_plugin_menu_load_enumerate (GObject      *source_object,
+                                           GAsyncResult *result,
+                                           gpointer      user_data)
+{
+  DirectoryMenuLoad *load = user_data;
+  GFileEnumerator   *iter;
+  GError            *error = NULL;
+
+  iter = g_file_enumerate_children_finish (G_FILE (source_object), result, &error);
+
+  if (g_cancellable_is_cancelled (load->cancellable)
+      || G_UNLIKELY (iter == NULL))
+    {
+      if (iter == NULL
+          && !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to enumerate directory: %s", error->message);
+
+      /* the menu is already destroyed when the load was cancelled */
+      if (!g_cancellable_is_cancelled (load->cancellable))
+        directory_menu_plugin_menu_load_finished (load, FALSE);
+
+      if (error != NULL)
+        g_error_free (error);
+      if (iter != NULL)
+        g_object_unref (G_OBJECT (iter));
+
+      directory_menu_plugin_menu_load_free (load);
+      return;
+    }
+
+  g_file_enumerator_next_files_async (iter, ENUMERATE_BATCH, G_PRIORITY_DEFAULT,
+                                      load->cancellable,
+                                      directory_menu_plugin_menu_load_next_files,
+                                      load);
+  g_object_unref (G_OBJECT (iter));
+}
+
+
+
+static void
+directory_menu_plugin_menu_load_cancel (gpointer data)
+{
+  DirectoryMenuLoad *load = data;
+
+  /* the menu is destroyed, the callback will release the load */
+  g_cancellable_cancel (load->cancellable);
+}
+
+
+
+static void
+directory_menu_plugin_menu_load (GtkWidget           *menu,
+                                 DirectoryMenuPlugin *plugin)
+{
+  GtkWidget         *mi;
+  GtkWidget         *image;
+  GFile             *dir;
+  DirectoryMenuLoad *load;
+  GPtrArray         *infos;
+
   panel_return_if_fail (XFCE_IS_DIRECTORY_MENU_PLUGIN (plugin));
   panel_return_if_fail (GTK_IS_MENU (menu));
 
@@ -829,163 +1742,50 @@ G_GNUC_BEGIN_IGNORE_DEPRECATIONS
 G_GNUC_END_IGNORE_DEPRECATIONS
   gtk_widget_show (image);
 
-  iter = g_file_enumerate_children (dir, G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME
-                                    "," G_FILE_ATTRIBUTE_STANDARD_NAME
-                                    "," G_FILE_ATTRIBUTE_STANDARD_TYPE
-                                    "," G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN
-                                    "," G_FILE_ATTRIBUTE_STANDARD_ICON,
-                                    G_FILE_QUERY_INFO_NONE, NULL, NULL);
-  if (G_LIKELY (iter != NULL))
+  /* use the listing from the cache, if the directory did not change */
+  infos = directory_menu_plugin_cache_lookup (plugin, dir);
+  if (infos != NULL)
     {
-      for (;;)
-        {
-          info = g_file_enumerator_next_file (iter, NULL, NULL);
-          if (G_UNLIKELY (info == NULL))
-            break;
-
-          /* skip hidden files if disabled by the user */
-          if (!plugin->hidden_files
-              && g_file_info_get_is_hidden (info))
-            {
-              g_object_unref (G_OBJECT (info));
-              continue;
-            }
-
-          /* if the file is not a directory, check the file patterns */
-          if (g_file_info_get_file_type (info) != G_FILE_TYPE_DIRECTORY)
-            {
-              if (plugin->patterns == NULL)
-                {
-                  g_object_unref (G_OBJECT (info));
-                  continue;
-                }
-
-              visible = FALSE;
-              display_name = g_file_info_get_display_name (info);
-              if (G_LIKELY (display_name != NULL))
-                for (li = plugin->patterns; !visible && li != NULL; li = li->next)
-                   if (g_pattern_match_string (li->data, display_name))
-                     visible = TRUE;
-
-              if (!visible)
-                {
-                  g_object_unref (G_OBJECT (info));
-                  continue;
-                }
-            }
-
-          infos = g_slist_insert_sorted (infos, info, directory_menu_plugin_menu_sort);
-        }
-
-      g_object_unref (G_OBJECT (iter));
-
-      if (G_LIKELY (infos != NULL))
+      if (infos->len > 0)
         {
           mi = gtk_separator_menu_item_new ();
           gtk_menu_shell_append (GTK_MENU_SHELL (menu), mi);
           gtk_widget_show (mi);
-        }
-
-      for (li = infos; li != NULL; li = li->next)
-        {
-          info = G_FILE_INFO (li->data);
-          file_type = g_file_info_get_file_type (info);
-
-          display_name = g_file_info_get_display_name (info);
-          if (G_UNLIKELY (display_name == NULL))
-            {
-              g_object_unref (G_OBJECT (info));
-              continue;
-            }
-
-          file = g_file_get_child (dir, g_file_info_get_name (info));
-          icon = NULL;
-
-#ifdef HAVE_GIO_UNIX
-          /* for native desktop files we make an exception and try
-           * to load them like a normal menu */
-          desktopinfo = NULL;
-          if (G_UNLIKELY (file_type != G_FILE_TYPE_DIRECTORY
-              && g_file_is_native (file)
-              && g_str_has_suffix (display_name, ".desktop")))
-            {
-              path = g_file_get_path (file);
-              desktopinfo = g_desktop_app_info_new_from_filename (path);
-              g_free (path);
-
-              if (G_LIKELY (desktopinfo != NULL))
-                {
-                  display_name = g_app_info_get_name (G_APP_INFO (desktopinfo));
-                  icon = g_app_info_get_icon (G_APP_INFO (desktopinfo));
-
-                  /* ignore invalid or hidden files */
-                  if (panel_str_is_empty (display_name)
-                      || g_desktop_app_info_get_is_hidden (desktopinfo))
-                    {
-                      g_object_unref (G_OBJECT (desktopinfo));
-                      g_object_unref (G_OBJECT (info));
-                      g_object_unref (G_OBJECT (file));
-                      continue;
-                    }
-                }
-            }
-#endif
-
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-          mi = gtk_image_menu_item_new_with_label (display_name);
-G_GNUC_END_IGNORE_DEPRECATIONS
-          gtk_menu_shell_append (GTK_MENU_SHELL (menu), mi);
-          gtk_widget_show (mi);
-
-          if (G_LIKELY (icon == NULL))
-            icon = g_file_info_get_icon (info);
-          if (G_LIKELY (icon != NULL))
-            {
-              image = gtk_image_new_from_gicon (icon, GTK_ICON_SIZE_MENU);
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-              gtk_image_menu_item_set_image (GTK_IMAGE_MENU_ITEM (mi), image);
-G_GNUC_END_IGNORE_DEPRECATIONS
-              gtk_widget_show (image);
-            }
-
-          /* set a submenu for directories */
-          if (G_LIKELY (file_type == G_FILE_TYPE_DIRECTORY))
-            {
-              submenu = gtk_menu_new ();
-              gtk_menu_item_set_submenu (GTK_MENU_ITEM (mi), submenu);
-              g_object_set_qdata_full (G_OBJECT (submenu), menu_file, file, g_object_unref);
-
-              g_signal_connect (G_OBJECT (submenu), "show",
-                  G_CALLBACK (directory_menu_plugin_menu_load), plugin);
-              g_signal_connect_after (G_OBJECT (submenu), "hide",
-                  G_CALLBACK (directory_menu_plugin_menu_unload), NULL);
-            }
-#ifdef HAVE_GIO_UNIX
-          else if (G_UNLIKELY (desktopinfo != NULL))
-            {
-              description = g_app_info_get_description (G_APP_INFO (desktopinfo));
-              if (!panel_str_is_empty (description))
-                gtk_widget_set_tooltip_text (mi, description);
 
-              g_signal_connect_data (G_OBJECT (mi), "activate",
-                  G_CALLBACK (directory_menu_plugin_menu_launch_desktop_file),
-                  desktopinfo, (GClosureNotify) g_object_unref, 0);
-
-              g_object_unref (G_OBJECT (file));
-            }
-#endif
-          else
-            {
-              g_signal_connect_data (G_OBJECT (mi), "activate",
-                  G_CALLBACK (directory_menu_plugin_menu_launch), file,
-                  (GClosureNotify) g_object_unref, 0);
-            }
-
-          g_object_unref (G_OBJECT (info));
+          directory_menu_plugin_menu_add_infos (menu, dir, infos, plugin);
         }
 
-      g_slist_free (infos);
+      return;
     }
+
+  load = g_slice_new0 (DirectoryMenuLoad);
+  load->plugin = plugin;
+  load->menu = menu;
+  load->dir = g_object_ref (G_OBJECT (dir));
+  load->cancellable = g_cancellable_new ();
+  load->infos = g_ptr_array_new_with_free_func (g_object_unref);
+  load->cache_serial = plugin->cache_serial;
+
+  load->separator = gtk_separator_menu_item_new ();
+  gtk_menu_shell_append (GTK_MENU_SHELL (menu), load->separator);
+  gtk_widget_show (load->separator);
+
+  load->loading = gtk_menu_item_new_with_label (_("Loading..."));
+  gtk_widget_set_sensitive (load->loading, FALSE);
+  gtk_menu_shell_append (GTK_MENU_SHELL (menu), load->loading);
+  gtk_widget_show (load->loading);
+
+  /* cancel when the menu is hidden or destroyed */
+  g_object_set_qdata_full (G_OBJECT (menu), menu_load, load,
+                           directory_menu_plugin_menu_load_cancel);
+
+  /* enumerate the directory in batches, so a large directory or a
+   * slow mount does not block the panel */
+  g_file_enumerate_children_async (dir, ENUMERATE_ATTRS,
+                                   G_FILE_QUERY_INFO_NONE, G_PRIORITY_DEFAULT,
+                                   load->cancellable,
+                                   directory_menu_plugin_menu_load_enumerate,
+                                   load);
 }
 
 
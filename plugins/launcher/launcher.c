@@ -25,6 +25,7 @@
 #endif
 
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 #include <libxfce4util/libxfce4util.h>
 #include <libxfce4ui/libxfce4ui.h>
 #include <garcon/garcon.h>
@@ -34,6 +35,7 @@
 #include <common/panel-private.h>
 #include <common/panel-xfconf.h>
 #include <common/panel-utils.h>
+#include <common/panel-debug.h>
 
 #include "launcher.h"
 #include "launcher-dialog.h"
@@ -44,6 +46,10 @@
                                         || LIST_HAS_ONE_OR_NO_ENTRIES ((plugin)->items))
 #define ARROW_INSIDE_BUTTON(plugin)    (!NO_ARROW_INSIDE_BUTTON (plugin))
 #define RELATIVE_CONFIG_PATH           PANEL_PLUGIN_RELATIVE_PATH G_DIR_SEPARATOR_S "%s-%d"
+#define DESKTOP_INDEX_MAGIC            "xfce4-panel-desktop-index-1"
+#define DESKTOP_INDEX_CACHE_PATH       "xfce4" G_DIR_SEPARATOR_S "panel" G_DIR_SEPARATOR_S "desktop-id-index"
+#define DESKTOP_INDEX_CHECK_INTERVAL   (2 * G_USEC_PER_SEC)
+#define TOOLTIP_CACHE_SIZE             (32)
 
 
 
@@ -76,6 +82,7 @@ static LauncherArrowType  launcher_plugin_default_arrow_type            (Launche
 static void               launcher_plugin_pack_widgets                  (LauncherPlugin       *plugin);
 static GdkPixbuf         *launcher_plugin_tooltip_pixbuf                (GdkScreen            *screen,
                                                                          const gchar          *icon_name);
+static void               launcher_plugin_tooltip_cache_clear           (void);
 static void               launcher_plugin_menu_deactivate               (GtkWidget            *menu,
                                                                          LauncherPlugin       *plugin);
 static void               launcher_plugin_menu_item_activate            (GtkMenuItem          *widget,
@@ -89,6 +96,7 @@ static void               launcher_plugin_menu_item_drag_data_received  (GtkWidg
                                                                          guint                 drag_time,
                                                                          GarconMenuItem       *item);
 static void               launcher_plugin_menu_construct                (LauncherPlugin       *plugin);
+static void               launcher_plugin_menu_update                   (LauncherPlugin       *plugin);
 static void               launcher_plugin_menu_popup_destroyed          (gpointer              user_data);
 static gboolean           launcher_plugin_menu_popup                    (gpointer              user_data);
 static void               launcher_plugin_menu_destroy                  (LauncherPlugin       *plugin);
@@ -174,9 +182,42 @@ static gboolean           launcher_plugin_exec_parse                    (GarconM
                                                                          GError              **error);
 static GSList            *launcher_plugin_uri_list_extract              (GtkSelectionData     *data);
 static void               launcher_plugin_uri_list_free                 (GSList               *uri_list);
+static const gchar       *launcher_plugin_desktop_index_lookup          (const gchar          *desktop_id);
 
 
 
+typedef struct
+{
+  const gchar *path;
+  gint64       mtime;
+}
+LauncherDesktopIndexDir;
+
+typedef struct
+{
+  /* the index data, usually a mapped cache file */
+  GBytes     *contents;
+
+  /* desktop-id to filename, the strings point in the contents */
+  GHashTable *ids;
+
+  /* all the scanned directories with their mtime */
+  GArray     *dirs;
+
+  /* last time the directories were checked */
+  gint64      checked;
+}
+LauncherDesktopIndex;
+
+typedef struct
+{
+  gchar     *key;
+
+  /* NULL if the icon was not found */
+  GdkPixbuf *pixbuf;
+}
+LauncherTooltipIcon;
+
 struct _LauncherPluginClass
 {
   XfcePanelPluginClass __parent__;
@@ -191,12 +232,12 @@ struct _LauncherPlugin
   GtkWidget         *arrow;
   GtkWidget         *child;
   GtkWidget         *menu;
+  GHashTable        *menu_rows;
 
   GSList            *items;
 
   GdkPixbuf         *pixbuf;
   gchar             *icon_name;
-  GdkPixbuf         *tooltip_cache;
 
   gulong             theme_change_id;
 
@@ -235,10 +276,19 @@ XFCE_PANEL_DEFINE_PLUGIN_RESIDENT (LauncherPlugin, launcher_plugin)
 
 
 
-/* quark to attach the plugin to menu items */
+/* quarks to attach the plugin, the item and its state to menu items */
 static GQuark      launcher_plugin_quark = 0;
+static GQuark      launcher_plugin_item_quark = 0;
+static GQuark      launcher_plugin_row_quark = 0;
 static guint       launcher_signals[LAST_SIGNAL];
 
+/* desktop-id index shared by all the launchers in this process */
+static LauncherDesktopIndex *desktop_index = NULL;
+
+/* recently used tooltip icons, most recent first */
+static GHashTable *tooltip_cache = NULL;
+static GQueue      tooltip_cache_lru = G_QUEUE_INIT;
+
 
 
 /* target types for dropping in the launcher plugin */
@@ -317,8 +367,10 @@ launcher_plugin_class_init (LauncherPluginClass *klass)
                   g_cclosure_marshal_VOID__VOID,
                   G_TYPE_NONE, 0);
 
-  /* initialize the quark */
+  /* initialize the quarks */
   launcher_plugin_quark = g_quark_from_static_string ("xfce-launcher-plugin");
+  launcher_plugin_item_quark = g_quark_from_static_string ("xfce-launcher-plugin-item");
+  launcher_plugin_row_quark = g_quark_from_static_string ("xfce-launcher-plugin-row");
 }
 
 
@@ -336,9 +388,9 @@ launcher_plugin_init (LauncherPlugin *plugin)
   plugin->show_label = FALSE;
   plugin->arrow_position = LAUNCHER_ARROW_DEFAULT;
   plugin->menu = NULL;
+  plugin->menu_rows = NULL;
   plugin->items = NULL;
   plugin->child = NULL;
-  plugin->tooltip_cache = NULL;
   plugin->pixbuf = NULL;
   plugin->icon_name = NULL;
   plugin->menu_timeout_id = 0;
@@ -499,11 +551,11 @@ launcher_plugin_item_changed (GarconMenuItem *item,
   li = g_slist_find (plugin->items, item);
   if (G_LIKELY (li != NULL))
     {
-      /* update the button or destroy the menu */
+      /* update the button or the menu row */
       if (plugin->items == li)
         launcher_plugin_button_update (plugin);
       else
-        launcher_plugin_menu_destroy (plugin);
+        launcher_plugin_menu_update (plugin);
     }
   else
     {
@@ -739,11 +791,9 @@ launcher_plugin_items_load (LauncherPlugin *plugin,
   const GValue   *value;
   const gchar    *str;
   GarconMenuItem *item;
-  GarconMenuItem *pool_item;
   GSList         *items = NULL;
-  GHashTable     *pool = NULL;
   gboolean        desktop_id;
-  gchar          *uri;
+  const gchar    *path;
   gboolean        items_modified = FALSE;
   gboolean        location_changed;
 
@@ -771,28 +821,22 @@ launcher_plugin_items_load (LauncherPlugin *plugin,
           if (!desktop_id)
             continue;
 
-          /* we are going to load an desktop_id from the item pool,
+          /* we are going to load an desktop_id from the desktop index,
            * even if this failes, save the new item list, so we don't
            * try this again in the future */
           items_modified = TRUE;
 
-          /* load the pool with desktop items */
-          if (pool == NULL)
-            pool = launcher_plugin_garcon_menu_pool ();
-
-          /* lookup the item in the item pool */
-          pool_item = g_hash_table_lookup (pool, str);
-          if (pool_item != NULL)
+          /* lookup the file of the desktop-id */
+          path = launcher_plugin_desktop_index_lookup (str);
+          if (path != NULL)
             {
               /* we want an editable file, so try to make a copy */
-              uri = garcon_menu_item_get_uri (pool_item);
-              item = launcher_plugin_item_load (plugin, uri, NULL, NULL);
-              g_free (uri);
+              item = launcher_plugin_item_load (plugin, path, NULL, NULL);
 
-              /* if something failed, use the pool item, but this one
+              /* if something failed, use the system file, but this one
                * won't be editable in the dialog */
               if (G_UNLIKELY (item == NULL))
-                item = GARCON_MENU_ITEM (g_object_ref (G_OBJECT (pool_item)));
+                item = garcon_menu_item_new_for_path (path);
             }
 
           /* skip this item if still not found */
@@ -811,9 +855,6 @@ launcher_plugin_items_load (LauncherPlugin *plugin,
           G_CALLBACK (launcher_plugin_item_changed), plugin);
     }
 
-  if (G_UNLIKELY (pool != NULL))
-    g_hash_table_destroy (pool);
-
   /* remove config files of items not in the new config */
   launcher_plugin_items_delete_configs (plugin);
 
@@ -839,9 +880,6 @@ launcher_plugin_set_property (GObject      *object,
 
   panel_return_if_fail (G_IS_FILE (plugin->config_directory));
 
-  /* destroy the menu, all the setting changes need this */
-  launcher_plugin_menu_destroy (plugin);
-
   switch (prop_id)
     {
     case PROP_ITEMS:
@@ -870,6 +908,9 @@ launcher_plugin_set_property (GObject      *object,
     case PROP_DISABLE_TOOLTIPS:
       plugin->disable_tooltips = g_value_get_boolean (value);
       gtk_widget_set_has_tooltip (plugin->button, !plugin->disable_tooltips);
+
+      /* the menu items connect the tooltip signal on creation */
+      launcher_plugin_menu_destroy (plugin);
       break;
 
     case PROP_MOVE_FIRST:
@@ -903,6 +944,9 @@ launcher_plugin_set_property (GObject      *object,
       plugin->arrow_position = g_value_get_uint (value);
 
 update_arrow:
+      /* the first item is in the menu if the arrow is internal */
+      launcher_plugin_menu_update (plugin);
+
       /* update the arrow button visibility */
       launcher_plugin_arrow_visibility (plugin);
 
@@ -1002,7 +1046,7 @@ launcher_plugin_file_changed (GFileMonitor      *monitor,
   if (update_plugin)
     {
       launcher_plugin_button_update (plugin);
-      launcher_plugin_menu_destroy (plugin);
+      launcher_plugin_menu_update (plugin);
 
       /* save the new config */
       launcher_plugin_save_delayed (plugin);
@@ -1138,9 +1182,6 @@ launcher_plugin_free_data (XfcePanelPlugin *panel_plugin)
       g_signal_handler_disconnect (G_OBJECT (icon_theme), plugin->theme_change_id);
     }
 
-  /* release the cached tooltip */
-  if (plugin->tooltip_cache != NULL)
-    g_object_unref (G_OBJECT (plugin->tooltip_cache));
   /* release the cached pixbuf */
   if (plugin->pixbuf != NULL)
     g_object_unref (G_OBJECT (plugin->pixbuf));
@@ -1370,8 +1411,8 @@ launcher_plugin_screen_position_changed (XfcePanelPlugin    *panel_plugin,
   xfce_arrow_button_set_arrow_type (XFCE_ARROW_BUTTON (plugin->arrow),
       xfce_panel_plugin_arrow_type (panel_plugin));
 
-  /* destroy the menu to update sort order */
-  launcher_plugin_menu_destroy (plugin);
+  /* update the sort order of the menu */
+  launcher_plugin_menu_update (plugin);
 }
 
 
@@ -1384,11 +1425,7 @@ launcher_plugin_icon_theme_changed (GtkIconTheme   *icon_theme,
   panel_return_if_fail (GTK_IS_ICON_THEME (icon_theme));
 
   /* invalid the icon cache */
-  if (plugin->tooltip_cache != NULL)
-    {
-      g_object_unref (G_OBJECT (plugin->tooltip_cache));
-      plugin->tooltip_cache = NULL;
-    }
+  launcher_plugin_tooltip_cache_clear ();
 }
 
 
@@ -1447,30 +1484,90 @@ launcher_plugin_pack_widgets (LauncherPlugin *plugin)
 
 
 
+static void
+launcher_plugin_tooltip_cache_remove (GList *link)
+{
+  LauncherTooltipIcon *icon = link->data;
+
+  g_hash_table_remove (tooltip_cache, icon->key);
+  g_queue_delete_link (&tooltip_cache_lru, link);
+
+  if (icon->pixbuf != NULL)
+    g_object_unref (G_OBJECT (icon->pixbuf));
+  g_free (icon->key);
+  g_slice_free (LauncherTooltipIcon, icon);
+}
+
+
+
+static void
+launcher_plugin_tooltip_cache_clear (void)
+{
+  while (!g_queue_is_empty (&tooltip_cache_lru))
+    launcher_plugin_tooltip_cache_remove (tooltip_cache_lru.head);
+}
+
+
+
 static GdkPixbuf *
 launcher_plugin_tooltip_pixbuf (GdkScreen   *screen,
                                 const gchar *icon_name)
 {
-  GtkIconTheme *theme;
+  GtkIconTheme        *theme;
+  gchar               *key;
+  GList               *link;
+  LauncherTooltipIcon *icon;
 
   panel_return_val_if_fail (screen == NULL || GDK_IS_SCREEN (screen), NULL);
 
   if (panel_str_is_empty (icon_name))
     return NULL;
 
-  /* load directly from a file */
-  if (G_UNLIKELY (g_path_is_absolute (icon_name)))
-    return gdk_pixbuf_new_from_file_at_scale (icon_name, GTK_ICON_SIZE_DND, GTK_ICON_SIZE_DND,
-                                              TRUE, NULL);
-
   if (G_LIKELY (screen != NULL))
     theme = gtk_icon_theme_get_for_screen (screen);
   else
     theme = gtk_icon_theme_get_default ();
 
-  return gtk_icon_theme_load_icon_for_scale (theme, icon_name, GTK_ICON_SIZE_DND,
-                                             GTK_ICON_SIZE_DND,
-                                             GTK_ICON_LOOKUP_FORCE_SIZE, NULL);
+  if (G_UNLIKELY (tooltip_cache == NULL))
+    tooltip_cache = g_hash_table_new (g_str_hash, g_str_equal);
+
+  /* lookup the icon, the cache is shared by all the launchers
+   * in this process and cleared when the icon theme changes */
+  key = g_strdup_printf ("%p:%d:%s", theme, GTK_ICON_SIZE_DND, icon_name);
+  link = g_hash_table_lookup (tooltip_cache, key);
+  if (link != NULL)
+    {
+      g_free (key);
+
+      /* move to the front of the queue */
+      g_queue_unlink (&tooltip_cache_lru, link);
+      g_queue_push_head_link (&tooltip_cache_lru, link);
+
+      icon = link->data;
+      return icon->pixbuf != NULL ? g_object_ref (G_OBJECT (icon->pixbuf)) : NULL;
+    }
+
+  icon = g_slice_new0 (LauncherTooltipIcon);
+  icon->key = key;
+
+  /* load directly from a file */
+  if (G_UNLIKELY (g_path_is_absolute (icon_name)))
+    icon->pixbuf = gdk_pixbuf_new_from_file_at_scale (icon_name, GTK_ICON_SIZE_DND,
+                                                      GTK_ICON_SIZE_DND, TRUE, NULL);
+  else
+    icon->pixbuf = gtk_icon_theme_load_icon_for_scale (theme, icon_name, GTK_ICON_SIZE_DND,
+                                                       GTK_ICON_SIZE_DND,
+                                                       GTK_ICON_LOOKUP_FORCE_SIZE, NULL);
+
+  /* also remember missing icons, so we don't search for them again */
+  g_queue_push_head (&tooltip_cache_lru, icon);
+  g_hash_table_insert (tooltip_cache, icon->key, tooltip_cache_lru.head);
+
+  /* drop the least recently used icons */
+  while (g_queue_get_length (&tooltip_cache_lru) > TOOLTIP_CACHE_SIZE)
+    launcher_plugin_tooltip_cache_remove (tooltip_cache_lru.tail);
+
+  return icon->pixbuf != NULL ? g_object_ref (G_OBJECT (icon->pixbuf)) : NULL;
 }
 
 
@@ -1529,8 +1626,8 @@ launcher_plugin_menu_item_activate (GtkMenuItem      *widget,
       plugin->items = g_slist_remove (plugin->items, item);
       plugin->items = g_slist_prepend (plugin->items, item);
 
-      /* destroy the menu and update the icon */
-      launcher_plugin_menu_destroy (plugin);
+      /* reorder the menu and update the icon */
+      launcher_plugin_menu_update (plugin);
       launcher_plugin_button_update (plugin);
     }
 }
@@ -1582,27 +1679,126 @@ launcher_plugin_menu_item_drag_data_received (GtkWidget          *widget,
 
 
 
+static gchar *
+launcher_plugin_menu_item_state (GarconMenuItem *item)
+{
+  const gchar *name, *icon_name;
+
+  /* the properties used to build the row */
+  name = garcon_menu_item_get_name (item);
+  icon_name = garcon_menu_item_get_icon_name (item);
+
+  return g_strconcat (name != NULL ? name : "", "\n",
+                      icon_name != NULL ? icon_name : "", NULL);
+}
+
+
+
 static void
-launcher_plugin_menu_construct (LauncherPlugin *plugin)
+launcher_plugin_menu_item_connect (LauncherPlugin *plugin,
+                                   GtkWidget      *mi,
+                                   GarconMenuItem *item)
 {
-  GtkArrowType    arrow_type;
-  guint           n;
+  GarconMenuItem *old_item;
+
+  /* the row was created for an item that has been replaced, the old
+   * one might be finalized so only use the pointer */
+  old_item = g_object_get_qdata (G_OBJECT (mi), launcher_plugin_item_quark);
+  if (old_item == item)
+    return;
+  else if (old_item != NULL)
+    g_signal_handlers_disconnect_by_data (G_OBJECT (mi), old_item);
+
+  g_object_set_qdata (G_OBJECT (mi), launcher_plugin_item_quark, item);
+  g_signal_connect (G_OBJECT (mi), "activate",
+      G_CALLBACK (launcher_plugin_menu_item_activate), item);
+  g_signal_connect (G_OBJECT (mi), "drag-data-received",
+      G_CALLBACK (launcher_plugin_menu_item_drag_data_received), item);
+
+  /* only connect the tooltip signal if tips are enabled */
+  if (!plugin->disable_tooltips)
+    {
+      gtk_widget_set_has_tooltip (mi, TRUE);
+      g_signal_connect (G_OBJECT (mi), "query-tooltip",
+          G_CALLBACK (launcher_plugin_item_query_tooltip), item);
+    }
+}
+
+
+
+static GtkWidget *
+launcher_plugin_menu_item_new (LauncherPlugin *plugin,
+                               GarconMenuItem *item,
+                               gchar          *state)
+{
+  GtkWidget   *mi, *box, *label, *image;
+  const gchar *name, *icon_name;
+  GdkPixbuf   *pixbuf;
+
+  /* create the menu item */
+  name = garcon_menu_item_get_name (item);
+  mi = gtk_menu_item_new ();
+  label = gtk_label_new (panel_str_is_empty (name) ? _("Unnamed Item") : name);
+  gtk_label_set_xalign (GTK_LABEL (label), 0.0);
+  box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+  gtk_box_pack_end (GTK_BOX (box), label, TRUE, TRUE, 0);
+  gtk_container_add (GTK_CONTAINER (mi), box);
+  g_object_set_qdata (G_OBJECT (mi), launcher_plugin_quark, plugin);
+  g_object_set_qdata_full (G_OBJECT (mi), launcher_plugin_row_quark, state, g_free);
+  gtk_widget_show_all (mi);
+  gtk_drag_dest_set (mi, GTK_DEST_DEFAULT_ALL, drop_targets,
+                     G_N_ELEMENTS (drop_targets), GDK_ACTION_COPY);
+  g_signal_connect (G_OBJECT (mi), "drag-leave",
+      G_CALLBACK (launcher_plugin_arrow_drag_leave), plugin);
+  launcher_plugin_menu_item_connect (plugin, mi, item);
+
+  /* set the icon if one is set */
+  icon_name = garcon_menu_item_get_icon_name (item);
+  if (!panel_str_is_empty (icon_name))
+    {
+      if (g_path_is_absolute (icon_name))
+        {
+          pixbuf = gdk_pixbuf_new_from_file_at_size (icon_name, 16, 16, NULL);
+          image = gtk_image_new_from_pixbuf (pixbuf);
+          if (G_LIKELY (pixbuf != NULL))
+            g_object_unref (G_OBJECT (pixbuf));
+        }
+      else
+        {
+          image = gtk_image_new_from_icon_name (icon_name, GTK_ICON_SIZE_MENU);
+          gtk_image_set_pixel_size (GTK_IMAGE (image), 16);
+        }
+      gtk_box_pack_start (GTK_BOX (box), image, FALSE, TRUE, 3);
+      gtk_widget_show (image);
+    }
+
+  return mi;
+}
+
+
+
+static void
+launcher_plugin_menu_update (LauncherPlugin *plugin)
+{
+  GHashTable     *rows;
+  GPtrArray      *order;
   GarconMenuItem *item;
-  GtkWidget      *mi, *box, *label, *image;
-  const gchar    *name, *icon_name;
+  GtkWidget      *mi;
   GSList         *li;
+  GList          *children;
+  GHashTableIter  iter;
+  gchar          *uri, *key, *state;
+  guint           i, n;
+  GtkArrowType    arrow_type;
 
   panel_return_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin));
-  panel_return_if_fail (plugin->menu == NULL);
 
-  /* create a new menu */
-  plugin->menu = gtk_menu_new ();
-  gtk_menu_attach_to_widget (GTK_MENU (plugin->menu), GTK_WIDGET (plugin), NULL);
-  g_signal_connect (G_OBJECT (plugin->menu), "deactivate",
-      G_CALLBACK (launcher_plugin_menu_deactivate), plugin);
+  /* the menu is constructed on the next popup */
+  if (plugin->menu == NULL)
+    return;
 
-  /* get the arrow type of the plugin */
-  arrow_type = xfce_arrow_button_get_arrow_type (XFCE_ARROW_BUTTON (plugin->arrow));
+  rows = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  order = g_ptr_array_sized_new (g_slist_length (plugin->items));
 
   /* walk through the menu entries */
   for (li = plugin->items, n = 0; li != NULL; li = li->next, n++)
@@ -1611,64 +1807,97 @@ launcher_plugin_menu_construct (LauncherPlugin *plugin)
       if (n == 0 && plugin->arrow_position != LAUNCHER_ARROW_INTERNAL)
         continue;
 
-      /* get the item data */
       item = GARCON_MENU_ITEM (li->data);
 
-      /* create the menu item */
-      name = garcon_menu_item_get_name (item);
-      mi = gtk_menu_item_new ();
-      label = gtk_label_new (panel_str_is_empty (name) ? _("Unnamed Item") : name);
-      gtk_label_set_xalign (GTK_LABEL (label), 0.0);
-      box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
-      gtk_box_pack_end (GTK_BOX (box), label, TRUE, TRUE, 0);
-      gtk_container_add (GTK_CONTAINER (mi), box);
-      g_object_set_qdata (G_OBJECT (mi), launcher_plugin_quark, plugin);
-      gtk_widget_show_all (mi);
-      gtk_drag_dest_set (mi, GTK_DEST_DEFAULT_ALL, drop_targets,
-                         G_N_ELEMENTS (drop_targets), GDK_ACTION_COPY);
-      g_signal_connect (G_OBJECT (mi), "activate",
-          G_CALLBACK (launcher_plugin_menu_item_activate), item);
-      g_signal_connect (G_OBJECT (mi), "drag-data-received",
-          G_CALLBACK (launcher_plugin_menu_item_drag_data_received), item);
-      g_signal_connect (G_OBJECT (mi), "drag-leave",
-          G_CALLBACK (launcher_plugin_arrow_drag_leave), plugin);
-
-      /* only connect the tooltip signal if tips are enabled */
-      if (!plugin->disable_tooltips)
+      /* rows are matched on the desktop file, because the items are
+       * recreated when the item list is set */
+      uri = garcon_menu_item_get_uri (item);
+      key = g_strdup (uri);
+      for (i = 1; g_hash_table_contains (rows, key); i++)
+        {
+          g_free (key);
+          key = g_strdup_printf ("%s#%u", uri, i);
+        }
+      g_free (uri);
+
+      state = launcher_plugin_menu_item_state (item);
+      mi = g_hash_table_lookup (plugin->menu_rows, key);
+      if (mi != NULL)
+        {
+          g_hash_table_remove (plugin->menu_rows, key);
+
+          /* only rebuild the row if the name or icon changed */
+          if (g_strcmp0 (g_object_get_qdata (G_OBJECT (mi), launcher_plugin_row_quark), state) != 0)
+            {
+              gtk_widget_destroy (mi);
+              mi = NULL;
+            }
+        }
+
+      if (mi == NULL)
+        {
+          mi = launcher_plugin_menu_item_new (plugin, item, state);
+          gtk_menu_shell_append (GTK_MENU_SHELL (plugin->menu), mi);
+        }
+      else
         {
-          gtk_widget_set_has_tooltip (mi, TRUE);
-          g_signal_connect (G_OBJECT (mi), "query-tooltip",
-              G_CALLBACK (launcher_plugin_item_query_tooltip), item);
+          launcher_plugin_menu_item_connect (plugin, mi, item);
+          g_free (state);
         }
 
-      /* depending on the menu position we prepend or append */
+      g_hash_table_insert (rows, key, mi);
+      g_ptr_array_add (order, mi);
+    }
+
+  /* destroy the rows of removed items */
+  g_hash_table_iter_init (&iter, plugin->menu_rows);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &mi))
+    gtk_widget_destroy (mi);
+  g_hash_table_destroy (plugin->menu_rows);
+  plugin->menu_rows = rows;
+
+  /* move the rows that are not in the right place, depending on
+   * the menu position the order is reversed */
+  arrow_type = xfce_arrow_button_get_arrow_type (XFCE_ARROW_BUTTON (plugin->arrow));
+  children = gtk_container_get_children (GTK_CONTAINER (plugin->menu));
+  for (i = 0; i < order->len; i++)
+    {
       if (G_UNLIKELY (arrow_type == GTK_ARROW_UP))
-        gtk_menu_shell_prepend (GTK_MENU_SHELL (plugin->menu), mi);
+        mi = g_ptr_array_index (order, order->len - i - 1);
       else
-        gtk_menu_shell_append (GTK_MENU_SHELL (plugin->menu), mi);
+        mi = g_ptr_array_index (order, i);
 
-      /* set the icon if one is set */
-      icon_name = garcon_menu_item_get_icon_name (item);
-      if (!panel_str_is_empty (icon_name))
+      if (g_list_nth_data (children, i) != mi)
         {
-          if (g_path_is_absolute (icon_name))
-            {
-              /* remember the icon name for recreating the pixbuf when panel
-                 size changes */
-              plugin->icon_name = g_strdup (icon_name);
-              plugin->pixbuf = gdk_pixbuf_new_from_file_at_size (icon_name, 16, 16, NULL);
-              image = gtk_image_new_from_pixbuf (plugin->pixbuf);
-            }
-          else
-            {
-              image = gtk_image_new_from_icon_name (icon_name, GTK_ICON_SIZE_MENU);
-              gtk_image_set_pixel_size (GTK_IMAGE (image), 16);
-              plugin->icon_name = NULL;
-            }
-          gtk_box_pack_start (GTK_BOX (box), image, FALSE, TRUE, 3);
-          gtk_widget_show (image);
+          gtk_menu_reorder_child (GTK_MENU (plugin->menu), mi, i);
+          g_list_free (children);
+          children = gtk_container_get_children (GTK_CONTAINER (plugin->menu));
         }
     }
+  g_list_free (children);
+  g_ptr_array_free (order, TRUE);
+
+  if (gtk_widget_get_visible (plugin->menu))
+    gtk_menu_reposition (GTK_MENU (plugin->menu));
+}
+
+
+
+static void
+launcher_plugin_menu_construct (LauncherPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin));
+  panel_return_if_fail (plugin->menu == NULL);
+
+  /* create a new menu */
+  plugin->menu = gtk_menu_new ();
+  gtk_menu_attach_to_widget (GTK_MENU (plugin->menu), GTK_WIDGET (plugin), NULL);
+  g_signal_connect (G_OBJECT (plugin->menu), "deactivate",
+      G_CALLBACK (launcher_plugin_menu_deactivate), plugin);
+
+  /* the rows are kept and updated when the items change */
+  plugin->menu_rows = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  launcher_plugin_menu_update (plugin);
 }
 
 
@@ -1742,6 +1971,9 @@ launcher_plugin_menu_destroy (LauncherPlugin *plugin)
       gtk_widget_destroy (plugin->menu);
       plugin->menu = NULL;
 
+      g_hash_table_destroy (plugin->menu_rows);
+      plugin->menu_rows = NULL;
+
       /* deactivate the toggle button */
       gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (plugin->arrow), FALSE);
     }
@@ -1759,12 +1991,6 @@ launcher_plugin_button_update (LauncherPlugin *plugin)
 
   panel_return_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin));
 
-  /* invalate the tooltip icon cache */
-  if (plugin->tooltip_cache != NULL)
-    {
-      g_object_unref (G_OBJECT (plugin->tooltip_cache));
-      plugin->tooltip_cache = NULL;
-    }
   if (plugin->pixbuf != NULL)
     {
       g_object_unref (G_OBJECT (plugin->pixbuf));
@@ -1925,7 +2151,6 @@ launcher_plugin_button_query_tooltip (GtkWidget      *widget,
                                       GtkTooltip     *tooltip,
                                       LauncherPlugin *plugin)
 {
-  gboolean        result;
   GarconMenuItem *item;
 
   panel_return_val_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin), FALSE);
@@ -1940,21 +2165,7 @@ launcher_plugin_button_query_tooltip (GtkWidget      *widget,
   /* get the first item */
   item = GARCON_MENU_ITEM (plugin->items->data);
 
-  /* handle the basic tooltip data */
-  result = launcher_plugin_item_query_tooltip (widget, x, y, keyboard_mode, tooltip, item);
-  if (G_LIKELY (result))
-    {
-      /* set the cached icon if not already set */
-      if (G_UNLIKELY (plugin->tooltip_cache == NULL))
-        plugin->tooltip_cache =
-            launcher_plugin_tooltip_pixbuf (gtk_widget_get_screen (widget),
-                                            garcon_menu_item_get_icon_name (item));
-
-      if (G_LIKELY (plugin->tooltip_cache != NULL))
-        gtk_tooltip_set_icon (tooltip, plugin->tooltip_cache);
-    }
-
-  return result;
+  return launcher_plugin_item_query_tooltip (widget, x, y, keyboard_mode, tooltip, item);
 }
 
 
@@ -2331,28 +2542,14 @@ launcher_plugin_item_query_tooltip (GtkWidget      *widget,
       gtk_tooltip_set_text (tooltip, name);
     }
 
-  /* the button uses a custom cache because the button widget is never
-   * destroyed, for menu items we cache the pixbuf by attaching the
-   * data on the menu item widget */
-  if (GTK_IS_MENU_ITEM (widget))
+  /* the pixbuf is cached by launcher_plugin_tooltip_pixbuf */
+  pixbuf = launcher_plugin_tooltip_pixbuf (gtk_widget_get_screen (widget),
+                                           garcon_menu_item_get_icon_name (item));
+  if (G_LIKELY (pixbuf != NULL))
     {
-      pixbuf = g_object_get_data (G_OBJECT (widget), "pixbuf-cache");
-      if (G_LIKELY (pixbuf != NULL))
-        {
-          gtk_tooltip_set_icon (tooltip, pixbuf);
-        }
-      else
-        {
-          pixbuf = launcher_plugin_tooltip_pixbuf (gtk_widget_get_screen (widget),
-                                                   garcon_menu_item_get_icon_name (item));
-          if (G_LIKELY (pixbuf != NULL))
-            {
-              gtk_tooltip_set_icon (tooltip, pixbuf);
-              g_object_set_data_full (G_OBJECT (widget), "pixbuf-cache", pixbuf,
-                                      (GDestroyNotify) g_object_unref);
-            }
-        }
-     }
+      gtk_tooltip_set_icon (tooltip, pixbuf);
+      g_object_unref (G_OBJECT (pixbuf));
+    }
 
   return TRUE;
 }
@@ -2795,6 +2992,401 @@ launcher_plugin_garcon_menu_pool (void)
 
 
 
+/**
+ * Desktop-id Index
+ *
+ * The index is stored in the cache directory as a list of nul-terminated
+ * strings: the magic, the search path, the number of directories, the
+ * directories with their mtime and finally desktop-id and filename pairs.
+ * The file is mapped, so a lookup only costs a hash table lookup.
+ **/
+static gint64
+launcher_plugin_desktop_index_mtime (const gchar *path)
+{
+  GStatBuf buf;
+
+  if (g_stat (path, &buf) != 0)
+    return -1;
+
+  return buf.st_mtime;
+}
+
+
+
+static gchar *
+launcher_plugin_desktop_index_search_path (void)
+{
+  GString             *search_path;
+  const gchar * const *dirs;
+  guint                i;
+
+  /* application directories in order of priority */
+  search_path = g_string_new (g_get_user_data_dir ());
+  dirs = g_get_system_data_dirs ();
+  for (i = 0; dirs[i] != NULL; i++)
+    {
+      g_string_append_c (search_path, G_SEARCHPATH_SEPARATOR);
+      g_string_append (search_path, dirs[i]);
+    }
+
+  return g_string_free (search_path, FALSE);
+}
+
+
+
+static void
+launcher_plugin_desktop_index_scan (const gchar *path,
+                                    const gchar *prefix,
+                                    GHashTable  *seen,
+                                    GHashTable  *visited,
+                                    GString     *dirs,
+                                    guint       *n_dirs,
+                                    GString     *ids)
+{
+  GDir        *dir;
+  const gchar *name;
+  gchar       *filename;
+  gchar       *desktop_id;
+  gchar       *sub_prefix;
+  gchar       *inode;
+  GStatBuf     buf;
+  gint64       mtime;
+
+  mtime = g_stat (path, &buf) == 0 ? buf.st_mtime : -1;
+
+  /* don't follow symlinks back into a directory we already scanned */
+  if (mtime != -1)
+    {
+      inode = g_strdup_printf ("%" G_GUINT64_FORMAT ":%" G_GUINT64_FORMAT,
+                               (guint64) buf.st_dev, (guint64) buf.st_ino);
+      if (g_hash_table_contains (visited, inode))
+        {
+          g_free (inode);
+          return;
+        }
+      g_hash_table_add (visited, inode);
+    }
+
+  /* also store missing directories, so we notice when they are created */
+  g_string_append_len (dirs, path, strlen (path) + 1);
+  g_string_append_printf (dirs, "%" G_GINT64_FORMAT, mtime);
+  g_string_append_c (dirs, '\0');
+  (*n_dirs)++;
+
+  if (mtime == -1)
+    return;
+
+  dir = g_dir_open (path, 0, NULL);
+  if (G_UNLIKELY (dir == NULL))
+    return;
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      filename = g_build_filename (path, name, NULL);
+
+      if (g_str_has_suffix (name, ".desktop"))
+        {
+          /* the first file with a desktop-id wins */
+          desktop_id = g_strconcat (prefix, name, NULL);
+          if (!g_hash_table_contains (seen, desktop_id)
+              && g_file_test (filename, G_FILE_TEST_IS_REGULAR))
+            {
+              g_string_append_len (ids, desktop_id, strlen (desktop_id) + 1);
+              g_string_append_len (ids, filename, strlen (filename) + 1);
+              g_hash_table_add (seen, desktop_id);
+            }
+          else
+            {
+              g_free (desktop_id);
+            }
+        }
+      else if (g_file_test (filename, G_FILE_TEST_IS_DIR))
+        {
+          /* files in subdirectories have the directory name as prefix */
+          sub_prefix = g_strconcat (prefix, name, "-", NULL);
+          launcher_plugin_desktop_index_scan (filename, sub_prefix, seen, visited, dirs, n_dirs, ids);
+          g_free (sub_prefix);
+        }
+
+      g_free (filename);
+    }
+
+  g_dir_close (dir);
+}
+
+
+
+static GBytes *
+launcher_plugin_desktop_index_build (const gchar *search_path)
+{
+  GString     *contents;
+  GString     *dirs;
+  GString     *ids;
+  GHashTable  *seen;
+  GHashTable  *visited;
+  gchar      **roots;
+  gchar       *path;
+  guint        n_dirs = 0;
+  guint        i;
+
+  dirs = g_string_new (NULL);
+  ids = g_string_new (NULL);
+  seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  visited = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  roots = g_strsplit (search_path, G_SEARCHPATH_SEPARATOR_S, -1);
+  for (i = 0; roots[i] != NULL; i++)
+    {
+      path = g_build_filename (roots[i], "applications", NULL);
+      launcher_plugin_desktop_index_scan (path, "", seen, visited, dirs, &n_dirs, ids);
+      g_free (path);
+    }
+  g_strfreev (roots);
+
+  contents = g_string_new (DESKTOP_INDEX_MAGIC);
+  g_string_append_len (contents, "", 1);
+  g_string_append_len (contents, search_path, strlen (search_path) + 1);
+  g_string_append_printf (contents, "%u", n_dirs);
+  g_string_append_len (contents, "", 1);
+  g_string_append_len (contents, dirs->str, dirs->len);
+  g_string_append_len (contents, ids->str, ids->len);
+
+  panel_debug (PANEL_DEBUG_LAUNCHER, "desktop-id index: scanned %u directories, "
+               "found %u desktop-ids", n_dirs, g_hash_table_size (seen));
+
+  g_string_free (dirs, TRUE);
+  g_string_free (ids, TRUE);
+  g_hash_table_destroy (seen);
+  g_hash_table_destroy (visited);
+
+  return g_string_free_to_bytes (contents);
+}
+
+
+
+static inline const gchar *
+launcher_plugin_desktop_index_next (const gchar **data,
+                                    const gchar  *end)
+{
+  const gchar *str = *data;
+
+  if (str >= end)
+    return NULL;
+
+  /* the contents are nul-terminated, so this stays in the buffer */
+  *data = str + strlen (str) + 1;
+
+  return str;
+}
+
+
+
+static void
+launcher_plugin_desktop_index_free (LauncherDesktopIndex *index)
+{
+  if (index == NULL)
+    return;
+
+  g_hash_table_destroy (index->ids);
+  g_array_free (index->dirs, TRUE);
+  g_bytes_unref (index->contents);
+  g_slice_free (LauncherDesktopIndex, index);
+}
+
+
+
+static LauncherDesktopIndex *
+launcher_plugin_desktop_index_new (GBytes      *contents,
+                                   const gchar *search_path)
+{
+  LauncherDesktopIndex    *index;
+  LauncherDesktopIndexDir  dir;
+  const gchar             *data, *end;
+  const gchar             *str, *mtime;
+  const gchar             *desktop_id, *path;
+  gsize                    size;
+  guint                    n_dirs, i;
+
+  data = g_bytes_get_data (contents, &size);
+  if (size == 0 || data[size - 1] != '\0')
+    return NULL;
+  end = data + size;
+
+  /* check the header */
+  str = launcher_plugin_desktop_index_next (&data, end);
+  if (str == NULL || strcmp (str, DESKTOP_INDEX_MAGIC) != 0)
+    return NULL;
+
+  /* the data dirs may have changed since the index was written */
+  str = launcher_plugin_desktop_index_next (&data, end);
+  if (str == NULL || strcmp (str, search_path) != 0)
+    return NULL;
+
+  str = launcher_plugin_desktop_index_next (&data, end);
+  if (str == NULL)
+    return NULL;
+  n_dirs = strtoul (str, NULL, 10);
+
+  index = g_slice_new0 (LauncherDesktopIndex);
+  index->contents = g_bytes_ref (contents);
+  index->ids = g_hash_table_new (g_str_hash, g_str_equal);
+  index->dirs = g_array_sized_new (FALSE, FALSE, sizeof (LauncherDesktopIndexDir), n_dirs);
+  index->checked = g_get_monotonic_time ();
+
+  for (i = 0; i < n_dirs; i++)
+    {
+      dir.path = launcher_plugin_desktop_index_next (&data, end);
+      mtime = launcher_plugin_desktop_index_next (&data, end);
+      if (dir.path == NULL || mtime == NULL)
+        goto invalid;
+
+      dir.mtime = g_ascii_strtoll (mtime, NULL, 10);
+      g_array_append_val (index->dirs, dir);
+    }
+
+  while ((desktop_id = launcher_plugin_desktop_index_next (&data, end)) != NULL)
+    {
+      path = launcher_plugin_desktop_index_next (&data, end);
+      if (path == NULL)
+        goto invalid;
+
+      g_hash_table_insert (index->ids, (gpointer) desktop_id, (gpointer) path);
+    }
+
+  return index;
+
+invalid:
+  launcher_plugin_desktop_index_free (index);
+
+  return NULL;
+}
+
+
+
+static gboolean
+launcher_plugin_desktop_index_is_valid (LauncherDesktopIndex *index)
+{
+  LauncherDesktopIndexDir *dir;
+  guint                    i;
+
+  /* a file that is added, removed or renamed changes the mtime
+   * of its directory */
+  for (i = 0; i < index->dirs->len; i++)
+    {
+      dir = &g_array_index (index->dirs, LauncherDesktopIndexDir, i);
+      if (launcher_plugin_desktop_index_mtime (dir->path) != dir->mtime)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+
+
+static LauncherDesktopIndex *
+launcher_plugin_desktop_index_load (void)
+{
+  LauncherDesktopIndex *index = NULL;
+  GMappedFile          *mapped;
+  GBytes               *contents;
+  gchar                *search_path;
+  gchar                *filename;
+  GError               *error = NULL;
+
+  search_path = launcher_plugin_desktop_index_search_path ();
+
+  /* try the index written by another launcher or panel process */
+  filename = xfce_resource_lookup (XFCE_RESOURCE_CACHE, DESKTOP_INDEX_CACHE_PATH);
+  if (filename != NULL)
+    {
+      mapped = g_mapped_file_new (filename, FALSE, NULL);
+      if (G_LIKELY (mapped != NULL))
+        {
+          contents = g_mapped_file_get_bytes (mapped);
+          g_mapped_file_unref (mapped);
+
+          index = launcher_plugin_desktop_index_new (contents, search_path);
+          g_bytes_unref (contents);
+
+          if (index != NULL
+              && !launcher_plugin_desktop_index_is_valid (index))
+            {
+              launcher_plugin_desktop_index_free (index);
+              index = NULL;
+            }
+        }
+
+      g_free (filename);
+    }
+
+  if (index == NULL)
+    {
+      contents = launcher_plugin_desktop_index_build (search_path);
+
+      /* store the index for the next time */
+      filename = xfce_resource_save_location (XFCE_RESOURCE_CACHE, DESKTOP_INDEX_CACHE_PATH, TRUE);
+      if (G_LIKELY (filename != NULL))
+        {
+          if (!g_file_set_contents (filename, g_bytes_get_data (contents, NULL),
+                                    g_bytes_get_size (contents), &error))
+            {
+              g_warning ("Failed to write the desktop-id index \"%s\": %s",
+                         filename, error->message);
+              g_error_free (error);
+            }
+
+          g_free (filename);
+        }
+
+      index = launcher_plugin_desktop_index_new (contents, search_path);
+      g_bytes_unref (contents);
+    }
+
+  g_free (search_path);
+
+  return index;
+}
+
+
+
+static const gchar *
+launcher_plugin_desktop_index_lookup (const gchar *desktop_id)
+{
+  gint64 now;
+
+  panel_return_val_if_fail (desktop_id != NULL, NULL);
+
+  /* check if the directories changed, but not for every lookup when
+   * the items are loaded */
+  if (desktop_index != NULL)
+    {
+      now = g_get_monotonic_time ();
+      if (now - desktop_index->checked > DESKTOP_INDEX_CHECK_INTERVAL)
+        {
+          if (launcher_plugin_desktop_index_is_valid (desktop_index))
+            {
+              desktop_index->checked = now;
+            }
+          else
+            {
+              launcher_plugin_desktop_index_free (desktop_index);
+              desktop_index = NULL;
+            }
+        }
+    }
+
+  if (desktop_index == NULL)
+    {
+      desktop_index = launcher_plugin_desktop_index_load ();
+      if (G_UNLIKELY (desktop_index == NULL))
+        return NULL;
+    }
+
+  return g_hash_table_lookup (desktop_index->ids, desktop_id);
+}
+
+
+
 gboolean
 launcher_plugin_item_is_editable (LauncherPlugin *plugin,
                                   GarconMenuItem *item,
@@ -34,6 +34,7 @@
 
 #include "systray-box.h"
 #include "systray-socket.h"
+#include "systray-sn-item.h"
 
 #define SPACING    (2)
 #define OFFSCREEN  (-9999)
@@ -41,36 +42,41 @@
 /* some icon implementations request a 1x1 size for invisible icons */
 #define REQUISITION_IS_INVISIBLE(child_req) ((child_req).width <= 1 && (child_req).height <= 1)
 
-
-
-static void     systray_box_get_property          (GObject         *object,
-                                                   guint            prop_id,
-                                                   GValue          *value,
-                                                   GParamSpec      *pspec);
-static void     systray_box_finalize              (GObject         *object);
-static void     systray_box_get_preferred_length  (GtkWidget       *widget,
-                                                   gint            *minimum_length,
-                                                   gint            *natural_length);
-static void     systray_box_get_preferred_width   (GtkWidget       *widget,
-                                                   gint            *minimum_width,
-                                                   gint            *natural_width);
-static void     systray_box_get_preferred_height  (GtkWidget       *widget,
-                                                   gint            *minimum_height,
-                                                   gint            *natural_height);
-static void     systray_box_size_allocate         (GtkWidget       *widget,
-                                                   GtkAllocation   *allocation);
-static void     systray_box_add                   (GtkContainer    *container,
-                                                   GtkWidget       *child);
-static void     systray_box_remove                (GtkContainer    *container,
-                                                   GtkWidget       *child);
-static void     systray_box_forall                (GtkContainer    *container,
-                                                   gboolean         include_internals,
-                                                   GtkCallback      callback,
-                                                   gpointer         callback_data);
-static GType    systray_box_child_type            (GtkContainer    *container);
-static gint     systray_box_compare_function      (gconstpointer    a,
-                                                   gconstpointer    b,
-                                                   gpointer         user_data);
+/* the box holds xembed sockets and status notifier items */
+#define SYSTRAY_BOX_IS_CHILD(child) (XFCE_IS_SYSTRAY_SOCKET (child) || XFCE_IS_SYSTRAY_SN_ITEM (child))
+
+
+
+static void         systray_box_get_property          (GObject         *object,
+                                                       guint            prop_id,
+                                                       GValue          *value,
+                                                       GParamSpec      *pspec);
+static void         systray_box_finalize              (GObject         *object);
+static void         systray_box_get_preferred_length  (GtkWidget       *widget,
+                                                       gint            *minimum_length,
+                                                       gint            *natural_length);
+static void         systray_box_get_preferred_width   (GtkWidget       *widget,
+                                                       gint            *minimum_width,
+                                                       gint            *natural_width);
+static void         systray_box_get_preferred_height  (GtkWidget       *widget,
+                                                       gint            *minimum_height,
+                                                       gint            *natural_height);
+static void         systray_box_size_allocate         (GtkWidget       *widget,
+                                                       GtkAllocation   *allocation);
+static void         systray_box_add                   (GtkContainer    *container,
+                                                       GtkWidget       *child);
+static void         systray_box_remove                (GtkContainer    *container,
+                                                       GtkWidget       *child);
+static void         systray_box_forall                (GtkContainer    *container,
+                                                       gboolean         include_internals,
+                                                       GtkCallback      callback,
+                                                       gpointer         callback_data);
+static GType        systray_box_child_type            (GtkContainer    *container);
+static gboolean     systray_box_child_get_hidden      (GtkWidget       *child);
+static const gchar *systray_box_child_get_name        (GtkWidget       *child);
+static gint         systray_box_compare_function      (gconstpointer    a,
+                                                       gconstpointer    b,
+                                                       gpointer         user_data);
 
 
 
@@ -92,6 +98,9 @@ struct _SystrayBox
   /* all the icons packed in this box */
   GSList       *children;
 
+  /* icons were added since the last layout, so the list needs sorting */
+  guint         children_unsorted : 1;
+
   /* table of item indexes */
   GHashTable   *names_ordered;
 
@@ -161,6 +170,7 @@ systray_box_init (SystrayBox *box)
   gtk_widget_set_has_window (GTK_WIDGET (box), FALSE);
 
   box->children = NULL;
+  box->children_unsorted = FALSE;
   box->names_ordered = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
   box->size_max = SIZE_MAX_DEFAULT;
   box->size_alloc_init = SIZE_MAX_DEFAULT;
@@ -282,6 +292,20 @@ systray_box_size_get_max_child_size (SystrayBox *box,
 
 
 
+static void
+systray_box_sort_children (SystrayBox *box)
+{
+  if (!box->children_unsorted)
+    return;
+
+  box->children = g_slist_sort_with_data (box->children,
+                                           systray_box_compare_function,
+                                           box);
+  box->children_unsorted = FALSE;
+}
+
+
+
 static void
 systray_box_get_preferred_width   (GtkWidget       *widget,
                                    gint            *minimum_width,
@@ -349,13 +373,16 @@ systray_box_get_preferred_length (GtkWidget      *widget,
 
   box->n_visible_children = 0;
 
+  /* sort the icons that were added since the last layout */
+  systray_box_sort_children (box);
+
   /* get some info about the n_rows we're going to allocate */
   systray_box_size_get_max_child_size (box, box->size_alloc, &rows, &row_size, NULL);
 
   for (li = box->children, cells = 0.00; li != NULL; li = li->next)
     {
       child = GTK_WIDGET (li->data);
-      panel_return_if_fail (XFCE_IS_SYSTRAY_SOCKET (child));
+      panel_return_if_fail (SYSTRAY_BOX_IS_CHILD (child));
 
       gtk_widget_get_preferred_size (child, NULL, &child_req);
 
@@ -364,7 +391,7 @@ systray_box_get_preferred_length (GtkWidget      *widget,
           || !gtk_widget_get_visible (child))
         continue;
 
-      hidden = systray_socket_get_hidden (XFCE_SYSTRAY_SOCKET (child));
+      hidden = systray_box_child_get_hidden (child);
       if (hidden)
         n_hidden_children++;
 
@@ -479,6 +506,8 @@ systray_box_size_allocate (GtkWidget     *widget,
 
   gtk_widget_set_allocation (widget, allocation);
 
+  systray_box_sort_children (box);
+
   ctx = gtk_widget_get_style_context (widget);
   gtk_style_context_get_padding (ctx, gtk_widget_get_state_flags (widget), &padding);
 
@@ -512,7 +541,7 @@ systray_box_size_allocate (GtkWidget     *widget,
   for (li = box->children; li != NULL; li = li->next)
     {
       child = GTK_WIDGET (li->data);
-      panel_return_if_fail (XFCE_IS_SYSTRAY_SOCKET (child));
+      panel_return_if_fail (SYSTRAY_BOX_IS_CHILD (child));
 
       if (!gtk_widget_get_visible (child))
         continue;
@@ -521,7 +550,7 @@ systray_box_size_allocate (GtkWidget     *widget,
 
       if (REQUISITION_IS_INVISIBLE (child_req)
           || (!box->show_hidden
-              && systray_socket_get_hidden (XFCE_SYSTRAY_SOCKET (child))))
+              && systray_box_child_get_hidden (child)))
         {
           /* position hidden icons offscreen if we don't show hidden icons
            * or the requested size looks like an invisible icons (see macro) */
@@ -651,7 +680,7 @@ systray_box_size_allocate (GtkWidget     *widget,
         }
 
       panel_debug_filtered (PANEL_DEBUG_SYSTRAY, "allocated %s[%p] at (%d,%d;%d,%d)",
-          systray_socket_get_name (XFCE_SYSTRAY_SOCKET (child)), child,
+          systray_box_child_get_name (child), child,
           child_alloc.x, child_alloc.y, child_alloc.width, child_alloc.height);
 
       gtk_widget_size_allocate (child, &child_alloc);
@@ -677,9 +706,10 @@ systray_box_add (GtkContainer *container,
   panel_return_if_fail (GTK_IS_WIDGET (child));
   panel_return_if_fail (gtk_widget_get_parent (child) == NULL);
 
-  box->children = g_slist_insert_sorted_with_data (box->children, child,
-                                                    systray_box_compare_function,
-                                                    box);
+  /* icons often dock in bursts, so sort them all at once in the
+   * next layout instead of inserting each one sorted */
+  box->children = g_slist_prepend (box->children, child);
+  box->children_unsorted = TRUE;
 
   gtk_widget_set_parent (child, GTK_WIDGET (box));
 
@@ -740,6 +770,28 @@ systray_box_child_type (GtkContainer *container)
 
 
 
+static gboolean
+systray_box_child_get_hidden (GtkWidget *child)
+{
+  if (XFCE_IS_SYSTRAY_SN_ITEM (child))
+    return systray_sn_item_get_hidden (XFCE_SYSTRAY_SN_ITEM (child));
+
+  return systray_socket_get_hidden (XFCE_SYSTRAY_SOCKET (child));
+}
+
+
+
+static const gchar *
+systray_box_child_get_name (GtkWidget *child)
+{
+  if (XFCE_IS_SYSTRAY_SN_ITEM (child))
+    return systray_sn_item_get_name (XFCE_SYSTRAY_SN_ITEM (child));
+
+  return systray_socket_get_name (XFCE_SYSTRAY_SOCKET (child));
+}
+
+
+
 static gint
 systray_box_compare_function (gconstpointer a,
                               gconstpointer b,
@@ -752,13 +804,13 @@ systray_box_compare_function (gconstpointer a,
   gpointer     value;
 
   /* sort hidden icons before visible ones */
-  hidden_a = systray_socket_get_hidden (XFCE_SYSTRAY_SOCKET (a));
-  hidden_b = systray_socket_get_hidden (XFCE_SYSTRAY_SOCKET (b));
+  hidden_a = systray_box_child_get_hidden (GTK_WIDGET (a));
+  hidden_b = systray_box_child_get_hidden (GTK_WIDGET (b));
   if (hidden_a != hidden_b)
     return hidden_a ? 1 : -1;
 
-  name_a = systray_socket_get_name (XFCE_SYSTRAY_SOCKET (a));
-  name_b = systray_socket_get_name (XFCE_SYSTRAY_SOCKET (b));
+  name_a = systray_box_child_get_name (GTK_WIDGET (a));
+  name_b = systray_box_child_get_name (GTK_WIDGET (b));
 
   if (name_a != NULL && g_hash_table_lookup_extended (box->names_ordered, name_a, NULL, &value))
     index_a = GPOINTER_TO_INT (value);
@@ -933,9 +985,8 @@ systray_box_update (SystrayBox *box,
   for (li = names_ordered, i = 0; li != NULL; li = li->next, i++)
     g_hash_table_replace (box->names_ordered, g_strdup (li->data), GINT_TO_POINTER (i));
 
-  box->children = g_slist_sort_with_data (box->children,
-                                           systray_box_compare_function,
-                                           box);
+  box->children_unsorted = TRUE;
+  systray_box_sort_children (box);
 
   /* update the box, so we update the has-hidden property */
   gtk_widget_queue_resize (GTK_WIDGET (box));
@@ -54,6 +54,9 @@
 #define XFCE_SYSTRAY_MANAGER_ORIENTATION_HORIZONTAL 0
 #define XFCE_SYSTRAY_MANAGER_ORIENTATION_VERTICAL   1
 
+/* time to collect dock requests before embedding them, about a frame */
+#define XFCE_SYSTRAY_MANAGER_DOCK_DELAY (16)
+
 
 
 static void            systray_manager_finalize                           (GObject             *object);
@@ -75,6 +78,8 @@ static void            systray_manager_handle_cancel_message              (Systr
                                                                            XClientMessageEvent *xevent);
 static void            systray_manager_handle_dock_request                (SystrayManager      *manager,
                                                                            XClientMessageEvent *xevent);
+static gboolean        systray_manager_dock_requests_flush                (gpointer             user_data);
+static void            systray_manager_dock_requests_cancel               (SystrayManager      *manager);
 static gboolean        systray_manager_handle_undock_request              (GtkSocket           *socket,
                                                                            gpointer             user_data);
 static void            systray_manager_set_visual                         (SystrayManager      *manager);
@@ -115,6 +120,10 @@ struct _SystrayManager
   /* list of pending messages */
   GSList         *messages;
 
+  /* dock requests waiting to be embedded in one batch */
+  GSList         *dock_requests;
+  guint           dock_timeout_id;
+
   /* _net_system_tray_opcode atom */
   Atom            opcode_atom;
 
@@ -142,6 +151,16 @@ struct _SystrayMessage
   glong           timeout;
 };
 
+typedef struct
+{
+  /* x11 window of the icon */
+  Window          window;
+
+  /* monotonic time of the request */
+  gint64          requested;
+}
+SystrayDockRequest;
+
 
 
 static guint  systray_manager_signals[LAST_SIGNAL];
@@ -217,6 +236,8 @@ systray_manager_init (SystrayManager *manager)
   manager->invisible = NULL;
   manager->orientation = GTK_ORIENTATION_HORIZONTAL;
   manager->messages = NULL;
+  manager->dock_requests = NULL;
+  manager->dock_timeout_id = 0;
   manager->sockets = g_hash_table_new (NULL, NULL);
 }
 
@@ -242,6 +263,8 @@ systray_manager_finalize (GObject *object)
 
   panel_return_if_fail (manager->invisible == NULL);
 
+  systray_manager_dock_requests_cancel (manager);
+
   /* destroy the hash table */
   g_hash_table_destroy (manager->sockets);
 
@@ -460,6 +483,9 @@ systray_manager_unregister (SystrayManager *manager)
   gdk_window_remove_filter (gtk_widget_get_window (GTK_WIDGET (invisible)),
       systray_manager_window_filter, manager);
 
+  /* drop icons that did not dock yet */
+  systray_manager_dock_requests_cancel (manager);
+
   /* remove all sockets from the hash table */
   g_hash_table_foreach (manager->sockets,
       systray_manager_remove_socket, manager);
@@ -608,6 +634,13 @@ systray_manager_handle_begin_message (SystrayManager      *manager,
 
   panel_return_if_fail (XFCE_IS_SYSTRAY_MANAGER (manager));
 
+  /* the message could be for an icon that is waiting to dock */
+  if (manager->dock_requests != NULL)
+    {
+      g_source_remove (manager->dock_timeout_id);
+      systray_manager_dock_requests_flush (manager);
+    }
+
   /* try to find the window in the list of known tray icons */
   socket = g_hash_table_lookup (manager->sockets, GUINT_TO_POINTER (xevent->window));
 
@@ -673,26 +706,21 @@ systray_manager_handle_cancel_message (SystrayManager      *manager,
 
 
 
-static void
-systray_manager_handle_dock_request (SystrayManager      *manager,
-                                     XClientMessageEvent *xevent)
+static GtkWidget *
+systray_manager_dock (SystrayManager *manager,
+                      Window          window)
 {
   GtkWidget       *socket;
   GdkScreen       *screen;
-  Window           window = xevent->data.l[2];
 
-  panel_return_if_fail (XFCE_IS_SYSTRAY_MANAGER (manager));
-  panel_return_if_fail (GTK_IS_INVISIBLE (manager->invisible));
-
-  /* check if we already have this window */
-  if (g_hash_table_lookup (manager->sockets, GUINT_TO_POINTER (window)) != NULL)
-    return;
+  panel_return_val_if_fail (XFCE_IS_SYSTRAY_MANAGER (manager), NULL);
+  panel_return_val_if_fail (GTK_IS_INVISIBLE (manager->invisible), NULL);
 
   /* create the socket */
   screen = gtk_widget_get_screen (manager->invisible);
   socket = systray_socket_new (screen, window);
   if (G_UNLIKELY (socket == NULL))
-    return;
+    return NULL;
 
   /* add the icon to the tray */
   g_signal_emit (manager, systray_manager_signals[ICON_ADDED], 0, socket);
@@ -718,6 +746,117 @@ systray_manager_handle_dock_request (SystrayManager      *manager,
 
       /* not attached successfully, destroy it */
       gtk_widget_destroy (socket);
+      socket = NULL;
+    }
+
+  return socket;
+}
+
+
+
+static gboolean
+systray_manager_dock_requests_flush (gpointer user_data)
+{
+  SystrayManager     *manager = XFCE_SYSTRAY_MANAGER (user_data);
+  GSList             *requests, *li;
+  SystrayDockRequest *request;
+  GtkWidget          *socket;
+  guint               n_requests;
+
+  panel_return_val_if_fail (XFCE_IS_SYSTRAY_MANAGER (manager), FALSE);
+
+  /* take the requests in the order they arrived */
+  requests = g_slist_reverse (manager->dock_requests);
+  manager->dock_requests = NULL;
+  n_requests = g_slist_length (requests);
+
+  /* the sockets are all added before the next layout of the box,
+   * so it is sorted and allocated once for the whole batch */
+  for (li = requests; li != NULL; li = li->next)
+    {
+      request = li->data;
+
+      socket = systray_manager_dock (manager, request->window);
+      if (G_LIKELY (socket != NULL))
+        {
+          panel_debug (PANEL_DEBUG_SYSTRAY, "docked %s[%p] %.1f ms after the request "
+                       "(batch of %u)", systray_socket_get_name (XFCE_SYSTRAY_SOCKET (socket)),
+                       socket, (g_get_monotonic_time () - request->requested) / 1000.0,
+                       n_requests);
+        }
+
+      g_slice_free (SystrayDockRequest, request);
+    }
+
+  g_slist_free (requests);
+
+  return FALSE;
+}
+
+
+
+static void
+systray_manager_dock_requests_flush_destroyed (gpointer user_data)
+{
+  XFCE_SYSTRAY_MANAGER (user_data)->dock_timeout_id = 0;
+}
+
+
+
+static void
+systray_manager_dock_requests_cancel (SystrayManager *manager)
+{
+  GSList *li;
+
+  panel_return_if_fail (XFCE_IS_SYSTRAY_MANAGER (manager));
+
+  if (manager->dock_timeout_id != 0)
+    g_source_remove (manager->dock_timeout_id);
+
+  for (li = manager->dock_requests; li != NULL; li = li->next)
+    g_slice_free (SystrayDockRequest, li->data);
+  g_slist_free (manager->dock_requests);
+  manager->dock_requests = NULL;
+}
+
+
+
+static void
+systray_manager_handle_dock_request (SystrayManager      *manager,
+                                     XClientMessageEvent *xevent)
+{
+  SystrayDockRequest *request;
+  GSList             *li;
+  Window              window = xevent->data.l[2];
+
+  panel_return_if_fail (XFCE_IS_SYSTRAY_MANAGER (manager));
+  panel_return_if_fail (GTK_IS_INVISIBLE (manager->invisible));
+
+  /* check if we already have this window */
+  if (g_hash_table_lookup (manager->sockets, GUINT_TO_POINTER (window)) != NULL)
+    return;
+
+  /* or if it is already waiting to be docked */
+  for (li = manager->dock_requests; li != NULL; li = li->next)
+    {
+      request = li->data;
+      if (request->window == window)
+        return;
+    }
+
+  request = g_slice_new0 (SystrayDockRequest);
+  request->window = window;
+  request->requested = g_get_monotonic_time ();
+  manager->dock_requests = g_slist_prepend (manager->dock_requests, request);
+
+  /* applications start together on login, so collect the requests
+   * that arrive within a frame and dock them together */
+  if (manager->dock_timeout_id == 0)
+    {
+      manager->dock_timeout_id =
+          gdk_threads_add_timeout_full (G_PRIORITY_DEFAULT, XFCE_SYSTRAY_MANAGER_DOCK_DELAY,
+                                        systray_manager_dock_requests_flush, manager,
+                                        systray_manager_dock_requests_flush_destroyed);
     }
 }
 
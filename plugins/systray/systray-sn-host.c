@@ -0,0 +1,926 @@
+/*
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <gtk/gtk.h>
+#include <gio/gio.h>
+
+#include <libxfce4panel/libxfce4panel.h>
+
+#include <common/panel-private.h>
+#include <common/panel-debug.h>
+
+#include "systray-sn-host.h"
+#include "systray-sn-item.h"
+
+
+
+#define SYSTRAY_SN_WATCHER_NAME      "org.kde.StatusNotifierWatcher"
+#define SYSTRAY_SN_WATCHER_PATH      "/StatusNotifierWatcher"
+#define SYSTRAY_SN_WATCHER_INTERFACE "org.kde.StatusNotifierWatcher"
+#define SYSTRAY_SN_ITEM_PATH         "/StatusNotifierItem"
+
+
+
+static void      systray_sn_host_finalize             (GObject               *object);
+static void      systray_sn_host_bus_get              (GObject               *source_object,
+                                                       GAsyncResult          *result,
+                                                       gpointer               user_data);
+static void      systray_sn_host_watcher_method_call  (GDBusConnection       *connection,
+                                                       const gchar           *sender,
+                                                       const gchar           *object_path,
+                                                       const gchar           *interface_name,
+                                                       const gchar           *method_name,
+                                                       GVariant              *parameters,
+                                                       GDBusMethodInvocation *invocation,
+                                                       gpointer               user_data);
+static GVariant *systray_sn_host_watcher_get_property (GDBusConnection       *connection,
+                                                       const gchar           *sender,
+                                                       const gchar           *object_path,
+                                                       const gchar           *interface_name,
+                                                       const gchar           *property_name,
+                                                       GError               **error,
+                                                       gpointer               user_data);
+static gboolean  systray_sn_host_item_add             (SystraySnHost         *host,
+                                                       const gchar           *service,
+                                                       const gchar           *sender);
+static void      systray_sn_host_item_remove          (SystraySnHost         *host,
+                                                       const gchar           *service);
+static void      systray_sn_host_item_remove_all      (SystraySnHost         *host);
+
+
+
+enum
+{
+  ITEM_ADDED,
+  ITEM_REMOVED,
+  LAST_SIGNAL
+};
+
+struct _SystraySnHostClass
+{
+  GObjectClass __parent__;
+};
+
+struct _SystraySnHost
+{
+  GObject __parent__;
+
+  GDBusConnection *connection;
+  GCancellable    *cancellable;
+
+  /* org.kde.StatusNotifierHost-<pid>-<n> */
+  gchar           *host_name;
+  guint            host_owner_id;
+
+  /* the watcher we serve ourselves or follow, if enabled */
+  guint            serve_watcher : 1;
+  guint            watcher_object_id;
+  guint            watcher_owner_id;
+  guint            is_watcher : 1;
+
+  /* follows the owner of the watcher name */
+  guint            watcher_watch_id;
+  guint            watcher_present : 1;
+
+  /* signals of the watcher we follow */
+  guint            watcher_signal_id;
+
+  /* registered items, the service is the key */
+  GHashTable      *items;
+};
+
+typedef struct
+{
+  SystraySnHost *host;
+
+  /* bus name and object path, also the key in the table */
+  gchar         *service;
+
+  GtkWidget     *item;
+
+  /* removes the item when its owner leaves the bus */
+  guint          watch_id;
+}
+SystraySnHostItem;
+
+
+
+static guint systray_sn_host_signals[LAST_SIGNAL];
+
+static const gchar systray_sn_host_watcher_xml[] =
+  "<node>"
+  "  <interface name='" SYSTRAY_SN_WATCHER_INTERFACE "'>"
+  "    <method name='RegisterStatusNotifierItem'>"
+  "      <arg name='service' type='s' direction='in'/>"
+  "    </method>"
+  "    <method name='RegisterStatusNotifierHost'>"
+  "      <arg name='service' type='s' direction='in'/>"
+  "    </method>"
+  "    <property name='RegisteredStatusNotifierItems' type='as' access='read'/>"
+  "    <property name='IsStatusNotifierHostRegistered' type='b' access='read'/>"
+  "    <property name='ProtocolVersion' type='i' access='read'/>"
+  "    <signal name='StatusNotifierItemRegistered'>"
+  "      <arg type='s'/>"
+  "    </signal>"
+  "    <signal name='StatusNotifierItemUnregistered'>"
+  "      <arg type='s'/>"
+  "    </signal>"
+  "    <signal name='StatusNotifierHostRegistered'/>"
+  "  </interface>"
+  "</node>";
+
+static const GDBusInterfaceVTable systray_sn_host_watcher_vtable =
+{
+  systray_sn_host_watcher_method_call,
+  systray_sn_host_watcher_get_property,
+  NULL
+};
+
+
+
+XFCE_PANEL_DEFINE_TYPE (SystraySnHost, systray_sn_host, G_TYPE_OBJECT)
+
+
+
+static void
+systray_sn_host_class_init (SystraySnHostClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = systray_sn_host_finalize;
+
+  systray_sn_host_signals[ITEM_ADDED] =
+      g_signal_new (g_intern_static_string ("item-added"),
+                    G_OBJECT_CLASS_TYPE (klass),
+                    G_SIGNAL_RUN_LAST,
+                    0, NULL, NULL,
+                    g_cclosure_marshal_VOID__OBJECT,
+                    G_TYPE_NONE, 1,
+                    GTK_TYPE_WIDGET);
+
+  systray_sn_host_signals[ITEM_REMOVED] =
+      g_signal_new (g_intern_static_string ("item-removed"),
+                    G_OBJECT_CLASS_TYPE (klass),
+                    G_SIGNAL_RUN_LAST,
+                    0, NULL, NULL,
+                    g_cclosure_marshal_VOID__OBJECT,
+                    G_TYPE_NONE, 1,
+                    GTK_TYPE_WIDGET);
+}
+
+
+
+static void
+systray_sn_host_item_free (gpointer data)
+{
+  SystraySnHostItem *entry = data;
+
+  g_bus_unwatch_name (entry->watch_id);
+
+  g_signal_handlers_disconnect_by_data (G_OBJECT (entry->item), entry);
+  g_object_unref (G_OBJECT (entry->item));
+
+  g_free (entry->service);
+  g_slice_free (SystraySnHostItem, entry);
+}
+
+
+
+static void
+systray_sn_host_init (SystraySnHost *host)
+{
+  static guint host_counter = 0;
+
+  host->connection = NULL;
+  host->cancellable = g_cancellable_new ();
+  host->host_name = g_strdup_printf ("org.kde.StatusNotifierHost-%d-%u",
+                                     (gint) getpid (), ++host_counter);
+  host->host_owner_id = 0;
+  host->serve_watcher = FALSE;
+  host->watcher_object_id = 0;
+  host->watcher_owner_id = 0;
+  host->is_watcher = FALSE;
+  host->watcher_watch_id = 0;
+  host->watcher_present = FALSE;
+  host->watcher_signal_id = 0;
+  host->items = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                       NULL, systray_sn_host_item_free);
+}
+
+
+
+static void
+systray_sn_host_finalize (GObject *object)
+{
+  SystraySnHost *host = XFCE_SYSTRAY_SN_HOST (object);
+
+  /* the callbacks of cancelled calls do not touch the host */
+  g_cancellable_cancel (host->cancellable);
+  g_object_unref (G_OBJECT (host->cancellable));
+
+  g_hash_table_destroy (host->items);
+
+  if (host->connection != NULL)
+    {
+      if (host->watcher_watch_id != 0)
+        g_bus_unwatch_name (host->watcher_watch_id);
+
+      if (host->watcher_signal_id != 0)
+        g_dbus_connection_signal_unsubscribe (host->connection, host->watcher_signal_id);
+
+      if (host->watcher_owner_id != 0)
+        g_bus_unown_name (host->watcher_owner_id);
+
+      if (host->watcher_object_id != 0)
+        g_dbus_connection_unregister_object (host->connection, host->watcher_object_id);
+
+      if (host->host_owner_id != 0)
+        g_bus_unown_name (host->host_owner_id);
+
+      g_object_unref (G_OBJECT (host->connection));
+    }
+
+  g_free (host->host_name);
+
+  G_OBJECT_CLASS (systray_sn_host_parent_class)->finalize (object);
+}
+
+
+
+static void
+systray_sn_host_emit_watcher_signal (SystraySnHost *host,
+                                     const gchar   *signal_name,
+                                     GVariant      *parameters)
+{
+  if (!host->is_watcher)
+    {
+      if (parameters != NULL)
+        g_variant_unref (g_variant_ref_sink (parameters));
+      return;
+    }
+
+  g_dbus_connection_emit_signal (host->connection, NULL,
+                                 SYSTRAY_SN_WATCHER_PATH,
+                                 SYSTRAY_SN_WATCHER_INTERFACE,
+                                 signal_name, parameters, NULL);
+}
+
+
+
+static void
+systray_sn_host_item_ready (SystraySnItem     *item,
+                            SystraySnHostItem *entry)
+{
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SN_HOST (entry->host));
+
+  panel_debug (PANEL_DEBUG_SYSTRAY, "status notifier item %s (%s) is ready",
+               entry->service, systray_sn_item_get_name (item));
+
+  g_signal_emit (G_OBJECT (entry->host), systray_sn_host_signals[ITEM_ADDED],
+                 0, GTK_WIDGET (item));
+}
+
+
+
+static void
+systray_sn_host_item_expired (SystraySnItem     *item,
+                              SystraySnHostItem *entry)
+{
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SN_HOST (entry->host));
+
+  systray_sn_host_item_remove (entry->host, entry->service);
+}
+
+
+
+static void
+systray_sn_host_item_vanished (GDBusConnection *connection,
+                               const gchar     *name,
+                               gpointer         user_data)
+{
+  SystraySnHostItem *entry = user_data;
+
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SN_HOST (entry->host));
+
+  systray_sn_host_item_remove (entry->host, entry->service);
+}
+
+
+
+static gboolean
+systray_sn_host_item_add (SystraySnHost *host,
+                          const gchar   *service,
+                          const gchar   *sender)
+{
+  SystraySnHostItem *entry;
+  gchar             *bus_name;
+  const gchar       *object_path;
+  const gchar       *slash;
+  gchar             *key;
+
+  panel_return_val_if_fail (XFCE_IS_SYSTRAY_SN_HOST (host), FALSE);
+  panel_return_val_if_fail (G_IS_DBUS_CONNECTION (host->connection), FALSE);
+
+  if (panel_str_is_empty (service))
+    return FALSE;
+
+  /* the service is an object path on the sender (libappindicator),
+   * a bus name with the default path or the bus name followed by
+   * the object path as listed by other watchers */
+  if (*service == '/')
+    {
+      bus_name = g_strdup (sender);
+      object_path = service;
+    }
+  else if ((slash = strchr (service, '/')) != NULL)
+    {
+      bus_name = g_strndup (service, slash - service);
+      object_path = slash;
+    }
+  else
+    {
+      bus_name = g_strdup (service);
+      object_path = SYSTRAY_SN_ITEM_PATH;
+    }
+
+  if (bus_name == NULL
+      || !g_dbus_is_name (bus_name)
+      || !g_variant_is_object_path (object_path))
+    {
+      panel_debug (PANEL_DEBUG_SYSTRAY, "invalid status notifier item %s", service);
+      g_free (bus_name);
+
+      return FALSE;
+    }
+
+  key = g_strconcat (bus_name, object_path, NULL);
+  if (g_hash_table_contains (host->items, key))
+    {
+      /* items register again when they restart their icon */
+      g_free (key);
+      g_free (bus_name);
+
+      return TRUE;
+    }
+
+  entry = g_slice_new0 (SystraySnHostItem);
+  entry->host = host;
+  entry->service = key;
+  entry->item = systray_sn_item_new (host->connection, bus_name, object_path);
+  g_object_ref_sink (G_OBJECT (entry->item));
+  g_hash_table_insert (host->items, entry->service, entry);
+
+  /* the host only shows items with a first set of properties */
+  g_signal_connect (G_OBJECT (entry->item), "ready",
+      G_CALLBACK (systray_sn_host_item_ready), entry);
+  g_signal_connect (G_OBJECT (entry->item), "expired",
+      G_CALLBACK (systray_sn_host_item_expired), entry);
+
+  /* this also removes the item if the owner already left */
+  entry->watch_id = g_bus_watch_name_on_connection (host->connection, bus_name,
+                                                    G_BUS_NAME_WATCHER_FLAGS_NONE,
+                                                    NULL, systray_sn_host_item_vanished,
+                                                    entry, NULL);
+
+  panel_debug (PANEL_DEBUG_SYSTRAY, "registered status notifier item %s", key);
+
+  systray_sn_host_emit_watcher_signal (host, "StatusNotifierItemRegistered",
+                                       g_variant_new ("(s)", key));
+
+  g_free (bus_name);
+
+  return TRUE;
+}
+
+
+
+static void
+systray_sn_host_item_remove (SystraySnHost *host,
+                             const gchar   *service)
+{
+  SystraySnHostItem *entry;
+
+  entry = g_hash_table_lookup (host->items, service);
+  if (G_UNLIKELY (entry == NULL))
+    return;
+
+  panel_debug (PANEL_DEBUG_SYSTRAY, "unregistered status notifier item %s", service);
+
+  systray_sn_host_emit_watcher_signal (host, "StatusNotifierItemUnregistered",
+                                       g_variant_new ("(s)", entry->service));
+
+  /* only items that were ready have been added */
+  if (gtk_widget_get_parent (entry->item) != NULL)
+    g_signal_emit (G_OBJECT (host), systray_sn_host_signals[ITEM_REMOVED],
+                   0, entry->item);
+
+  g_hash_table_remove (host->items, entry->service);
+}
+
+
+
+static void
+systray_sn_host_item_remove_all (SystraySnHost *host)
+{
+  GList *services, *li;
+
+  services = g_hash_table_get_keys (host->items);
+  for (li = services; li != NULL; li = li->next)
+    systray_sn_host_item_remove (host, li->data);
+  g_list_free (services);
+}
+
+
+
+static void
+systray_sn_host_watcher_method_call (GDBusConnection       *connection,
+                                     const gchar           *sender,
+                                     const gchar           *object_path,
+                                     const gchar           *interface_name,
+                                     const gchar           *method_name,
+                                     GVariant              *parameters,
+                                     GDBusMethodInvocation *invocation,
+                                     gpointer               user_data)
+{
+  SystraySnHost *host = XFCE_SYSTRAY_SN_HOST (user_data);
+  const gchar   *service;
+
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SN_HOST (host));
+
+  if (g_strcmp0 (method_name, "RegisterStatusNotifierItem") == 0)
+    {
+      g_variant_get (parameters, "(&s)", &service);
+      if (systray_sn_host_item_add (host, service, sender))
+        g_dbus_method_invocation_return_value (invocation, NULL);
+      else
+        g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
+                                               G_DBUS_ERROR_INVALID_ARGS,
+                                               "Invalid service %s", service);
+    }
+  else if (g_strcmp0 (method_name, "RegisterStatusNotifierHost") == 0)
+    {
+      /* other hosts simply follow the signals */
+      g_dbus_method_invocation_return_value (invocation, NULL);
+      systray_sn_host_emit_watcher_signal (host, "StatusNotifierHostRegistered", NULL);
+    }
+  else
+    {
+      g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
+                                             G_DBUS_ERROR_UNKNOWN_METHOD,
+                                             "Unknown method %s", method_name);
+    }
+}
+
+
+
+static GVariant *
+systray_sn_host_watcher_get_property (GDBusConnection  *connection,
+                                      const gchar      *sender,
+                                      const gchar      *object_path,
+                                      const gchar      *interface_name,
+                                      const gchar      *property_name,
+                                      GError          **error,
+                                      gpointer          user_data)
+{
+  SystraySnHost   *host = XFCE_SYSTRAY_SN_HOST (user_data);
+  GVariantBuilder  builder;
+  GHashTableIter   iter;
+  gpointer         service;
+
+  panel_return_val_if_fail (XFCE_IS_SYSTRAY_SN_HOST (host), NULL);
+
+  if (g_strcmp0 (property_name, "RegisteredStatusNotifierItems") == 0)
+    {
+      g_variant_builder_init (&builder, G_VARIANT_TYPE_STRING_ARRAY);
+      g_hash_table_iter_init (&iter, host->items);
+      while (g_hash_table_iter_next (&iter, &service, NULL))
+        g_variant_builder_add (&builder, "s", service);
+
+      return g_variant_builder_end (&builder);
+    }
+  else if (g_strcmp0 (property_name, "IsStatusNotifierHostRegistered") == 0)
+    {
+      return g_variant_new_boolean (TRUE);
+    }
+  else if (g_strcmp0 (property_name, "ProtocolVersion") == 0)
+    {
+      return g_variant_new_int32 (0);
+    }
+
+  g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY,
+               "Unknown property %s", property_name);
+
+  return NULL;
+}
+
+
+
+static void
+systray_sn_host_watcher_signal (GDBusConnection *connection,
+                                const gchar     *sender_name,
+                                const gchar     *object_path,
+                                const gchar     *interface_name,
+                                const gchar     *signal_name,
+                                GVariant        *parameters,
+                                gpointer         user_data)
+{
+  SystraySnHost *host = XFCE_SYSTRAY_SN_HOST (user_data);
+  const gchar   *service;
+
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SN_HOST (host));
+
+  if (host->is_watcher
+      || !g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(s)")))
+    return;
+
+  g_variant_get (parameters, "(&s)", &service);
+
+  /* the sender is the watcher, so object paths without a bus
+   * name can not be resolved */
+  if (g_strcmp0 (signal_name, "StatusNotifierItemRegistered") == 0)
+    systray_sn_host_item_add (host, service, NULL);
+  else if (g_strcmp0 (signal_name, "StatusNotifierItemUnregistered") == 0)
+    systray_sn_host_item_remove (host, service);
+}
+
+
+
+static void
+systray_sn_host_watcher_items (GObject      *source_object,
+                               GAsyncResult *result,
+                               gpointer      user_data)
+{
+  SystraySnHost *host;
+  GVariant      *reply;
+  GVariant      *services;
+  GVariantIter   iter;
+  const gchar   *service;
+  GError        *error = NULL;
+
+  reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object), result, &error);
+  if (G_UNLIKELY (reply == NULL))
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        panel_debug (PANEL_DEBUG_SYSTRAY, "failed to get the registered items: %s",
+                     error->message);
+      g_error_free (error);
+      return;
+    }
+
+  host = XFCE_SYSTRAY_SN_HOST (user_data);
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SN_HOST (host));
+
+  g_variant_get (reply, "(v)", &services);
+  if (!host->is_watcher
+      && g_variant_is_of_type (services, G_VARIANT_TYPE_STRING_ARRAY))
+    {
+      g_variant_iter_init (&iter, services);
+      while (g_variant_iter_next (&iter, "&s", &service))
+        systray_sn_host_item_add (host, service, NULL);
+    }
+
+  g_variant_unref (services);
+  g_variant_unref (reply);
+}
+
+
+
+static void
+systray_sn_host_watcher_follow (SystraySnHost *host)
+{
+  /* we are also notified when we got the name ourselves */
+  if (host->is_watcher)
+    return;
+
+  panel_debug (PANEL_DEBUG_SYSTRAY, "following the status notifier watcher");
+
+  if (host->watcher_signal_id == 0)
+    host->watcher_signal_id =
+        g_dbus_connection_signal_subscribe (host->connection,
+                                            SYSTRAY_SN_WATCHER_NAME,
+                                            SYSTRAY_SN_WATCHER_INTERFACE,
+                                            NULL,
+                                            SYSTRAY_SN_WATCHER_PATH,
+                                            NULL,
+                                            G_DBUS_SIGNAL_FLAGS_NONE,
+                                            systray_sn_host_watcher_signal,
+                                            host, NULL);
+
+  g_dbus_connection_call (host->connection,
+                          SYSTRAY_SN_WATCHER_NAME,
+                          SYSTRAY_SN_WATCHER_PATH,
+                          SYSTRAY_SN_WATCHER_INTERFACE,
+                          "RegisterStatusNotifierHost",
+                          g_variant_new ("(s)", host->host_name),
+                          NULL,
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1, NULL, NULL, NULL);
+
+  g_dbus_connection_call (host->connection,
+                          SYSTRAY_SN_WATCHER_NAME,
+                          SYSTRAY_SN_WATCHER_PATH,
+                          "org.freedesktop.DBus.Properties",
+                          "Get",
+                          g_variant_new ("(ss)", SYSTRAY_SN_WATCHER_INTERFACE,
+                                         "RegisteredStatusNotifierItems"),
+                          G_VARIANT_TYPE ("(v)"),
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1,
+                          host->cancellable,
+                          systray_sn_host_watcher_items,
+                          host);
+}
+
+
+
+static void
+systray_sn_host_watcher_unfollow (SystraySnHost *host)
+{
+  if (host->watcher_signal_id != 0)
+    {
+      g_dbus_connection_signal_unsubscribe (host->connection, host->watcher_signal_id);
+      host->watcher_signal_id = 0;
+    }
+
+  /* drop a pending list of items of the previous watcher */
+  g_cancellable_cancel (host->cancellable);
+  g_object_unref (G_OBJECT (host->cancellable));
+  host->cancellable = g_cancellable_new ();
+
+  systray_sn_host_item_remove_all (host);
+}
+
+
+
+static void
+systray_sn_host_watcher_acquired (GDBusConnection *connection,
+                                  const gchar     *name,
+                                  gpointer         user_data)
+{
+  SystraySnHost *host = XFCE_SYSTRAY_SN_HOST (user_data);
+
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SN_HOST (host));
+
+  panel_debug (PANEL_DEBUG_SYSTRAY, "acquired the status notifier watcher name");
+
+  /* the items of the previous watcher register again with us */
+  if (!host->is_watcher)
+    systray_sn_host_watcher_unfollow (host);
+
+  host->is_watcher = TRUE;
+  systray_sn_host_emit_watcher_signal (host, "StatusNotifierHostRegistered", NULL);
+}
+
+
+
+static void
+systray_sn_host_watcher_lost (GDBusConnection *connection,
+                              const gchar     *name,
+                              gpointer         user_data)
+{
+  SystraySnHost *host = XFCE_SYSTRAY_SN_HOST (user_data);
+
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SN_HOST (host));
+
+  if (connection == NULL || g_dbus_connection_is_closed (connection))
+    return;
+
+  /* another process serves the watcher, the name request stays
+   * queued so we take over when it leaves */
+  if (host->is_watcher)
+    {
+      systray_sn_host_item_remove_all (host);
+      host->is_watcher = FALSE;
+    }
+
+  if (host->serve_watcher)
+    systray_sn_host_watcher_follow (host);
+}
+
+
+
+static void
+systray_sn_host_watcher_serve (SystraySnHost *host)
+{
+  static GDBusNodeInfo *node_info = NULL;
+  GError               *error = NULL;
+
+  if (host->watcher_object_id == 0)
+    {
+      if (G_UNLIKELY (node_info == NULL))
+        node_info = g_dbus_node_info_new_for_xml (systray_sn_host_watcher_xml, NULL);
+      panel_assert (node_info != NULL);
+
+      host->watcher_object_id = g_dbus_connection_register_object (host->connection,
+                                                                   SYSTRAY_SN_WATCHER_PATH,
+                                                                   node_info->interfaces[0],
+                                                                   &systray_sn_host_watcher_vtable,
+                                                                   host, NULL, &error);
+      if (host->watcher_object_id == 0)
+        {
+          /* another notification area in this process exports the
+           * watcher, we follow it and try again when it leaves the name */
+          panel_debug (PANEL_DEBUG_SYSTRAY, "not serving the status notifier watcher: %s",
+                       error->message);
+          g_error_free (error);
+          return;
+        }
+    }
+
+  /* the request stays queued while another process owns the name */
+  if (host->watcher_owner_id == 0)
+    host->watcher_owner_id = g_bus_own_name_on_connection (host->connection,
+                                                           SYSTRAY_SN_WATCHER_NAME,
+                                                           G_BUS_NAME_OWNER_FLAGS_NONE,
+                                                           systray_sn_host_watcher_acquired,
+                                                           systray_sn_host_watcher_lost,
+                                                           host, NULL);
+}
+
+
+
+static void
+systray_sn_host_watcher_unserve (SystraySnHost *host)
+{
+  if (host->watcher_owner_id != 0)
+    {
+      g_bus_unown_name (host->watcher_owner_id);
+      host->watcher_owner_id = 0;
+    }
+
+  if (host->watcher_object_id != 0)
+    {
+      g_dbus_connection_unregister_object (host->connection, host->watcher_object_id);
+      host->watcher_object_id = 0;
+    }
+
+  /* the items register again with the next watcher, which we
+   * follow once it appears on the bus */
+  if (host->is_watcher)
+    {
+      host->is_watcher = FALSE;
+      systray_sn_host_item_remove_all (host);
+    }
+}
+
+
+
+static void
+systray_sn_host_watcher_appeared (GDBusConnection *connection,
+                                  const gchar     *name,
+                                  const gchar     *name_owner,
+                                  gpointer         user_data)
+{
+  SystraySnHost *host = XFCE_SYSTRAY_SN_HOST (user_data);
+
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SN_HOST (host));
+
+  host->watcher_present = TRUE;
+
+  /* a foreign watcher also shows its items in the applet of the
+   * desktop that runs it, so only follow it if enabled */
+  if (host->serve_watcher)
+    systray_sn_host_watcher_follow (host);
+}
+
+
+
+static void
+systray_sn_host_watcher_vanished (GDBusConnection *connection,
+                                  const gchar     *name,
+                                  gpointer         user_data)
+{
+  SystraySnHost *host = XFCE_SYSTRAY_SN_HOST (user_data);
+
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SN_HOST (host));
+
+  if (connection == NULL || g_dbus_connection_is_closed (connection))
+    return;
+
+  host->watcher_present = FALSE;
+
+  if (!host->is_watcher)
+    systray_sn_host_watcher_unfollow (host);
+
+  /* take over from the previous watcher */
+  if (host->serve_watcher)
+    systray_sn_host_watcher_serve (host);
+}
+
+
+
+static void
+systray_sn_host_bus_get (GObject      *source_object,
+                         GAsyncResult *result,
+                         gpointer      user_data)
+{
+  SystraySnHost   *host;
+  GDBusConnection *connection;
+  GError          *error = NULL;
+
+  connection = g_bus_get_finish (result, &error);
+  if (G_UNLIKELY (connection == NULL))
+    {
+      /* the xembed tray keeps working without a session bus */
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        panel_debug (PANEL_DEBUG_SYSTRAY, "no session bus for status notifier items: %s",
+                     error->message);
+      g_error_free (error);
+      return;
+    }
+
+  host = XFCE_SYSTRAY_SN_HOST (user_data);
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SN_HOST (host));
+
+  host->connection = connection;
+  host->host_owner_id = g_bus_own_name_on_connection (connection, host->host_name,
+                                                      G_BUS_NAME_OWNER_FLAGS_NONE,
+                                                      NULL, NULL, NULL, NULL);
+
+  /* track the owner of the watcher name; serving and following the
+   * watcher are both optional, since we do not render item menus */
+  host->watcher_watch_id = g_bus_watch_name_on_connection (connection,
+                                                           SYSTRAY_SN_WATCHER_NAME,
+                                                           G_BUS_NAME_WATCHER_FLAGS_NONE,
+                                                           systray_sn_host_watcher_appeared,
+                                                           systray_sn_host_watcher_vanished,
+                                                           host, NULL);
+
+  if (host->serve_watcher)
+    systray_sn_host_watcher_serve (host);
+}
+
+
+
+SystraySnHost *
+systray_sn_host_new (void)
+{
+  SystraySnHost *host;
+
+  host = g_object_new (XFCE_TYPE_SYSTRAY_SN_HOST, NULL);
+
+  g_bus_get (G_BUS_TYPE_SESSION, host->cancellable,
+             systray_sn_host_bus_get, host);
+
+  return host;
+}
+
+
+
+void
+systray_sn_host_set_serve_watcher (SystraySnHost *host,
+                                   gboolean       serve_watcher)
+{
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SN_HOST (host));
+
+  serve_watcher = !!serve_watcher;
+  if (host->serve_watcher == serve_watcher)
+    return;
+
+  host->serve_watcher = serve_watcher;
+
+  /* otherwise applied once we are on the bus */
+  if (host->connection == NULL)
+    return;
+
+  if (serve_watcher)
+    {
+      systray_sn_host_watcher_serve (host);
+
+      /* show the items of the watcher that already owns the name */
+      if (host->watcher_present)
+        systray_sn_host_watcher_follow (host);
+    }
+  else
+    {
+      systray_sn_host_watcher_unserve (host);
+      systray_sn_host_watcher_unfollow (host);
+    }
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __SYSTRAY_SN_HOST_H__
+#define __SYSTRAY_SN_HOST_H__
+
+#include <gtk/gtk.h>
+
+typedef struct _SystraySnHostClass SystraySnHostClass;
+typedef struct _SystraySnHost      SystraySnHost;
+
+#define XFCE_TYPE_SYSTRAY_SN_HOST            (systray_sn_host_get_type ())
+#define XFCE_SYSTRAY_SN_HOST(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), XFCE_TYPE_SYSTRAY_SN_HOST, SystraySnHost))
+#define XFCE_SYSTRAY_SN_HOST_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), XFCE_TYPE_SYSTRAY_SN_HOST, SystraySnHostClass))
+#define XFCE_IS_SYSTRAY_SN_HOST(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), XFCE_TYPE_SYSTRAY_SN_HOST))
+#define XFCE_IS_SYSTRAY_SN_HOST_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), XFCE_TYPE_SYSTRAY_SN_HOST))
+#define XFCE_SYSTRAY_SN_HOST_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), XFCE_TYPE_SYSTRAY_SN_HOST, SystraySnHostClass))
+
+GType          systray_sn_host_get_type          (void) G_GNUC_CONST;
+
+void           systray_sn_host_register_type     (GTypeModule   *type_module);
+
+SystraySnHost *systray_sn_host_new               (void) G_GNUC_MALLOC;
+
+void           systray_sn_host_set_serve_watcher (SystraySnHost *host,
+                                                  gboolean       serve_watcher);
+
+#endif /* !__SYSTRAY_SN_HOST_H__ */
@@ -0,0 +1,899 @@
+/*
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <gtk/gtk.h>
+#include <gio/gio.h>
+
+#include <libxfce4panel/libxfce4panel.h>
+
+#include <common/panel-private.h>
+#include <common/panel-debug.h>
+
+#include "systray-sn-item.h"
+
+
+
+#define SYSTRAY_SN_ITEM_INTERFACE  "org.kde.StatusNotifierItem"
+
+/* requested size of the item, the box allocates the row size */
+#define SYSTRAY_SN_ITEM_SIZE       (16)
+
+/* largest width or height of an icon pixmap we convert */
+#define SYSTRAY_SN_ITEM_PIXMAP_MAX (1024)
+
+
+
+static void     systray_sn_item_finalize             (GObject          *object);
+static void     systray_sn_item_get_preferred_width  (GtkWidget        *widget,
+                                                      gint             *minimum_width,
+                                                      gint             *natural_width);
+static void     systray_sn_item_get_preferred_height (GtkWidget        *widget,
+                                                      gint             *minimum_height,
+                                                      gint             *natural_height);
+static gboolean systray_sn_item_button_press_event   (GtkWidget        *widget,
+                                                      GdkEventButton   *event);
+static gboolean systray_sn_item_button_release_event (GtkWidget        *widget,
+                                                      GdkEventButton   *event);
+static gboolean systray_sn_item_scroll_event         (GtkWidget        *widget,
+                                                      GdkEventScroll   *event);
+static void     systray_sn_item_signal               (GDBusConnection  *connection,
+                                                      const gchar      *sender_name,
+                                                      const gchar      *object_path,
+                                                      const gchar      *interface_name,
+                                                      const gchar      *signal_name,
+                                                      GVariant         *parameters,
+                                                      gpointer          user_data);
+static void     systray_sn_item_fetch                (SystraySnItem    *item);
+static void     systray_sn_item_update               (SystraySnItem    *item);
+
+
+
+enum
+{
+  READY,
+  EXPIRED,
+  LAST_SIGNAL
+};
+
+struct _SystraySnItemClass
+{
+  GtkEventBoxClass __parent__;
+};
+
+struct _SystraySnItem
+{
+  GtkEventBox __parent__;
+
+  GtkWidget       *image;
+
+  /* address of the item on the bus */
+  GDBusConnection *connection;
+  gchar           *bus_name;
+  gchar           *object_path;
+  guint            signal_id;
+
+  /* pending property fetch */
+  GCancellable    *cancellable;
+  guint            fetch_idle_id;
+
+  guint            ready : 1;
+  guint            hidden : 1;
+  guint            item_is_menu : 1;
+
+  /* item properties */
+  gchar           *id;
+  gchar           *title;
+  gchar           *status;
+  gchar           *icon_name;
+  gchar           *attention_icon_name;
+  gchar           *icon_theme_path;
+  gchar           *tooltip_title;
+  gchar           *tooltip_text;
+  GVariant        *icon_pixmap;
+  GVariant        *attention_icon_pixmap;
+
+  /* what is currently shown in the image */
+  gchar           *image_source;
+  GVariant        *image_pixmap;
+};
+
+
+
+static guint systray_sn_item_signals[LAST_SIGNAL];
+
+
+
+XFCE_PANEL_DEFINE_TYPE (SystraySnItem, systray_sn_item, GTK_TYPE_EVENT_BOX)
+
+
+
+static void
+systray_sn_item_class_init (SystraySnItemClass *klass)
+{
+  GtkWidgetClass *gtkwidget_class;
+  GObjectClass   *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = systray_sn_item_finalize;
+
+  gtkwidget_class = GTK_WIDGET_CLASS (klass);
+  gtkwidget_class->get_preferred_width = systray_sn_item_get_preferred_width;
+  gtkwidget_class->get_preferred_height = systray_sn_item_get_preferred_height;
+  gtkwidget_class->button_press_event = systray_sn_item_button_press_event;
+  gtkwidget_class->button_release_event = systray_sn_item_button_release_event;
+  gtkwidget_class->scroll_event = systray_sn_item_scroll_event;
+
+  systray_sn_item_signals[READY] =
+      g_signal_new (g_intern_static_string ("ready"),
+                    G_OBJECT_CLASS_TYPE (klass),
+                    G_SIGNAL_RUN_LAST,
+                    0, NULL, NULL,
+                    g_cclosure_marshal_VOID__VOID,
+                    G_TYPE_NONE, 0);
+
+  systray_sn_item_signals[EXPIRED] =
+      g_signal_new (g_intern_static_string ("expired"),
+                    G_OBJECT_CLASS_TYPE (klass),
+                    G_SIGNAL_RUN_LAST,
+                    0, NULL, NULL,
+                    g_cclosure_marshal_VOID__VOID,
+                    G_TYPE_NONE, 0);
+}
+
+
+
+static void
+systray_sn_item_init (SystraySnItem *item)
+{
+  item->connection = NULL;
+  item->bus_name = NULL;
+  item->object_path = NULL;
+  item->signal_id = 0;
+  item->cancellable = NULL;
+  item->fetch_idle_id = 0;
+  item->ready = FALSE;
+  item->hidden = FALSE;
+  item->item_is_menu = FALSE;
+  item->id = NULL;
+  item->title = NULL;
+  item->status = NULL;
+  item->icon_name = NULL;
+  item->attention_icon_name = NULL;
+  item->icon_theme_path = NULL;
+  item->tooltip_title = NULL;
+  item->tooltip_text = NULL;
+  item->icon_pixmap = NULL;
+  item->attention_icon_pixmap = NULL;
+  item->image_source = NULL;
+  item->image_pixmap = NULL;
+
+  /* only an input window, the image is drawn on the panel */
+  gtk_event_box_set_visible_window (GTK_EVENT_BOX (item), FALSE);
+  gtk_widget_add_events (GTK_WIDGET (item), GDK_BUTTON_PRESS_MASK
+                         | GDK_BUTTON_RELEASE_MASK | GDK_SCROLL_MASK);
+
+  item->image = xfce_panel_image_new ();
+  gtk_container_add (GTK_CONTAINER (item), item->image);
+  gtk_widget_show (item->image);
+}
+
+
+
+static void
+systray_sn_item_properties_clear (SystraySnItem *item)
+{
+  g_free (item->id);
+  g_free (item->title);
+  g_free (item->status);
+  g_free (item->icon_name);
+  g_free (item->attention_icon_name);
+  g_free (item->icon_theme_path);
+  g_free (item->tooltip_title);
+  g_free (item->tooltip_text);
+
+  item->id = NULL;
+  item->title = NULL;
+  item->status = NULL;
+  item->icon_name = NULL;
+  item->attention_icon_name = NULL;
+  item->icon_theme_path = NULL;
+  item->tooltip_title = NULL;
+  item->tooltip_text = NULL;
+  item->item_is_menu = FALSE;
+
+  if (item->icon_pixmap != NULL)
+    {
+      g_variant_unref (item->icon_pixmap);
+      item->icon_pixmap = NULL;
+    }
+
+  if (item->attention_icon_pixmap != NULL)
+    {
+      g_variant_unref (item->attention_icon_pixmap);
+      item->attention_icon_pixmap = NULL;
+    }
+}
+
+
+
+static void
+systray_sn_item_finalize (GObject *object)
+{
+  SystraySnItem *item = XFCE_SYSTRAY_SN_ITEM (object);
+
+  if (item->fetch_idle_id != 0)
+    g_source_remove (item->fetch_idle_id);
+
+  /* the callback of a cancelled call does not touch the item */
+  if (item->cancellable != NULL)
+    {
+      g_cancellable_cancel (item->cancellable);
+      g_object_unref (G_OBJECT (item->cancellable));
+    }
+
+  if (item->signal_id != 0)
+    g_dbus_connection_signal_unsubscribe (item->connection, item->signal_id);
+
+  systray_sn_item_properties_clear (item);
+
+  g_free (item->image_source);
+  if (item->image_pixmap != NULL)
+    g_variant_unref (item->image_pixmap);
+
+  g_free (item->bus_name);
+  g_free (item->object_path);
+  g_object_unref (G_OBJECT (item->connection));
+
+  G_OBJECT_CLASS (systray_sn_item_parent_class)->finalize (object);
+}
+
+
+
+static void
+systray_sn_item_get_preferred_width (GtkWidget *widget,
+                                     gint      *minimum_width,
+                                     gint      *natural_width)
+{
+  if (minimum_width != NULL)
+    *minimum_width = 0;
+
+  if (natural_width != NULL)
+    *natural_width = SYSTRAY_SN_ITEM_SIZE;
+}
+
+
+
+static void
+systray_sn_item_get_preferred_height (GtkWidget *widget,
+                                      gint      *minimum_height,
+                                      gint      *natural_height)
+{
+  if (minimum_height != NULL)
+    *minimum_height = 0;
+
+  if (natural_height != NULL)
+    *natural_height = SYSTRAY_SN_ITEM_SIZE;
+}
+
+
+
+static void
+systray_sn_item_call (SystraySnItem *item,
+                      const gchar   *method,
+                      GVariant      *parameters)
+{
+  panel_debug_filtered (PANEL_DEBUG_SYSTRAY, "calling %s on %s%s",
+      method, item->bus_name, item->object_path);
+
+  /* fire and forget, the item handles the action itself */
+  g_dbus_connection_call (item->connection,
+                          item->bus_name,
+                          item->object_path,
+                          SYSTRAY_SN_ITEM_INTERFACE,
+                          method,
+                          parameters,
+                          NULL,
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1, NULL, NULL, NULL);
+}
+
+
+
+static gboolean
+systray_sn_item_button_press_event (GtkWidget      *widget,
+                                    GdkEventButton *event)
+{
+  /* handle the buttons on release, but keep the press away from
+   * the panel plugin which would popup its own menu */
+  return event->button >= 1 && event->button <= 3;
+}
+
+
+
+static gboolean
+systray_sn_item_button_release_event (GtkWidget      *widget,
+                                      GdkEventButton *event)
+{
+  SystraySnItem *item = XFCE_SYSTRAY_SN_ITEM (widget);
+  const gchar   *method;
+
+  switch (event->button)
+    {
+    case 1:
+      /* items that only have a menu want it on the primary button */
+      method = item->item_is_menu ? "ContextMenu" : "Activate";
+      break;
+
+    case 2:
+      method = "SecondaryActivate";
+      break;
+
+    case 3:
+      method = "ContextMenu";
+      break;
+
+    default:
+      return FALSE;
+    }
+
+  systray_sn_item_call (item, method,
+                        g_variant_new ("(ii)", (gint) event->x_root, (gint) event->y_root));
+
+  return TRUE;
+}
+
+
+
+static gboolean
+systray_sn_item_scroll_event (GtkWidget      *widget,
+                              GdkEventScroll *event)
+{
+  SystraySnItem *item = XFCE_SYSTRAY_SN_ITEM (widget);
+  gint           delta;
+  const gchar   *orientation;
+  gdouble        delta_x, delta_y;
+
+  switch (event->direction)
+    {
+    case GDK_SCROLL_UP:
+      delta = 1;
+      orientation = "vertical";
+      break;
+
+    case GDK_SCROLL_DOWN:
+      delta = -1;
+      orientation = "vertical";
+      break;
+
+    case GDK_SCROLL_LEFT:
+      delta = 1;
+      orientation = "horizontal";
+      break;
+
+    case GDK_SCROLL_RIGHT:
+      delta = -1;
+      orientation = "horizontal";
+      break;
+
+    default:
+      if (!gdk_event_get_scroll_deltas ((GdkEvent *) event, &delta_x, &delta_y)
+          || (delta_x == 0.0 && delta_y == 0.0))
+        return FALSE;
+
+      if (ABS (delta_y) >= ABS (delta_x))
+        {
+          delta = delta_y < 0.0 ? 1 : -1;
+          orientation = "vertical";
+        }
+      else
+        {
+          delta = delta_x < 0.0 ? 1 : -1;
+          orientation = "horizontal";
+        }
+      break;
+    }
+
+  systray_sn_item_call (item, "Scroll", g_variant_new ("(is)", delta, orientation));
+
+  return TRUE;
+}
+
+
+
+static void
+systray_sn_item_signal (GDBusConnection *connection,
+                        const gchar     *sender_name,
+                        const gchar     *object_path,
+                        const gchar     *interface_name,
+                        const gchar     *signal_name,
+                        GVariant        *parameters,
+                        gpointer         user_data)
+{
+  SystraySnItem *item = XFCE_SYSTRAY_SN_ITEM (user_data);
+
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SN_ITEM (item));
+
+  /* NewIcon, NewAttentionIcon, NewStatus, NewTitle, NewToolTip... carry
+   * no or only partial data, reload the properties */
+  if (g_str_has_prefix (signal_name, "New"))
+    systray_sn_item_fetch (item);
+}
+
+
+
+static gchar *
+systray_sn_item_dup_string (GVariant *value)
+{
+  const gchar *str;
+
+  if (!g_variant_is_of_type (value, G_VARIANT_TYPE_STRING)
+      && !g_variant_is_of_type (value, G_VARIANT_TYPE_OBJECT_PATH))
+    return NULL;
+
+  str = g_variant_get_string (value, NULL);
+  if (panel_str_is_empty (str))
+    return NULL;
+
+  return g_strdup (str);
+}
+
+
+
+static GVariant *
+systray_sn_item_dup_pixmap (GVariant *value)
+{
+  if (!g_variant_is_of_type (value, G_VARIANT_TYPE ("a(iiay)"))
+      || g_variant_n_children (value) == 0)
+    return NULL;
+
+  return g_variant_ref (value);
+}
+
+
+
+static void
+systray_sn_item_properties_set (SystraySnItem *item,
+                                GVariant      *properties)
+{
+  GVariantIter  iter;
+  const gchar  *key;
+  GVariant     *value;
+
+  systray_sn_item_properties_clear (item);
+
+  g_variant_iter_init (&iter, properties);
+  while (g_variant_iter_loop (&iter, "{&sv}", &key, &value))
+    {
+      if (strcmp (key, "Id") == 0)
+        item->id = systray_sn_item_dup_string (value);
+      else if (strcmp (key, "Title") == 0)
+        item->title = systray_sn_item_dup_string (value);
+      else if (strcmp (key, "Status") == 0)
+        item->status = systray_sn_item_dup_string (value);
+      else if (strcmp (key, "IconName") == 0)
+        item->icon_name = systray_sn_item_dup_string (value);
+      else if (strcmp (key, "AttentionIconName") == 0)
+        item->attention_icon_name = systray_sn_item_dup_string (value);
+      else if (strcmp (key, "IconThemePath") == 0)
+        item->icon_theme_path = systray_sn_item_dup_string (value);
+      else if (strcmp (key, "IconPixmap") == 0)
+        item->icon_pixmap = systray_sn_item_dup_pixmap (value);
+      else if (strcmp (key, "AttentionIconPixmap") == 0)
+        item->attention_icon_pixmap = systray_sn_item_dup_pixmap (value);
+      else if (strcmp (key, "ItemIsMenu") == 0
+               && g_variant_is_of_type (value, G_VARIANT_TYPE_BOOLEAN))
+        item->item_is_menu = g_variant_get_boolean (value);
+      else if (strcmp (key, "ToolTip") == 0
+               && g_variant_is_of_type (value, G_VARIANT_TYPE ("(sa(iiay)ss)")))
+        {
+          g_variant_get (value, "(s@a(iiay)ss)", NULL, NULL,
+                         &item->tooltip_title, &item->tooltip_text);
+
+          if (panel_str_is_empty (item->tooltip_title))
+            {
+              g_free (item->tooltip_title);
+              item->tooltip_title = NULL;
+            }
+
+          if (panel_str_is_empty (item->tooltip_text))
+            {
+              g_free (item->tooltip_text);
+              item->tooltip_text = NULL;
+            }
+        }
+    }
+}
+
+
+
+static void
+systray_sn_item_fetch_finished (GObject      *source_object,
+                                GAsyncResult *result,
+                                gpointer      user_data)
+{
+  SystraySnItem *item;
+  GVariant      *reply;
+  GVariant      *properties;
+  GError        *error = NULL;
+
+  reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object), result, &error);
+  if (G_UNLIKELY (reply == NULL))
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+          item = XFCE_SYSTRAY_SN_ITEM (user_data);
+
+          panel_debug (PANEL_DEBUG_SYSTRAY, "failed to get the properties of %s%s: %s",
+                       item->bus_name, item->object_path, error->message);
+
+          /* the item was never shown, nothing to talk to; the host
+           * releases the item in the handler */
+          if (!item->ready)
+            {
+              g_object_ref (G_OBJECT (item));
+              g_signal_emit (G_OBJECT (item), systray_sn_item_signals[EXPIRED], 0);
+              g_object_unref (G_OBJECT (item));
+            }
+        }
+
+      g_error_free (error);
+      return;
+    }
+
+  item = XFCE_SYSTRAY_SN_ITEM (user_data);
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SN_ITEM (item));
+
+  g_variant_get (reply, "(@a{sv})", &properties);
+  systray_sn_item_properties_set (item, properties);
+  g_variant_unref (properties);
+  g_variant_unref (reply);
+
+  systray_sn_item_update (item);
+
+  if (!item->ready)
+    {
+      item->ready = TRUE;
+      g_signal_emit (G_OBJECT (item), systray_sn_item_signals[READY], 0);
+    }
+}
+
+
+
+static gboolean
+systray_sn_item_fetch_idle (gpointer user_data)
+{
+  SystraySnItem *item = XFCE_SYSTRAY_SN_ITEM (user_data);
+
+  panel_return_val_if_fail (XFCE_IS_SYSTRAY_SN_ITEM (item), FALSE);
+
+  /* a newer fetch replaces the running one */
+  if (item->cancellable != NULL)
+    {
+      g_cancellable_cancel (item->cancellable);
+      g_object_unref (G_OBJECT (item->cancellable));
+    }
+  item->cancellable = g_cancellable_new ();
+
+  g_dbus_connection_call (item->connection,
+                          item->bus_name,
+                          item->object_path,
+                          "org.freedesktop.DBus.Properties",
+                          "GetAll",
+                          g_variant_new ("(s)", SYSTRAY_SN_ITEM_INTERFACE),
+                          G_VARIANT_TYPE ("(a{sv})"),
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1,
+                          item->cancellable,
+                          systray_sn_item_fetch_finished,
+                          item);
+
+  return FALSE;
+}
+
+
+
+static void
+systray_sn_item_fetch_idle_destroyed (gpointer user_data)
+{
+  XFCE_SYSTRAY_SN_ITEM (user_data)->fetch_idle_id = 0;
+}
+
+
+
+static void
+systray_sn_item_fetch (SystraySnItem *item)
+{
+  /* items often emit a couple of signals at once, handle them in
+   * one round trip */
+  if (item->fetch_idle_id == 0)
+    item->fetch_idle_id = gdk_threads_add_idle_full (G_PRIORITY_DEFAULT_IDLE,
+                                                     systray_sn_item_fetch_idle, item,
+                                                     systray_sn_item_fetch_idle_destroyed);
+}
+
+
+
+static void
+systray_sn_item_icon_theme_add_path (SystraySnItem *item)
+{
+  GtkIconTheme  *icon_theme;
+  gchar        **paths;
+  gint           n_paths, i;
+  gboolean       found = FALSE;
+
+  icon_theme = gtk_icon_theme_get_for_screen (gtk_widget_get_screen (GTK_WIDGET (item)));
+  gtk_icon_theme_get_search_path (icon_theme, &paths, &n_paths);
+  for (i = 0; !found && i < n_paths; i++)
+    found = g_strcmp0 (paths[i], item->icon_theme_path) == 0;
+  g_strfreev (paths);
+
+  /* this changes the theme, so only do it once for each path */
+  if (!found)
+    gtk_icon_theme_append_search_path (icon_theme, item->icon_theme_path);
+}
+
+
+
+GdkPixbuf *
+systray_sn_item_pixbuf_from_pixmap (GVariant *pixmap)
+{
+  GVariantIter  iter;
+  gint          width, height;
+  gint          best_width = 0, best_height = 0;
+  GVariant     *data, *best_data = NULL;
+  const guchar *src;
+  gsize         n_bytes;
+  GdkPixbuf    *pixbuf;
+  guchar       *pixels, *dst;
+  gint          rowstride, x, y;
+
+  panel_return_val_if_fail (g_variant_is_of_type (pixmap, G_VARIANT_TYPE ("a(iiay)")), NULL);
+
+  /* use the largest image, the panel image scales it down to the
+   * allocation and keeps the result; the bound also keeps the size
+   * of the data from overflowing */
+  g_variant_iter_init (&iter, pixmap);
+  while (g_variant_iter_next (&iter, "(ii@ay)", &width, &height, &data))
+    {
+      if (width > best_width && width <= SYSTRAY_SN_ITEM_PIXMAP_MAX
+          && height > 0 && height <= SYSTRAY_SN_ITEM_PIXMAP_MAX
+          && g_variant_get_size (data) >= (gsize) width * height * 4)
+        {
+          if (best_data != NULL)
+            g_variant_unref (best_data);
+
+          best_data = data;
+          best_width = width;
+          best_height = height;
+        }
+      else
+        {
+          g_variant_unref (data);
+        }
+    }
+
+  if (best_data == NULL)
+    return NULL;
+
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, best_width, best_height);
+  if (G_UNLIKELY (pixbuf == NULL))
+    {
+      g_variant_unref (best_data);
+      return NULL;
+    }
+
+  /* convert the argb32 data in network byte order */
+  src = g_variant_get_fixed_array (best_data, &n_bytes, sizeof (guchar));
+  pixels = gdk_pixbuf_get_pixels (pixbuf);
+  rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+
+  for (y = 0; y < best_height; y++)
+    {
+      dst = pixels + y * rowstride;
+      for (x = 0; x < best_width; x++, src += 4, dst += 4)
+        {
+          dst[0] = src[1];
+          dst[1] = src[2];
+          dst[2] = src[3];
+          dst[3] = src[0];
+        }
+    }
+
+  g_variant_unref (best_data);
+
+  return pixbuf;
+}
+
+
+
+static void
+systray_sn_item_update_image (SystraySnItem *item,
+                              const gchar   *icon_name,
+                              GVariant      *pixmap)
+{
+  GdkPixbuf    *pixbuf;
+  GtkIconTheme *icon_theme;
+
+  if (icon_name != NULL && !g_path_is_absolute (icon_name))
+    {
+      if (item->icon_theme_path != NULL)
+        systray_sn_item_icon_theme_add_path (item);
+
+      /* applications send both if the name is not in every theme */
+      icon_theme = gtk_icon_theme_get_for_screen (gtk_widget_get_screen (GTK_WIDGET (item)));
+      if (pixmap != NULL && !gtk_icon_theme_has_icon (icon_theme, icon_name))
+        icon_name = NULL;
+    }
+
+  if (icon_name != NULL)
+    {
+      /* icon names are loaded through the shared pixbuf cache */
+      if (item->image_pixmap != NULL
+          || g_strcmp0 (item->image_source, icon_name) != 0)
+        xfce_panel_image_set_from_source (XFCE_PANEL_IMAGE (item->image), icon_name);
+
+      pixmap = NULL;
+    }
+  else if (pixmap != NULL)
+    {
+      /* icons are often re-sent unchanged along with another property */
+      if (item->image_pixmap == NULL
+          || !g_variant_equal (item->image_pixmap, pixmap))
+        {
+          pixbuf = systray_sn_item_pixbuf_from_pixmap (pixmap);
+          xfce_panel_image_set_from_pixbuf (XFCE_PANEL_IMAGE (item->image), pixbuf);
+          if (G_LIKELY (pixbuf != NULL))
+            g_object_unref (G_OBJECT (pixbuf));
+        }
+    }
+  else
+    {
+      xfce_panel_image_clear (XFCE_PANEL_IMAGE (item->image));
+    }
+
+  g_free (item->image_source);
+  item->image_source = g_strdup (icon_name);
+
+  if (item->image_pixmap != NULL)
+    g_variant_unref (item->image_pixmap);
+  item->image_pixmap = pixmap != NULL ? g_variant_ref (pixmap) : NULL;
+}
+
+
+
+static void
+systray_sn_item_update (SystraySnItem *item)
+{
+  gboolean     attention;
+  const gchar *icon_name;
+  GVariant    *pixmap;
+  const gchar *title;
+  gchar       *tooltip;
+
+  attention = g_strcmp0 (item->status, "NeedsAttention") == 0;
+
+  icon_name = item->icon_name;
+  pixmap = item->icon_pixmap;
+  if (attention && (item->attention_icon_name != NULL || item->attention_icon_pixmap != NULL))
+    {
+      icon_name = item->attention_icon_name;
+      pixmap = item->attention_icon_pixmap;
+    }
+
+  systray_sn_item_update_image (item, icon_name, pixmap);
+
+  title = item->tooltip_title != NULL ? item->tooltip_title : item->title;
+  if (title != NULL && item->tooltip_text != NULL)
+    {
+      tooltip = g_strconcat (title, "\n", item->tooltip_text, NULL);
+      gtk_widget_set_tooltip_text (GTK_WIDGET (item), tooltip);
+      g_free (tooltip);
+    }
+  else
+    {
+      gtk_widget_set_tooltip_text (GTK_WIDGET (item),
+                                   title != NULL ? title : item->tooltip_text);
+    }
+
+  /* passive items have nothing to tell the user */
+  gtk_widget_set_visible (GTK_WIDGET (item),
+                          g_strcmp0 (item->status, "Passive") != 0);
+}
+
+
+
+GtkWidget *
+systray_sn_item_new (GDBusConnection *connection,
+                     const gchar     *bus_name,
+                     const gchar     *object_path)
+{
+  SystraySnItem *item;
+
+  panel_return_val_if_fail (G_IS_DBUS_CONNECTION (connection), NULL);
+  panel_return_val_if_fail (g_dbus_is_name (bus_name), NULL);
+  panel_return_val_if_fail (g_variant_is_object_path (object_path), NULL);
+
+  item = g_object_new (XFCE_TYPE_SYSTRAY_SN_ITEM, NULL);
+  item->connection = g_object_ref (G_OBJECT (connection));
+  item->bus_name = g_strdup (bus_name);
+  item->object_path = g_strdup (object_path);
+
+  item->signal_id = g_dbus_connection_signal_subscribe (connection,
+                                                        bus_name,
+                                                        SYSTRAY_SN_ITEM_INTERFACE,
+                                                        NULL,
+                                                        object_path,
+                                                        NULL,
+                                                        G_DBUS_SIGNAL_FLAGS_NONE,
+                                                        systray_sn_item_signal,
+                                                        item, NULL);
+
+  systray_sn_item_fetch (item);
+
+  return GTK_WIDGET (item);
+}
+
+
+
+const gchar *
+systray_sn_item_get_bus_name (SystraySnItem *item)
+{
+  panel_return_val_if_fail (XFCE_IS_SYSTRAY_SN_ITEM (item), NULL);
+
+  return item->bus_name;
+}
+
+
+
+const gchar *
+systray_sn_item_get_name (SystraySnItem *item)
+{
+  panel_return_val_if_fail (XFCE_IS_SYSTRAY_SN_ITEM (item), NULL);
+
+  /* same role as the wm name of an xembed icon */
+  return item->id != NULL ? item->id : item->title;
+}
+
+
+
+gboolean
+systray_sn_item_get_hidden (SystraySnItem *item)
+{
+  panel_return_val_if_fail (XFCE_IS_SYSTRAY_SN_ITEM (item), FALSE);
+
+  return item->hidden;
+}
+
+
+
+void
+systray_sn_item_set_hidden (SystraySnItem *item,
+                            gboolean       hidden)
+{
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SN_ITEM (item));
+
+  item->hidden = hidden;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __SYSTRAY_SN_ITEM_H__
+#define __SYSTRAY_SN_ITEM_H__
+
+#include <gtk/gtk.h>
+#include <gio/gio.h>
+
+typedef struct _SystraySnItemClass SystraySnItemClass;
+typedef struct _SystraySnItem      SystraySnItem;
+
+#define XFCE_TYPE_SYSTRAY_SN_ITEM            (systray_sn_item_get_type ())
+#define XFCE_SYSTRAY_SN_ITEM(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), XFCE_TYPE_SYSTRAY_SN_ITEM, SystraySnItem))
+#define XFCE_SYSTRAY_SN_ITEM_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), XFCE_TYPE_SYSTRAY_SN_ITEM, SystraySnItemClass))
+#define XFCE_IS_SYSTRAY_SN_ITEM(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), XFCE_TYPE_SYSTRAY_SN_ITEM))
+#define XFCE_IS_SYSTRAY_SN_ITEM_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), XFCE_TYPE_SYSTRAY_SN_ITEM))
+#define XFCE_SYSTRAY_SN_ITEM_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), XFCE_TYPE_SYSTRAY_SN_ITEM, SystraySnItemClass))
+
+GType        systray_sn_item_get_type           (void) G_GNUC_CONST;
+
+void         systray_sn_item_register_type      (GTypeModule     *type_module);
+
+GtkWidget   *systray_sn_item_new                (GDBusConnection *connection,
+                                                 const gchar     *bus_name,
+                                                 const gchar     *object_path) G_GNUC_MALLOC;
+
+const gchar *systray_sn_item_get_bus_name       (SystraySnItem   *item);
+
+const gchar *systray_sn_item_get_name           (SystraySnItem   *item);
+
+gboolean     systray_sn_item_get_hidden         (SystraySnItem   *item);
+
+void         systray_sn_item_set_hidden         (SystraySnItem   *item,
+                                                 gboolean         hidden);
+
+GdkPixbuf   *systray_sn_item_pixbuf_from_pixmap (GVariant        *pixmap) G_GNUC_MALLOC;
+
+#endif /* !__SYSTRAY_SN_ITEM_H__ */
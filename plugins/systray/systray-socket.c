@@ -29,6 +29,9 @@
 
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
+#ifdef HAVE_XDAMAGE
+#include <X11/extensions/Xdamage.h>
+#endif
 
 #include <gdk/gdk.h>
 #include <gdk/gdkx.h>
@@ -60,12 +63,23 @@ struct _SystraySocket
   guint            is_composited : 1;
   guint            parent_relative_bg : 1;
   guint            hidden : 1;
+
+  /* copy of a composited icon, updated when the icon is damaged */
+  cairo_surface_t *surface;
+  gint             surface_width;
+  gint             surface_height;
+  guint            surface_damaged : 1;
+
+#ifdef HAVE_XDAMAGE
+  Damage           damage;
+#endif
 };
 
 
 
 static void     systray_socket_finalize      (GObject        *object);
 static void     systray_socket_realize       (GtkWidget      *widget);
+static void     systray_socket_unrealize     (GtkWidget      *widget);
 static void     systray_socket_size_allocate (GtkWidget      *widget,
                                               GtkAllocation  *allocation);
 static gboolean systray_socket_draw          (GtkWidget      *widget,
@@ -75,6 +89,12 @@ static void     systray_socket_style_set     (GtkWidget      *widget,
 
 
 
+#ifdef HAVE_XDAMAGE
+static gint damage_event_base = -1;
+#endif
+
+
+
 XFCE_PANEL_DEFINE_TYPE (SystraySocket, systray_socket, GTK_TYPE_SOCKET)
 
 
@@ -90,6 +110,7 @@ systray_socket_class_init (SystraySocketClass *klass)
 
   gtkwidget_class = GTK_WIDGET_CLASS (klass);
   gtkwidget_class->realize = systray_socket_realize;
+  gtkwidget_class->unrealize = systray_socket_unrealize;
   gtkwidget_class->size_allocate = systray_socket_size_allocate;
   gtkwidget_class->draw = systray_socket_draw;
   gtkwidget_class->style_set = systray_socket_style_set;
@@ -102,6 +123,11 @@ systray_socket_init (SystraySocket *socket)
 {
   socket->hidden = FALSE;
   socket->name = NULL;
+  socket->surface = NULL;
+  socket->surface_damaged = TRUE;
+#ifdef HAVE_XDAMAGE
+  socket->damage = None;
+#endif
 }
 
 
@@ -118,6 +144,69 @@ systray_socket_finalize (GObject *object)
 
 
 
+#ifdef HAVE_XDAMAGE
+static GdkFilterReturn
+systray_socket_damage_filter (GdkXEvent *xevent,
+                              GdkEvent  *event,
+                              gpointer   user_data)
+{
+  SystraySocket      *socket = XFCE_SYSTRAY_SOCKET (user_data);
+  XDamageNotifyEvent *xev = xevent;
+  GtkWidget          *widget = GTK_WIDGET (socket);
+  GtkAllocation       allocation;
+
+  if (xev->type != damage_event_base + XDamageNotify
+      || xev->damage != socket->damage)
+    return GDK_FILTER_CONTINUE;
+
+  /* copy the icon again on the next draw of the box and only
+   * redraw the area of this icon */
+  socket->surface_damaged = TRUE;
+
+  if (gtk_widget_get_mapped (widget))
+    {
+      gtk_widget_get_allocation (widget, &allocation);
+      gdk_window_invalidate_rect (gdk_window_get_parent (gtk_widget_get_window (widget)),
+                                  &allocation, FALSE);
+    }
+
+  return GDK_FILTER_REMOVE;
+}
+
+
+
+static void
+systray_socket_damage_create (SystraySocket *socket)
+{
+  GdkWindow  *window = gtk_widget_get_window (GTK_WIDGET (socket));
+  GdkDisplay *display = gdk_window_get_display (window);
+  gint        error_base;
+
+  if (damage_event_base == -1
+      && !XDamageQueryExtension (GDK_DISPLAY_XDISPLAY (display),
+                                 &damage_event_base, &error_base))
+    damage_event_base = -2;
+
+  if (damage_event_base < 0)
+    return;
+
+  /* report once until the damage is subtracted when copying the icon */
+  gdk_x11_display_error_trap_push (display);
+  socket->damage = XDamageCreate (GDK_DISPLAY_XDISPLAY (display),
+                                  GDK_WINDOW_XID (window),
+                                  XDamageReportNonEmpty);
+  if (gdk_x11_display_error_trap_pop (display) != 0)
+    {
+      socket->damage = None;
+      return;
+    }
+
+  gdk_window_add_filter (window, systray_socket_damage_filter, socket);
+}
+#endif
+
+
+
 static void
 systray_socket_realize (GtkWidget *widget)
 {
@@ -155,6 +244,11 @@ systray_socket_realize (GtkWidget *widget)
 
   gtk_widget_set_double_buffered (widget, socket->parent_relative_bg);
 
+#ifdef HAVE_XDAMAGE
+  if (socket->is_composited)
+    systray_socket_damage_create (socket);
+#endif
+
   panel_debug_filtered (PANEL_DEBUG_SYSTRAY,
       "socket %s[%p] (composited=%s, relative-bg=%s",
       systray_socket_get_name (socket), socket,
@@ -164,6 +258,37 @@ systray_socket_realize (GtkWidget *widget)
 
 
 
+static void
+systray_socket_unrealize (GtkWidget *widget)
+{
+  SystraySocket *socket = XFCE_SYSTRAY_SOCKET (widget);
+#ifdef HAVE_XDAMAGE
+  GdkDisplay    *display;
+
+  if (socket->damage != None)
+    {
+      gdk_window_remove_filter (gtk_widget_get_window (widget),
+                                systray_socket_damage_filter, socket);
+
+      display = gtk_widget_get_display (widget);
+      gdk_x11_display_error_trap_push (display);
+      XDamageDestroy (GDK_DISPLAY_XDISPLAY (display), socket->damage);
+      gdk_x11_display_error_trap_pop_ignored (display);
+      socket->damage = None;
+    }
+#endif
+
+  if (socket->surface != NULL)
+    {
+      cairo_surface_destroy (socket->surface);
+      socket->surface = NULL;
+    }
+
+  GTK_WIDGET_CLASS (systray_socket_parent_class)->unrealize (widget);
+}
+
+
+
 static void
 systray_socket_size_allocate (GtkWidget     *widget,
                               GtkAllocation *allocation)
@@ -388,6 +513,72 @@ systray_socket_get_name_prop (SystraySocket *socket,
 
 
 
+/* returns a copy of the icon that is only updated when the icon was
+ * damaged, or NULL when damage is not tracked and the window should
+ * be painted directly */
+cairo_surface_t *
+systray_socket_get_surface (SystraySocket *socket)
+{
+#ifdef HAVE_XDAMAGE
+  GtkWidget     *widget = GTK_WIDGET (socket);
+  GdkWindow     *window;
+  GdkDisplay    *display;
+  GtkAllocation  allocation;
+  cairo_t       *cr;
+
+  panel_return_val_if_fail (XFCE_IS_SYSTRAY_SOCKET (socket), NULL);
+  panel_return_val_if_fail (socket->is_composited, NULL);
+
+  window = gtk_widget_get_window (widget);
+  if (socket->damage == None || window == NULL)
+    return NULL;
+
+  gtk_widget_get_allocation (widget, &allocation);
+  if (socket->surface != NULL
+      && (socket->surface_width != allocation.width
+          || socket->surface_height != allocation.height))
+    {
+      cairo_surface_destroy (socket->surface);
+      socket->surface = NULL;
+    }
+
+  if (socket->surface == NULL)
+    {
+      socket->surface = gdk_window_create_similar_surface (window,
+                                                           CAIRO_CONTENT_COLOR_ALPHA,
+                                                           allocation.width,
+                                                           allocation.height);
+      socket->surface_width = allocation.width;
+      socket->surface_height = allocation.height;
+      socket->surface_damaged = TRUE;
+    }
+
+  if (socket->surface_damaged)
+    {
+      /* subtract first, so drawing during the copy is reported again */
+      display = gtk_widget_get_display (widget);
+      gdk_x11_display_error_trap_push (display);
+      XDamageSubtract (GDK_DISPLAY_XDISPLAY (display), socket->damage, None, None);
+      gdk_x11_display_error_trap_pop_ignored (display);
+      socket->surface_damaged = FALSE;
+
+      cr = cairo_create (socket->surface);
+      gdk_cairo_set_source_window (cr, window, 0, 0);
+      cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+      cairo_paint (cr);
+      cairo_destroy (cr);
+    }
+
+  return socket->surface;
+#else
+  panel_return_val_if_fail (XFCE_IS_SYSTRAY_SOCKET (socket), NULL);
+
+  return NULL;
+#endif
+}
+
+
+
 const gchar *
 systray_socket_get_name (SystraySocket *socket)
 {
@@ -46,6 +46,8 @@ void             systray_socket_force_redraw  (SystraySocket   *socket);
 
 gboolean         systray_socket_is_composited (SystraySocket   *socket);
 
+cairo_surface_t *systray_socket_get_surface   (SystraySocket   *socket);
+
 const gchar     *systray_socket_get_name      (SystraySocket   *socket);
 
 Window          *systray_socket_get_window    (SystraySocket   *socket);
@@ -32,6 +32,8 @@
 #include "systray-box.h"
 #include "systray-socket.h"
 #include "systray-manager.h"
+#include "systray-sn-host.h"
+#include "systray-sn-item.h"
 #include "systray-dialog_ui.h"
 
 #define ICON_SIZE     (22)
@@ -76,6 +78,12 @@ static void     systray_plugin_icon_removed                 (SystrayManager
                                                              SystrayPlugin         *plugin);
 static void     systray_plugin_lost_selection               (SystrayManager        *manager,
                                                              SystrayPlugin         *plugin);
+static void     systray_plugin_sn_item_added                (SystraySnHost         *host,
+                                                             GtkWidget             *item,
+                                                             SystrayPlugin         *plugin);
+static void     systray_plugin_sn_item_removed              (SystraySnHost         *host,
+                                                             GtkWidget             *item,
+                                                             SystrayPlugin         *plugin);
 static void     systray_plugin_dialog_add_application_names (gpointer               data,
                                                              gpointer               user_data);
 static void     systray_plugin_dialog_hidden_toggled        (GtkCellRendererToggle *renderer,
@@ -106,6 +114,9 @@ struct _SystrayPlugin
 
   guint           idle_startup;
 
+  /* status notifier items on the session bus */
+  SystraySnHost  *sn_host;
+
   /* widgets */
   GtkWidget      *frame;
   GtkWidget      *hvbox;
@@ -114,6 +125,7 @@ struct _SystrayPlugin
 
   /* settings */
   guint           show_frame : 1;
+  guint           sn_watcher : 1;
   GSList         *names_ordered;
   GHashTable     *names_hidden;
 
@@ -127,7 +139,8 @@ enum
   PROP_SQUARE_ICONS,
   PROP_SHOW_FRAME,
   PROP_NAMES_ORDERED,
-  PROP_NAMES_HIDDEN
+  PROP_NAMES_HIDDEN,
+  PROP_SN_WATCHER
 };
 
 enum
@@ -144,7 +157,9 @@ enum
 XFCE_PANEL_DEFINE_PLUGIN (SystrayPlugin, systray_plugin,
     systray_box_register_type,
     systray_manager_register_type,
-    systray_socket_register_type)
+    systray_socket_register_type,
+    systray_sn_host_register_type,
+    systray_sn_item_register_type)
 
 
 
@@ -216,6 +231,13 @@ systray_plugin_class_init (SystrayPluginClass *klass)
                                                        NULL, NULL,
                                                        G_TYPE_PTR_ARRAY,
                                                        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+                                   PROP_SN_WATCHER,
+                                   g_param_spec_boolean ("sn-watcher",
+                                                         NULL, NULL,
+                                                         FALSE,
+                                                         G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 
@@ -226,7 +248,9 @@ systray_plugin_init (SystrayPlugin *plugin)
   //GtkRcStyle *style;
 
   plugin->manager = NULL;
+  plugin->sn_host = NULL;
   plugin->show_frame = TRUE;
+  plugin->sn_watcher = FALSE;
   plugin->idle_startup = 0;
   plugin->names_ordered = NULL;
   plugin->names_hidden = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
@@ -313,6 +337,10 @@ systray_plugin_get_property (GObject    *object,
       g_ptr_array_unref (array);
       break;
 
+    case PROP_SN_WATCHER:
+      g_value_set_boolean (value, plugin->sn_watcher);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -421,6 +449,14 @@ systray_plugin_set_property (GObject      *object,
       systray_plugin_names_update (plugin);
       break;
 
+    case PROP_SN_WATCHER:
+      plugin->sn_watcher = g_value_get_boolean (value);
+
+      /* the host is created after the properties are bound */
+      if (plugin->sn_host != NULL)
+        systray_sn_host_set_serve_watcher (plugin->sn_host, plugin->sn_watcher);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -513,6 +549,7 @@ systray_plugin_construct (XfcePanelPlugin *panel_plugin)
     { "show-frame", G_TYPE_BOOLEAN },
     { "names-ordered", G_TYPE_PTR_ARRAY },
     { "names-hidden", G_TYPE_PTR_ARRAY },
+    { "sn-watcher", G_TYPE_BOOLEAN },
     { NULL }
   };
 
@@ -530,6 +567,18 @@ systray_plugin_construct (XfcePanelPlugin *panel_plugin)
   /* restart internally if compositing changed */
   g_signal_connect (G_OBJECT (plugin), "composited-changed",
      G_CALLBACK (systray_plugin_composited_changed), NULL);
+
+  /* items of the status notifier protocol are drawn in the box
+   * directly, without a socket and plug window for each icon; we
+   * only serve or follow the watcher if enabled, since the item menus
+   * are not shown and applications fall back to xembed without a
+   * watcher */
+  plugin->sn_host = systray_sn_host_new ();
+  systray_sn_host_set_serve_watcher (plugin->sn_host, plugin->sn_watcher);
+  g_signal_connect (G_OBJECT (plugin->sn_host), "item-added",
+      G_CALLBACK (systray_plugin_sn_item_added), plugin);
+  g_signal_connect (G_OBJECT (plugin->sn_host), "item-removed",
+      G_CALLBACK (systray_plugin_sn_item_removed), plugin);
 }
 
 
@@ -555,6 +604,12 @@ systray_plugin_free_data (XfcePanelPlugin *panel_plugin)
       systray_manager_unregister (plugin->manager);
       g_object_unref (G_OBJECT (plugin->manager));
     }
+
+  if (G_LIKELY (plugin->sn_host != NULL))
+    {
+      g_signal_handlers_disconnect_by_data (G_OBJECT (plugin->sn_host), plugin);
+      g_object_unref (G_OBJECT (plugin->sn_host));
+    }
 }
 
 
@@ -702,19 +757,33 @@ static void
 systray_plugin_box_draw_icon (GtkWidget *child,
                               gpointer   user_data)
 {
-  cairo_t       *cr = user_data;
-  GtkAllocation  alloc;
-
-  if (systray_socket_is_composited (XFCE_SYSTRAY_SOCKET (child)))
+  cairo_t         *cr = user_data;
+  GtkAllocation    alloc;
+  GdkRectangle     clip;
+  cairo_surface_t *surface;
+
+  /* status notifier items draw themselves */
+  if (XFCE_IS_SYSTRAY_SOCKET (child)
+      && systray_socket_is_composited (XFCE_SYSTRAY_SOCKET (child)))
     {
       gtk_widget_get_allocation (child, &alloc);
 
       /* skip hidden (see offscreen in box widget) icons */
       if (alloc.x > -1 && alloc.y > -1)
         {
+          /* skip icons outside the redrawn area, a damaged icon
+           * only invalidates its own allocation */
+          if (gdk_cairo_get_clip_rectangle (cr, &clip)
+              && !gdk_rectangle_intersect (&clip, &alloc, NULL))
+            return;
+
           // FIXME
-          gdk_cairo_set_source_window (cr, gtk_widget_get_window (child),
-                                       alloc.x, alloc.y);
+          surface = systray_socket_get_surface (XFCE_SYSTRAY_SOCKET (child));
+          if (G_LIKELY (surface != NULL))
+            cairo_set_source_surface (cr, surface, alloc.x, alloc.y);
+          else
+            gdk_cairo_set_source_window (cr, gtk_widget_get_window (child),
+                                         alloc.x, alloc.y);
           cairo_paint (cr);
         }
     }
@@ -823,12 +892,24 @@ systray_plugin_names_update_icon (GtkWidget *icon,
                                   gpointer   data)
 {
   SystrayPlugin *plugin = XFCE_SYSTRAY_PLUGIN (data);
-  SystraySocket *socket = XFCE_SYSTRAY_SOCKET (icon);
+  SystraySnItem *item;
+  SystraySocket *socket;
   const gchar   *name;
 
   panel_return_if_fail (XFCE_IS_SYSTRAY_PLUGIN (plugin));
+
+  if (XFCE_IS_SYSTRAY_SN_ITEM (icon))
+    {
+      item = XFCE_SYSTRAY_SN_ITEM (icon);
+      name = systray_sn_item_get_name (item);
+      systray_sn_item_set_hidden (item,
+          systray_plugin_names_get_hidden (plugin, name));
+      return;
+    }
+
   panel_return_if_fail (XFCE_IS_SYSTRAY_SOCKET (icon));
 
+  socket = XFCE_SYSTRAY_SOCKET (icon);
   name = systray_socket_get_name (socket);
   systray_socket_set_hidden (socket,
       systray_plugin_names_get_hidden (plugin, name));
@@ -967,6 +1048,44 @@ systray_plugin_lost_selection (SystrayManager *manager,
 
 
 
+static void
+systray_plugin_sn_item_added (SystraySnHost *host,
+                              GtkWidget     *item,
+                              SystrayPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SN_HOST (host));
+  panel_return_if_fail (XFCE_IS_SYSTRAY_PLUGIN (plugin));
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SN_ITEM (item));
+  panel_return_if_fail (plugin->sn_host == host);
+
+  /* the item shows itself unless its status is passive */
+  systray_plugin_names_update_icon (item, plugin);
+  gtk_container_add (GTK_CONTAINER (plugin->box), item);
+
+  panel_debug_filtered (PANEL_DEBUG_SYSTRAY, "added %s[%p] item",
+      systray_sn_item_get_name (XFCE_SYSTRAY_SN_ITEM (item)), item);
+}
+
+
+
+static void
+systray_plugin_sn_item_removed (SystraySnHost *host,
+                                GtkWidget     *item,
+                                SystrayPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SN_HOST (host));
+  panel_return_if_fail (XFCE_IS_SYSTRAY_PLUGIN (plugin));
+  panel_return_if_fail (plugin->sn_host == host);
+  panel_return_if_fail (GTK_IS_WIDGET (item));
+
+  gtk_container_remove (GTK_CONTAINER (plugin->box), item);
+
+  panel_debug_filtered (PANEL_DEBUG_SYSTRAY, "removed %s[%p] item",
+      systray_sn_item_get_name (XFCE_SYSTRAY_SN_ITEM (item)), item);
+}
+
+
+
 static gchar *
 systray_plugin_dialog_camel_case (const gchar *text)
 {
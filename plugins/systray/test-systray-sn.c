@@ -0,0 +1,501 @@
+/*
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <gtk/gtk.h>
+#include <gio/gio.h>
+
+#include "systray-sn-host.h"
+#include "systray-sn-item.h"
+
+
+
+#define TEST_WATCHER_NAME "org.kde.StatusNotifierWatcher"
+#define TEST_WATCHER_PATH "/StatusNotifierWatcher"
+#define TEST_ITEM_PATH    "/StatusNotifierItem"
+#define TEST_TIMEOUT      (10)
+
+
+
+/* type module to register the dynamic types of the plugin */
+typedef GTypeModule      TestTypeModule;
+typedef GTypeModuleClass TestTypeModuleClass;
+
+G_DEFINE_TYPE (TestTypeModule, test_type_module, G_TYPE_TYPE_MODULE)
+
+
+
+/* status notifier item on its own connection to the test bus */
+typedef struct
+{
+  GDBusConnection *connection;
+  guint            object_id;
+  gchar           *id;
+}
+TestItem;
+
+/* notification area that shows the items of the host */
+typedef struct
+{
+  SystraySnHost *host;
+  GtkWidget     *box;
+  GtkWidget     *item;
+
+  /* set when an item is added or removed */
+  gboolean       changed;
+}
+TestTray;
+
+
+
+static GTestDBus *test_bus = NULL;
+
+static const gchar test_item_xml[] =
+  "<node>"
+  "  <interface name='org.kde.StatusNotifierItem'>"
+  "    <property name='Id' type='s' access='read'/>"
+  "    <property name='Status' type='s' access='read'/>"
+  "    <property name='IconPixmap' type='a(iiay)' access='read'/>"
+  "    <signal name='NewTitle'/>"
+  "  </interface>"
+  "</node>";
+
+
+
+static gboolean
+test_type_module_load (GTypeModule *type_module)
+{
+  return TRUE;
+}
+
+
+
+static void
+test_type_module_unload (GTypeModule *type_module)
+{
+}
+
+
+
+static void
+test_type_module_class_init (TestTypeModuleClass *klass)
+{
+  klass->load = test_type_module_load;
+  klass->unload = test_type_module_unload;
+}
+
+
+
+static void
+test_type_module_init (TestTypeModule *type_module)
+{
+}
+
+
+
+static gboolean
+test_timeout (gpointer user_data)
+{
+  g_error ("timeout waiting for %s", (const gchar *) user_data);
+
+  return FALSE;
+}
+
+
+
+/* run the main loop until the condition is set */
+static void
+test_wait_for (gboolean    *condition,
+               const gchar *what)
+{
+  guint timeout_id;
+
+  timeout_id = g_timeout_add_seconds (TEST_TIMEOUT, test_timeout, (gpointer) what);
+  while (!*condition)
+    g_main_context_iteration (NULL, TRUE);
+  g_source_remove (timeout_id);
+}
+
+
+
+static void
+test_pixmap_add (GVariantBuilder *builder,
+                 gint             width,
+                 gint             height,
+                 gsize            n_bytes)
+{
+  guchar *data;
+  gsize   i;
+
+  /* every pixel is opaque with red 0x10, green 0x20 and blue 0x30 */
+  data = g_malloc (n_bytes);
+  for (i = 0; i < n_bytes; i++)
+    data[i] = (i % 4 == 0) ? 0xff : (i % 4) * 0x10;
+
+  g_variant_builder_add (builder, "(ii@ay)", width, height,
+                         g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE,
+                                                    data, n_bytes, sizeof (guchar)));
+  g_free (data);
+}
+
+
+
+static GVariant *
+test_pixmap_new (gint  width,
+                 gint  height,
+                 gsize n_bytes)
+{
+  GVariantBuilder builder;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(iiay)"));
+  test_pixmap_add (&builder, width, height, n_bytes);
+
+  return g_variant_builder_end (&builder);
+}
+
+
+
+static GVariant *
+test_item_get_property (GDBusConnection  *connection,
+                        const gchar      *sender,
+                        const gchar      *object_path,
+                        const gchar      *interface_name,
+                        const gchar      *property_name,
+                        GError          **error,
+                        gpointer          user_data)
+{
+  TestItem *item = user_data;
+
+  if (g_strcmp0 (property_name, "Id") == 0)
+    return g_variant_new_string (item->id);
+  else if (g_strcmp0 (property_name, "Status") == 0)
+    return g_variant_new_string ("Active");
+  else if (g_strcmp0 (property_name, "IconPixmap") == 0)
+    return test_pixmap_new (2, 2, 2 * 2 * 4);
+
+  g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY,
+               "Unknown property %s", property_name);
+
+  return NULL;
+}
+
+
+
+static const GDBusInterfaceVTable test_item_vtable =
+{
+  NULL,
+  test_item_get_property,
+  NULL
+};
+
+
+
+static TestItem *
+test_item_new (const gchar *id)
+{
+  TestItem      *item;
+  GDBusNodeInfo *node_info;
+  GError        *error = NULL;
+
+  item = g_slice_new0 (TestItem);
+  item->id = g_strdup (id);
+  item->connection =
+      g_dbus_connection_new_for_address_sync (g_test_dbus_get_bus_address (test_bus),
+                                              G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT
+                                              | G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                              NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  node_info = g_dbus_node_info_new_for_xml (test_item_xml, &error);
+  g_assert_no_error (error);
+
+  item->object_id = g_dbus_connection_register_object (item->connection, TEST_ITEM_PATH,
+                                                       node_info->interfaces[0],
+                                                       &test_item_vtable,
+                                                       item, NULL, &error);
+  g_assert_no_error (error);
+  g_dbus_node_info_unref (node_info);
+
+  return item;
+}
+
+
+
+static void
+test_item_free (TestItem *item)
+{
+  if (!g_dbus_connection_is_closed (item->connection))
+    g_dbus_connection_unregister_object (item->connection, item->object_id);
+  g_object_unref (G_OBJECT (item->connection));
+  g_free (item->id);
+  g_slice_free (TestItem, item);
+}
+
+
+
+static void
+test_item_registered (GObject      *source_object,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+  GVariant *reply;
+  GError   *error = NULL;
+
+  reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object), result, &error);
+  g_assert_no_error (error);
+  g_variant_unref (reply);
+
+  *((gboolean *) user_data) = TRUE;
+}
+
+
+
+static void
+test_item_register (TestItem *item)
+{
+  gboolean registered = FALSE;
+
+  /* the host answers from this main loop, so no sync call;
+   * libappindicator registers the object path like this */
+  g_dbus_connection_call (item->connection,
+                          TEST_WATCHER_NAME,
+                          TEST_WATCHER_PATH,
+                          TEST_WATCHER_NAME,
+                          "RegisterStatusNotifierItem",
+                          g_variant_new ("(s)", TEST_ITEM_PATH),
+                          NULL,
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1, NULL,
+                          test_item_registered,
+                          &registered);
+
+  test_wait_for (&registered, "the item registration");
+}
+
+
+
+static void
+test_tray_item_added (SystraySnHost *host,
+                      GtkWidget     *item,
+                      TestTray      *tray)
+{
+  g_assert_null (tray->item);
+
+  gtk_container_add (GTK_CONTAINER (tray->box), item);
+  tray->item = item;
+  tray->changed = TRUE;
+}
+
+
+
+static void
+test_tray_item_removed (SystraySnHost *host,
+                        GtkWidget     *item,
+                        TestTray      *tray)
+{
+  g_assert_true (tray->item == item);
+
+  gtk_container_remove (GTK_CONTAINER (tray->box), item);
+  tray->item = NULL;
+  tray->changed = TRUE;
+}
+
+
+
+static void
+test_tray_item_name_changed (TestTray    *tray,
+                             const gchar *name)
+{
+  guint timeout_id;
+
+  timeout_id = g_timeout_add_seconds (TEST_TIMEOUT, test_timeout, (gpointer) name);
+  while (g_strcmp0 (systray_sn_item_get_name (XFCE_SYSTRAY_SN_ITEM (tray->item)), name) != 0)
+    g_main_context_iteration (NULL, TRUE);
+  g_source_remove (timeout_id);
+}
+
+
+
+static void
+test_watcher_appeared (GDBusConnection *connection,
+                       const gchar     *name,
+                       const gchar     *name_owner,
+                       gpointer         user_data)
+{
+  *((gboolean *) user_data) = TRUE;
+}
+
+
+
+static void
+test_tray_init (TestTray *tray)
+{
+  GDBusConnection *connection;
+  gboolean         appeared = FALSE;
+  guint            watch_id;
+
+  tray->item = NULL;
+  tray->changed = FALSE;
+  tray->box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+  g_object_ref_sink (G_OBJECT (tray->box));
+
+  tray->host = systray_sn_host_new ();
+  systray_sn_host_set_serve_watcher (tray->host, TRUE);
+  g_signal_connect (G_OBJECT (tray->host), "item-added",
+      G_CALLBACK (test_tray_item_added), tray);
+  g_signal_connect (G_OBJECT (tray->host), "item-removed",
+      G_CALLBACK (test_tray_item_removed), tray);
+
+  /* the host is the only watcher on the test bus */
+  connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL);
+  g_assert_nonnull (connection);
+  watch_id = g_bus_watch_name_on_connection (connection, TEST_WATCHER_NAME,
+                                             G_BUS_NAME_WATCHER_FLAGS_NONE,
+                                             test_watcher_appeared, NULL,
+                                             &appeared, NULL);
+  test_wait_for (&appeared, "the watcher");
+  g_bus_unwatch_name (watch_id);
+  g_object_unref (G_OBJECT (connection));
+}
+
+
+
+static void
+test_tray_destroy (TestTray *tray)
+{
+  g_object_unref (G_OBJECT (tray->host));
+  gtk_widget_destroy (tray->box);
+  g_object_unref (G_OBJECT (tray->box));
+}
+
+
+
+static void
+test_item_register_reload_vanish (void)
+{
+  TestTray  tray;
+  TestItem *item;
+
+  test_tray_init (&tray);
+
+  /* register, the host shows the item after the first properties */
+  item = test_item_new ("test-item");
+  test_item_register (item);
+  test_wait_for (&tray.changed, "the item");
+  g_assert_nonnull (tray.item);
+  g_assert_cmpstr (systray_sn_item_get_name (XFCE_SYSTRAY_SN_ITEM (tray.item)), ==, "test-item");
+
+  /* New* signals reload the properties */
+  g_free (item->id);
+  item->id = g_strdup ("test-item-renamed");
+  g_dbus_connection_emit_signal (item->connection, NULL, TEST_ITEM_PATH,
+                                 "org.kde.StatusNotifierItem", "NewTitle",
+                                 NULL, NULL);
+  test_tray_item_name_changed (&tray, "test-item-renamed");
+
+  /* the item is removed when its owner leaves the bus */
+  tray.changed = FALSE;
+  g_dbus_connection_close_sync (item->connection, NULL, NULL);
+  test_wait_for (&tray.changed, "the item removal");
+  g_assert_null (tray.item);
+
+  test_item_free (item);
+  test_tray_destroy (&tray);
+}
+
+
+
+static void
+test_pixmap_conversion (void)
+{
+  GVariantBuilder  builder;
+  GVariant        *pixmap;
+  GdkPixbuf       *pixbuf;
+  const guchar    *pixels;
+
+  /* the largest valid entry wins, entries above the bound, with
+   * invalid sizes or with too little data are skipped */
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(iiay)"));
+  test_pixmap_add (&builder, 1, 1, 4);
+  test_pixmap_add (&builder, 3, 2, 3 * 2 * 4);
+  test_pixmap_add (&builder, 2048, 1, 2048 * 4);
+  test_pixmap_add (&builder, 16, -16, 16 * 16 * 4);
+  test_pixmap_add (&builder, 8, 8, 4);
+  pixmap = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+  pixbuf = systray_sn_item_pixbuf_from_pixmap (pixmap);
+  g_assert_nonnull (pixbuf);
+  g_assert_cmpint (gdk_pixbuf_get_width (pixbuf), ==, 3);
+  g_assert_cmpint (gdk_pixbuf_get_height (pixbuf), ==, 2);
+  g_assert_true (gdk_pixbuf_get_has_alpha (pixbuf));
+
+  /* argb in network byte order becomes rgba */
+  pixels = gdk_pixbuf_read_pixels (pixbuf);
+  g_assert_cmpuint (pixels[0], ==, 0x10);
+  g_assert_cmpuint (pixels[1], ==, 0x20);
+  g_assert_cmpuint (pixels[2], ==, 0x30);
+  g_assert_cmpuint (pixels[3], ==, 0xff);
+
+  g_object_unref (G_OBJECT (pixbuf));
+  g_variant_unref (pixmap);
+
+  /* nothing usable */
+  pixmap = g_variant_ref_sink (test_pixmap_new (0, 0, 4));
+  g_assert_null (systray_sn_item_pixbuf_from_pixmap (pixmap));
+  g_variant_unref (pixmap);
+
+  pixmap = g_variant_ref_sink (test_pixmap_new (G_MAXINT, G_MAXINT, 4));
+  g_assert_null (systray_sn_item_pixbuf_from_pixmap (pixmap));
+  g_variant_unref (pixmap);
+}
+
+
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GTypeModule *type_module;
+  gint         retval;
+
+  g_test_init (&argc, &argv, NULL);
+
+  type_module = g_object_new (test_type_module_get_type (), NULL);
+  systray_sn_host_register_type (type_module);
+  systray_sn_item_register_type (type_module);
+
+  g_test_add_func ("/systray/sn/pixmap-conversion", test_pixmap_conversion);
+
+  /* the items are widgets */
+  if (gtk_init_check (&argc, &argv))
+    g_test_add_func ("/systray/sn/item-register-reload-vanish", test_item_register_reload_vanish);
+
+  /* private session bus for the host and the items */
+  test_bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (test_bus);
+
+  retval = g_test_run ();
+
+  g_test_dbus_down (test_bus);
+  g_object_unref (G_OBJECT (test_bus));
+
+  return retval;
+}
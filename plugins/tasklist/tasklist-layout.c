@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "tasklist-layout.h"
+
+
+
+static gint
+xfce_tasklist_layout_auto_group_compare (gconstpointer a,
+                                         gconstpointer b)
+{
+  const XfceTasklistAutoGroup *group_a = a;
+  const XfceTasklistAutoGroup *group_b = b;
+
+  /* largest groups first, the id keeps the order deterministic */
+  if (group_a->n_windows != group_b->n_windows)
+    return group_b->n_windows - group_a->n_windows;
+
+  return g_strcmp0 (group_a->id, group_b->id);
+}
+
+
+
+/* number of buttons that fit in the tasklist, both the auto grouping
+ * and the overflow menu use this; the overflow arrow only takes space
+ * when the buttons do not fit without it */
+gint
+xfce_tasklist_layout_capacity (gint length,
+                               gint min_button_length,
+                               gint rows,
+                               gint n_buttons)
+{
+  gint capacity;
+
+  min_button_length = MAX (min_button_length, 1);
+  rows = MAX (rows, 1);
+
+  capacity = MAX (length, 0) / min_button_length * rows;
+  if (n_buttons <= capacity)
+    return capacity;
+
+  return MAX (length - ARROW_BUTTON_SIZE, 0) / min_button_length * rows;
+}
+
+
+
+void
+xfce_tasklist_layout_auto_group_sort (GArray *groups)
+{
+  g_return_if_fail (groups != NULL);
+
+  g_array_sort (groups, xfce_tasklist_layout_auto_group_compare);
+}
+
+
+
+void
+xfce_tasklist_layout_auto_group_decide (GArray  *groups,
+                                        gint     n_buttons,
+                                        gint     capacity,
+                                        GSList **collapse,
+                                        GSList **expand)
+{
+  XfceTasklistAutoGroup *group;
+  guint                  i;
+  gint                   n_needed;
+
+  g_return_if_fail (groups != NULL);
+  g_return_if_fail (collapse != NULL && expand != NULL);
+
+  if (n_buttons > capacity)
+    {
+      /* collapse the largest groups until the buttons fit, a group
+       * with n visible windows saves n - 1 buttons */
+      n_needed = n_buttons - capacity;
+      for (i = 0; i < groups->len && n_needed > 0; i++)
+        {
+          group = &g_array_index (groups, XfceTasklistAutoGroup, i);
+          if (group->grouped || group->n_windows < 2)
+            continue;
+
+          *collapse = g_slist_prepend (*collapse, group->class_group);
+          n_needed -= group->n_windows - 1;
+        }
+    }
+  else
+    {
+      /* expand the smallest collapsed group, but only if its windows
+       * fit with some slack, so the next pass does not collapse it again */
+      for (i = groups->len; i > 0; i--)
+        {
+          group = &g_array_index (groups, XfceTasklistAutoGroup, i - 1);
+          if (!group->grouped)
+            continue;
+
+          if (n_buttons + group->n_windows - 1 + AUTO_GROUP_HYSTERESIS <= capacity)
+            *expand = g_slist_prepend (*expand, group->class_group);
+          break;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __TASKLIST_LAYOUT_H__
+#define __TASKLIST_LAYOUT_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define ARROW_BUTTON_SIZE     (20)
+#define AUTO_GROUP_HYSTERESIS (1)
+
+typedef struct _XfceTasklistAutoGroup XfceTasklistAutoGroup;
+struct _XfceTasklistAutoGroup
+{
+  /* the WnckClassGroup, opaque for the layout */
+  gpointer     class_group;
+  const gchar *id;
+
+  /* number of visible windows in the group */
+  gint         n_windows;
+
+  /* whether there is a group button for the class group */
+  guint        grouped : 1;
+};
+
+gint xfce_tasklist_layout_capacity          (gint     length,
+                                             gint     min_button_length,
+                                             gint     rows,
+                                             gint     n_buttons);
+
+void xfce_tasklist_layout_auto_group_sort   (GArray  *groups);
+
+void xfce_tasklist_layout_auto_group_decide (GArray  *groups,
+                                             gint     n_buttons,
+                                             gint     capacity,
+                                             GSList **collapse,
+                                             GSList **expand);
+
+G_END_DECLS
+
+#endif /* !__TASKLIST_LAYOUT_H__ */
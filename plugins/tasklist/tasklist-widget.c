@@ -37,10 +37,10 @@
 #ifdef GDK_WINDOWING_X11
 #include <X11/Xlib.h>
 #include <gdk/gdkx.h>
-#include <X11/extensions/shape.h>
 #endif
 
 #include "tasklist-widget.h"
+#include "tasklist-layout.h"
 
 
 
@@ -50,9 +50,11 @@
 #define DEFAULT_ICON_LUCENCY         (50)
 #define DEFAULT_ELLIPSIZE_MODE       (PANGO_ELLIPSIZE_END)
 #define DEFAULT_MENU_MAX_WIDTH_CHARS (24)
-#define ARROW_BUTTON_SIZE            (20)
 #define WIREFRAME_SIZE               (5) /* same as xfwm4 */
 #define DRAG_ACTIVATE_TIMEOUT        (500)
+#define NAME_CHANGED_INTERVAL        (250)
+#define OVERFLOW_POPUP_THRESHOLD     (25)
+#define OVERFLOW_POPUP_MAX_HEIGHT    (400)
 
 
 
@@ -95,6 +97,15 @@ enum
   PROP_LABEL_DECORATIONS
 };
 
+enum
+{
+  OVERFLOW_COLUMN_ICON,
+  OVERFLOW_COLUMN_TITLE,
+  OVERFLOW_COLUMN_KEY,
+  OVERFLOW_COLUMN_CHILD,
+  N_OVERFLOW_COLUMNS
+};
+
 struct _XfceTasklistClass
 {
   GtkContainerClass __parent__;
@@ -120,6 +131,16 @@ struct _XfceTasklist
   /* arrow button of the overflow menu */
   GtkWidget            *arrow_button;
 
+  /* popup with a filterable list, used instead of the overflow
+   * menu when a lot of windows are overflowed */
+  GtkWidget            *overflow_popup;
+  GtkWidget            *overflow_entry;
+  GtkWidget            *overflow_view;
+  GtkListStore         *overflow_store;
+  GtkTreeModel         *overflow_filter;
+  gchar                *overflow_filter_key;
+  struct _XfceTasklistChild *overflow_hover;
+
   /* classgroups of all the windows in the taskbar */
   GHashTable           *class_groups;
 
@@ -182,6 +203,11 @@ struct _XfceTasklist
   /* button grouping mode */
   XfceTasklistGrouping  grouping;
 
+  /* class groups to collapse or expand in auto grouping mode */
+  guint                 auto_group_id;
+  GSList               *auto_group_collapse;
+  GSList               *auto_group_expand;
+
   /* sorting order of the buttons */
   XfceTasklistSortOrder sort_order;
 
@@ -189,8 +215,15 @@ struct _XfceTasklist
   guint                 show_handle : 1;
 
 #ifdef GDK_WINDOWING_X11
-  /* wireframe window */
-  Window                wireframe_window;
+  /* wireframe window, reused for all the buttons */
+  GtkWidget            *wireframe_window;
+  guint                 wireframe_composited : 1;
+
+  /* geometry of the mapped wireframe and the one to apply in the
+   * idle, a zero width means the wireframe should be hidden */
+  GdkRectangle          wireframe_geometry;
+  GdkRectangle          wireframe_pending;
+  guint                 wireframe_update_id;
 #endif
 
   /* gtk style properties */
@@ -232,6 +265,10 @@ struct _XfceTasklistChild
   guint                   motion_timeout_id;
   guint                   motion_timestamp;
 
+  /* rate limiting of window title updates */
+  guint                   name_changed_timeout_id;
+  gint64                  name_changed_time;
+
   /* unique id for sorting by insert time,
    * simply increased for each new button */
   guint                   unique_id;
@@ -317,6 +354,15 @@ static void               xfce_tasklist_skipped_windows_state_changed    (WnckWi
 static void               xfce_tasklist_sort                             (XfceTasklist         *tasklist);
 static gboolean           xfce_tasklist_update_icon_geometries           (gpointer              data);
 static void               xfce_tasklist_update_icon_geometries_destroyed (gpointer              data);
+static gboolean           xfce_tasklist_auto_group_update                (XfceTasklist         *tasklist,
+                                                                          gint                  n_buttons,
+                                                                          gint                  capacity);
+
+/* overflow popup */
+static void               xfce_tasklist_overflow_popup_show              (XfceTasklist         *tasklist);
+static void               xfce_tasklist_overflow_popup_hide              (XfceTasklist         *tasklist);
+static void               xfce_tasklist_overflow_popup_remove_child      (XfceTasklist         *tasklist,
+                                                                          gpointer              child);
 
 /* wireframe */
 #ifdef GDK_WINDOWING_X11
@@ -403,7 +449,7 @@ xfce_tasklist_class_init (XfceTasklistClass *klass)
                                    g_param_spec_uint ("grouping",
                                                       NULL, NULL,
                                                       XFCE_TASKLIST_GROUPING_MIN,
-                                                      XFCE_TASKLIST_GROUPING_MAX + 1 /* TODO drop this later */,
+                                                      XFCE_TASKLIST_GROUPING_MAX,
                                                       XFCE_TASKLIST_GROUPING_DEFAULT,
                                                       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
@@ -589,10 +635,14 @@ xfce_tasklist_init (XfceTasklist *tasklist)
   tasklist->label_decorations = TRUE;
   xfce_tasklist_geometry_set_invalid (tasklist);
 #ifdef GDK_WINDOWING_X11
-  tasklist->wireframe_window = 0;
+  tasklist->wireframe_window = NULL;
+  tasklist->wireframe_update_id = 0;
 #endif
   tasklist->update_icon_geometries_id = 0;
   tasklist->update_monitor_geometry_id = 0;
+  tasklist->auto_group_id = 0;
+  tasklist->auto_group_collapse = NULL;
+  tasklist->auto_group_expand = NULL;
   tasklist->max_button_length = DEFAULT_MAX_BUTTON_LENGTH;
   tasklist->min_button_length = DEFAULT_MIN_BUTTON_LENGTH;
   tasklist->max_button_size = DEFAULT_BUTTON_SIZE;
@@ -611,6 +661,13 @@ xfce_tasklist_init (XfceTasklist *tasklist)
 
   /* widgets for the overflow menu */
   /* TODO support drag-motion and drag-leave */
+  tasklist->overflow_popup = NULL;
+  tasklist->overflow_entry = NULL;
+  tasklist->overflow_view = NULL;
+  tasklist->overflow_store = NULL;
+  tasklist->overflow_filter = NULL;
+  tasklist->overflow_filter_key = NULL;
+  tasklist->overflow_hover = NULL;
   tasklist->arrow_button = xfce_arrow_button_new (GTK_ARROW_DOWN);
   gtk_widget_set_parent (tasklist->arrow_button, GTK_WIDGET (tasklist));
   gtk_widget_set_name (tasklist->arrow_button, "panel-tasklist-arrow");
@@ -801,10 +858,21 @@ xfce_tasklist_finalize (GObject *object)
     g_source_remove (tasklist->update_icon_geometries_id);
   if (tasklist->update_monitor_geometry_id != 0)
     g_source_remove (tasklist->update_monitor_geometry_id);
+  if (tasklist->auto_group_id != 0)
+    g_source_remove (tasklist->auto_group_id);
 
   /* free the class group hash table */
   g_hash_table_destroy (tasklist->class_groups);
 
+  /* destroy the overflow popup */
+  if (tasklist->overflow_popup != NULL)
+    {
+      gtk_widget_destroy (tasklist->overflow_popup);
+      g_object_unref (G_OBJECT (tasklist->overflow_filter));
+      g_object_unref (G_OBJECT (tasklist->overflow_store));
+    }
+  g_free (tasklist->overflow_filter_key);
+
 #ifdef GDK_WINDOWING_X11
   /* destroy the wireframe window */
   xfce_tasklist_wireframe_destroy (tasklist);
@@ -881,6 +949,8 @@ xfce_tasklist_get_preferred_length (GtkWidget *widget,
 
       if (gtk_widget_get_visible (child->button))
         {
+          /* gtk requires a size request before the allocation, even
+           * though the length only depends on the number of windows */
           gtk_widget_get_preferred_size (child->button, NULL, &child_req);
 
           /* child_height = MAX (child_height, child_req.height); */
@@ -967,6 +1037,7 @@ xfce_tasklist_size_layout (XfceTasklist  *tasklist,
   gint               max_button_length;
   gint               n_buttons;
   gint               n_buttons_target;
+  gboolean           auto_group_pending = FALSE;
 
   /* if we're in deskbar mode, there are no columns */
   if (xfce_tasklist_deskbar (tasklist) && tasklist->show_labels)
@@ -992,6 +1063,17 @@ xfce_tasklist_size_layout (XfceTasklist  *tasklist,
 
   *arrow_position = -1; /* not visible */
 
+  /* the auto grouping and the overflow menu use the same capacity,
+   * otherwise they disagree near the threshold */
+  n_buttons_target = xfce_tasklist_layout_capacity (alloc->width, min_button_length,
+                                                    rows, tasklist->n_windows);
+
+  /* collapse or expand class groups before we decide about the
+   * overflow menu, this is applied in an idle callback */
+  if (tasklist->grouping == XFCE_TASKLIST_GROUPING_AUTO)
+    auto_group_pending = xfce_tasklist_auto_group_update (tasklist, tasklist->n_windows,
+                                                          n_buttons_target);
+
   /* unset overflow items, we decide about that again
    * later */
   for (li = tasklist->windows; li != NULL; li = li->next)
@@ -1015,12 +1097,11 @@ xfce_tasklist_size_layout (XfceTasklist  *tasklist,
       for (li = tasklist->windows; li != NULL; li = li->next)
         {
           child = li->data;
-          if (gtk_widget_get_visible (child->button))
-            {
-              windows_scored = g_slist_insert_sorted (windows_scored, child,
-                                                      xfce_tasklist_size_sort_window);
-            }
+          if (child->type == CHILD_TYPE_WINDOW
+              && gtk_widget_get_visible (child->button))
+            windows_scored = g_slist_prepend (windows_scored, child);
         }
+      windows_scored = g_slist_sort (windows_scored, xfce_tasklist_size_sort_window);
 
       if (xfce_tasklist_deskbar (tasklist) || !tasklist->show_labels)
         max_button_length = min_button_length;
@@ -1030,24 +1111,11 @@ xfce_tasklist_size_layout (XfceTasklist  *tasklist,
         max_button_length = DEFAULT_MAX_BUTTON_LENGTH;
 
       n_buttons = tasklist->n_windows;
-      /* Matches the existing behavior (with a bug fix) */
-      /* n_buttons_target = MIN ((alloc->width - ARROW_BUTTON_SIZE) / min_button_length * rows,          *
-       *                         (((alloc->width - ARROW_BUTTON_SIZE) / max_button_length) + 1) * rows); */
-
-      /* Perhaps a better behavior (tries to display more buttons on the panel, */
-      /* yet still within the specified limits) */
-      n_buttons_target = (alloc->width - ARROW_BUTTON_SIZE) / min_button_length * rows;
-
-#if 0
-      if (tasklist->grouping == XFCE_TASKLIST_GROUPING_AUTO)
-        {
-          /* try creating group buttons */
-        }
-#endif
 
       /* we now push the windows with the lowest score in the
-       * overflow menu */
-      if (n_buttons > n_buttons_target)
+       * overflow menu, unless collapsing groups is about to make
+       * room; the count is still from before the grouping */
+      if (n_buttons > n_buttons_target && !auto_group_pending)
         {
           panel_debug (PANEL_DEBUG_TASKLIST,
                        "Putting %d windows in overflow menu",
@@ -1418,9 +1486,16 @@ xfce_tasklist_remove (GtkContainer *container,
 
           gtk_widget_unparent (child->button);
 
+          /* drop the row from the overflow popup */
+          if (tasklist->overflow_store != NULL)
+            xfce_tasklist_overflow_popup_remove_child (tasklist, child);
+
           if (child->motion_timeout_id != 0)
             g_source_remove (child->motion_timeout_id);
 
+          if (child->name_changed_timeout_id != 0)
+            g_source_remove (child->name_changed_timeout_id);
+
           g_slice_free (XfceTasklistChild, child);
 
           /* queue a resize if needed */
@@ -1494,6 +1569,7 @@ xfce_tasklist_arrow_button_toggled (GtkWidget    *button,
   XfceTasklistChild *child;
   GtkWidget         *mi;
   GtkWidget         *menu;
+  guint              n_children;
 
   panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
   panel_return_if_fail (GTK_IS_TOGGLE_BUTTON (button));
@@ -1501,6 +1577,21 @@ xfce_tasklist_arrow_button_toggled (GtkWidget    *button,
 
   if (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (button)))
     {
+      for (li = tasklist->windows, n_children = 0; li != NULL; li = li->next)
+        {
+          child = li->data;
+          if (child->type == CHILD_TYPE_OVERFLOW_MENU)
+            n_children++;
+        }
+
+      /* a menu item per window becomes slow with many windows, use
+       * the popup that only renders the visible rows instead */
+      if (n_children > OVERFLOW_POPUP_THRESHOLD)
+        {
+          xfce_tasklist_overflow_popup_show (tasklist);
+          return;
+        }
+
       menu = gtk_menu_new ();
       g_signal_connect (G_OBJECT (menu), "selection-done",
           G_CALLBACK (xfce_tasklist_arrow_button_menu_destroy), tasklist);
@@ -1580,6 +1671,13 @@ xfce_tasklist_disconnect_screen (XfceTasklist *tasklist)
   panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
   panel_return_if_fail (WNCK_IS_SCREEN (tasklist->screen));
 
+  /* the popup references the children we're about to remove */
+  xfce_tasklist_overflow_popup_hide (tasklist);
+
+  /* drop pending auto grouping decisions */
+  if (tasklist->auto_group_id != 0)
+    g_source_remove (tasklist->auto_group_id);
+
   /* disconnect configure-event signal */
   g_signal_handlers_disconnect_by_func (
       G_OBJECT (gtk_widget_get_toplevel (GTK_WIDGET (tasklist))),
@@ -1802,7 +1900,9 @@ xfce_tasklist_window_added (WnckScreen   *screen,
                                             child->class_group,
                                             NULL, (gpointer *) &group_child);
 
-      if (G_UNLIKELY (tasklist->grouping == XFCE_TASKLIST_GROUPING_ALWAYS))
+      if (G_UNLIKELY (tasklist->grouping == XFCE_TASKLIST_GROUPING_ALWAYS)
+          || (tasklist->grouping == XFCE_TASKLIST_GROUPING_AUTO
+              && group_child != NULL))
         {
 
           if (group_child == NULL)
@@ -1957,12 +2057,24 @@ xfce_tasklist_skipped_windows_state_changed (WnckWindow      *window,
 static void
 xfce_tasklist_sort (XfceTasklist *tasklist)
 {
+  GList *li;
+
   panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
 
-  if (tasklist->sort_order != XFCE_TASKLIST_SORT_ORDER_DND)
-    tasklist->windows = g_list_sort_with_data (tasklist->windows,
-                                               xfce_tasklist_button_compare,
-                                               tasklist);
+  if (tasklist->sort_order == XFCE_TASKLIST_SORT_ORDER_DND)
+    return;
+
+  /* avoid a relayout if the order did not change */
+  for (li = tasklist->windows; li != NULL && li->next != NULL; li = li->next)
+    if (xfce_tasklist_button_compare (li->data, li->next->data, tasklist) > 0)
+      break;
+
+  if (li == NULL || li->next == NULL)
+    return;
+
+  tasklist->windows = g_list_sort_with_data (tasklist->windows,
+                                             xfce_tasklist_button_compare,
+                                             tasklist);
 
   gtk_widget_queue_resize (GTK_WIDGET (tasklist));
 }
@@ -2264,122 +2376,234 @@ xfce_tasklist_child_new (XfceTasklist *tasklist)
  * Wire Frame
  **/
 #ifdef GDK_WINDOWING_X11
-static void
-xfce_tasklist_wireframe_hide (XfceTasklist *tasklist)
+static gboolean
+xfce_tasklist_wireframe_draw (GtkWidget    *widget,
+                              cairo_t      *cr,
+                              XfceTasklist *tasklist)
 {
-  GdkDisplay *dpy;
+  gint width, height;
 
-  panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
+  panel_return_val_if_fail (XFCE_IS_TASKLIST (tasklist), FALSE);
 
-  if (tasklist->wireframe_window != 0)
-    {
-      /* unmap the window */
-      dpy = gtk_widget_get_display (GTK_WIDGET (tasklist));
-      XUnmapWindow (GDK_DISPLAY_XDISPLAY (dpy), tasklist->wireframe_window);
-    }
+  width = gtk_widget_get_allocated_width (widget);
+  height = gtk_widget_get_allocated_height (widget);
+
+  /* clear the inside of the frame, without compositing this
+   * is handled by the window shape */
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_rgba (cr, 0.0, 0.0, 0.0, 0.0);
+  cairo_paint (cr);
+
+  /* black frame */
+  cairo_set_source_rgb (cr, 0.0, 0.0, 0.0);
+  cairo_set_fill_rule (cr, CAIRO_FILL_RULE_EVEN_ODD);
+  cairo_rectangle (cr, 0, 0, width, height);
+  cairo_rectangle (cr, WIREFRAME_SIZE, WIREFRAME_SIZE,
+                   width - 2 * WIREFRAME_SIZE, height - 2 * WIREFRAME_SIZE);
+  cairo_fill (cr);
+
+  /* the outer and inner white rectangle */
+  cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
+  cairo_set_line_width (cr, 1.0);
+  cairo_rectangle (cr, 0.5, 0.5, width - 1, height - 1);
+  cairo_rectangle (cr, WIREFRAME_SIZE - 0.5, WIREFRAME_SIZE - 0.5,
+                   width - 2 * (WIREFRAME_SIZE - 1) - 1,
+                   height - 2 * (WIREFRAME_SIZE - 1) - 1);
+  cairo_stroke (cr);
+
+  return TRUE;
 }
 
 
 
 static void
-xfce_tasklist_wireframe_destroy (XfceTasklist *tasklist)
+xfce_tasklist_wireframe_create (XfceTasklist *tasklist)
 {
-  GdkDisplay *dpy;
+  GdkScreen      *screen;
+  GdkVisual      *visual;
+  cairo_region_t *region;
 
   panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
+  panel_return_if_fail (tasklist->wireframe_window == NULL);
+
+  screen = gtk_widget_get_screen (GTK_WIDGET (tasklist));
+
+  tasklist->wireframe_window = gtk_window_new (GTK_WINDOW_POPUP);
+  gtk_window_set_screen (GTK_WINDOW (tasklist->wireframe_window), screen);
+  gtk_widget_set_app_paintable (tasklist->wireframe_window, TRUE);
+  g_signal_connect (G_OBJECT (tasklist->wireframe_window), "draw",
+      G_CALLBACK (xfce_tasklist_wireframe_draw), tasklist);
+
+  /* use an argb window if possible, so we don't have to reshape the
+   * window every time the size changes */
+  visual = gdk_screen_get_rgba_visual (screen);
+  tasklist->wireframe_composited = visual != NULL && gdk_screen_is_composited (screen);
+  if (tasklist->wireframe_composited)
+    gtk_widget_set_visual (tasklist->wireframe_window, visual);
+
+  /* the wireframe should never receive input */
+  region = cairo_region_create ();
+  gtk_widget_input_shape_combine_region (tasklist->wireframe_window, region);
+  cairo_region_destroy (region);
+
+  /* nothing is mapped yet */
+  tasklist->wireframe_geometry.width = 0;
+  tasklist->wireframe_geometry.height = 0;
+}
+
+
+
+static gboolean
+xfce_tasklist_wireframe_update_idle (gpointer data)
+{
+  XfceTasklist          *tasklist = XFCE_TASKLIST (data);
+  GdkRectangle          *geometry = &tasklist->wireframe_pending;
+  GdkScreen             *screen;
+  cairo_region_t        *region;
+  cairo_rectangle_int_t  rect;
+  gint                   scale_factor;
+  gint                   x, y, width, height;
+
+  /* hide the window */
+  if (geometry->width <= 0)
+    {
+      if (tasklist->wireframe_window != NULL)
+        gtk_widget_hide (tasklist->wireframe_window);
+
+      return FALSE;
+    }
 
-  if (tasklist->wireframe_window != 0)
+  /* recreate the window if the compositor was started or stopped */
+  screen = gtk_widget_get_screen (GTK_WIDGET (tasklist));
+  if (tasklist->wireframe_window != NULL
+      && (tasklist->wireframe_composited != gdk_screen_is_composited (screen)
+          || gtk_widget_get_screen (tasklist->wireframe_window) != screen))
     {
-      /* unmap and destroy the window */
-      dpy = gtk_widget_get_display (GTK_WIDGET (tasklist));
-      XUnmapWindow (GDK_DISPLAY_XDISPLAY (dpy), tasklist->wireframe_window);
-      XDestroyWindow (GDK_DISPLAY_XDISPLAY (dpy), tasklist->wireframe_window);
+      gtk_widget_destroy (tasklist->wireframe_window);
+      tasklist->wireframe_window = NULL;
+    }
+
+  if (G_UNLIKELY (tasklist->wireframe_window == NULL))
+    xfce_tasklist_wireframe_create (tasklist);
+
+  /* nothing changed since the last update */
+  if (gtk_widget_get_visible (tasklist->wireframe_window)
+      && gdk_rectangle_equal (geometry, &tasklist->wireframe_geometry))
+    return FALSE;
 
-      tasklist->wireframe_window = 0;
+  /* wnck returns device pixels, gtk wants application pixels */
+  scale_factor = MAX (gtk_widget_get_scale_factor (tasklist->wireframe_window), 1);
+  x = geometry->x / scale_factor;
+  y = geometry->y / scale_factor;
+  width = MAX (geometry->width / scale_factor, 1);
+  height = MAX (geometry->height / scale_factor, 1);
+
+  /* without compositing, cut out the inside of the frame */
+  if (!tasklist->wireframe_composited
+      && (geometry->width != tasklist->wireframe_geometry.width
+          || geometry->height != tasklist->wireframe_geometry.height))
+    {
+      rect.x = 0;
+      rect.y = 0;
+      rect.width = width;
+      rect.height = height;
+      region = cairo_region_create_rectangle (&rect);
+
+      rect.x = WIREFRAME_SIZE;
+      rect.y = WIREFRAME_SIZE;
+      rect.width = width - WIREFRAME_SIZE * 2;
+      rect.height = height - WIREFRAME_SIZE * 2;
+      if (rect.width > 0 && rect.height > 0)
+        cairo_region_subtract_rectangle (region, &rect);
+
+      gtk_widget_shape_combine_region (tasklist->wireframe_window, region);
+      cairo_region_destroy (region);
     }
+
+  /* gtk merges these in a single configure request */
+  gtk_window_move (GTK_WINDOW (tasklist->wireframe_window), x, y);
+  gtk_window_resize (GTK_WINDOW (tasklist->wireframe_window), width, height);
+  gtk_widget_show (tasklist->wireframe_window);
+
+  tasklist->wireframe_geometry = *geometry;
+
+  return FALSE;
 }
 
 
 
 static void
-xfce_tasklist_wireframe_update (XfceTasklist      *tasklist,
-                                XfceTasklistChild *child)
+xfce_tasklist_wireframe_update_idle_destroyed (gpointer data)
 {
-  Display              *dpy;
-  GdkDisplay           *gdpy;
-  gint                  x, y, width, height;
-  XSetWindowAttributes  attrs;
-  GC                    gc;
-  XRectangle            xrect;
+  XFCE_TASKLIST (data)->wireframe_update_id = 0;
+}
 
-  panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
-  panel_return_if_fail (tasklist->show_wireframes == TRUE);
-  panel_return_if_fail (WNCK_IS_WINDOW (child->window));
 
-  /* get the window geometry */
-  wnck_window_get_geometry (child->window, &x, &y, &width, &height);
 
-  gdpy = gtk_widget_get_display (GTK_WIDGET (tasklist));
-  dpy = GDK_DISPLAY_XDISPLAY (gdpy);
+static void
+xfce_tasklist_wireframe_queue_update (XfceTasklist *tasklist)
+{
+  panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
 
-  if (G_LIKELY (tasklist->wireframe_window != 0))
+  /* when the pointer moves over many buttons, the leave and enter
+   * events are merged in a single update of the window */
+  if (tasklist->wireframe_update_id == 0)
     {
-      /* reposition the wireframe */
-      XMoveResizeWindow (dpy, tasklist->wireframe_window, x, y, width, height);
-
-      /* full window rectangle */
-      xrect.x = 0;
-      xrect.y = 0;
-      xrect.width = width;
-      xrect.height = height;
-
-      /* we need to restore the window first */
-      XShapeCombineRectangles (dpy, tasklist->wireframe_window, ShapeBounding,
-                               0, 0, &xrect, 1, ShapeSet, Unsorted);
+      tasklist->wireframe_update_id =
+          gdk_threads_add_idle_full (G_PRIORITY_HIGH_IDLE, xfce_tasklist_wireframe_update_idle,
+                                     tasklist, xfce_tasklist_wireframe_update_idle_destroyed);
     }
-  else
+}
+
+
+
+static void
+xfce_tasklist_wireframe_hide (XfceTasklist *tasklist)
+{
+  panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
+
+  if (tasklist->wireframe_window != NULL
+      || tasklist->wireframe_update_id != 0)
     {
-      /* set window attributes */
-      attrs.override_redirect = True;
-      attrs.background_pixel = 0x000000;
-
-      /* create new window */
-      tasklist->wireframe_window = XCreateWindow (dpy, DefaultRootWindow (dpy),
-                                                  x, y, width, height, 0,
-                                                  CopyFromParent, InputOutput,
-                                                  CopyFromParent,
-                                                  CWOverrideRedirect | CWBackPixel,
-                                                  &attrs);
+      tasklist->wireframe_pending.width = 0;
+      xfce_tasklist_wireframe_queue_update (tasklist);
     }
+}
 
-  /* create rectangle what will be 'transparent' in the window */
-  xrect.x = WIREFRAME_SIZE;
-  xrect.y = WIREFRAME_SIZE;
-  xrect.width = width - WIREFRAME_SIZE * 2;
-  xrect.height = height - WIREFRAME_SIZE * 2;
 
-  /* substruct rectangle from the window */
-  XShapeCombineRectangles (dpy, tasklist->wireframe_window, ShapeBounding,
-                           0, 0, &xrect, 1, ShapeSubtract, Unsorted);
 
-  /* map the window */
-  XMapWindow (dpy, tasklist->wireframe_window);
+static void
+xfce_tasklist_wireframe_destroy (XfceTasklist *tasklist)
+{
+  panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
+
+  if (tasklist->wireframe_update_id != 0)
+    g_source_remove (tasklist->wireframe_update_id);
+
+  if (tasklist->wireframe_window != NULL)
+    {
+      gtk_widget_destroy (tasklist->wireframe_window);
+      tasklist->wireframe_window = NULL;
+    }
+}
+
 
-  /* create a white gc */
-  gc = XCreateGC (dpy, tasklist->wireframe_window, 0, NULL);
-  XSetForeground (dpy, gc, 0xffffff);
 
-  /* draw the outer white rectangle */
-  XDrawRectangle (dpy, tasklist->wireframe_window, gc,
-                  0, 0, width - 1, height - 1);
+static void
+xfce_tasklist_wireframe_update (XfceTasklist      *tasklist,
+                                XfceTasklistChild *child)
+{
+  GdkRectangle *geometry = &tasklist->wireframe_pending;
+
+  panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
+  panel_return_if_fail (tasklist->show_wireframes == TRUE);
+  panel_return_if_fail (WNCK_IS_WINDOW (child->window));
 
-  /* draw the inner white rectangle */
-  XDrawRectangle (dpy, tasklist->wireframe_window, gc,
-                  WIREFRAME_SIZE - 1, WIREFRAME_SIZE - 1,
-                  width - 2 * (WIREFRAME_SIZE - 1) - 1,
-                  height - 2 * (WIREFRAME_SIZE - 1) - 1);
+  /* the geometry is cached by wnck, so this does not talk to the server */
+  wnck_window_get_geometry (child->window, &geometry->x, &geometry->y,
+                            &geometry->width, &geometry->height);
 
-  XFreeGC (dpy, gc);
+  xfce_tasklist_wireframe_queue_update (tasklist);
 }
 #endif
 
@@ -2615,15 +2839,16 @@ xfce_tasklist_button_name_changed (WnckWindow        *window,
                                    XfceTasklistChild *child)
 {
   const gchar     *name;
+  const gchar     *tooltip;
   gchar           *label = NULL;
   GtkStyleContext *ctx;
+  XfceTasklist    *tasklist = child->tasklist;
 
   panel_return_if_fail (window == NULL || child->window == window);
   panel_return_if_fail (WNCK_IS_WINDOW (child->window));
   panel_return_if_fail (XFCE_IS_TASKLIST (child->tasklist));
 
-  name = wnck_window_get_name (child->window);
-  gtk_widget_set_tooltip_text (GTK_WIDGET (child->button), name);
+  name = tooltip = wnck_window_get_name (child->window);
 
   ctx = gtk_widget_get_style_context (child->label);
   gtk_style_context_remove_class (ctx, "label-hidden");
@@ -2645,14 +2870,87 @@ xfce_tasklist_button_name_changed (WnckWindow        *window,
         gtk_style_context_add_class (ctx, "label-hidden");
     }
 
+  /* leave when the label did not change, setting the same text
+   * would still queue a resize of the tasklist */
+  if (g_strcmp0 (gtk_label_get_text (GTK_LABEL (child->label)), name) == 0)
+    {
+      g_free (label);
+      return;
+    }
+
+  gtk_widget_set_tooltip_text (GTK_WIDGET (child->button), tooltip);
   gtk_label_set_text (GTK_LABEL (child->label), name);
 
   g_free (label);
 
   /* if window is null, we have not inserted the button the in
-   * tasklist, so no need to sort, because we insert with sorting */
-  if (window != NULL)
-    xfce_tasklist_sort (child->tasklist);
+   * tasklist, so no need to sort, because we insert with sorting.
+   * otherwise only sort if the title is used for sorting */
+  if (window != NULL
+      && (tasklist->sort_order == XFCE_TASKLIST_SORT_ORDER_TITLE
+          || tasklist->sort_order == XFCE_TASKLIST_SORT_ORDER_GROUP_TITLE
+          || (tasklist->sort_order == XFCE_TASKLIST_SORT_ORDER_GROUP_TIMESTAMP
+              && (child->class_group == NULL
+                  || panel_str_is_empty (wnck_class_group_get_name (child->class_group))))))
+    xfce_tasklist_sort (tasklist);
+}
+
+
+
+static gboolean
+xfce_tasklist_button_name_changed_timeout (gpointer data)
+{
+  XfceTasklistChild *child = data;
+
+  panel_return_val_if_fail (WNCK_IS_WINDOW (child->window), FALSE);
+
+  child->name_changed_time = g_get_monotonic_time ();
+  xfce_tasklist_button_name_changed (child->window, child);
+
+  return FALSE;
+}
+
+
+
+static void
+xfce_tasklist_button_name_changed_timeout_destroyed (gpointer data)
+{
+  XfceTasklistChild *child = data;
+
+  child->name_changed_timeout_id = 0;
+}
+
+
+
+static void
+xfce_tasklist_button_name_changed_limited (WnckWindow        *window,
+                                           XfceTasklistChild *child)
+{
+  gint64 elapsed;
+
+  panel_return_if_fail (child->window == window);
+  panel_return_if_fail (XFCE_IS_TASKLIST (child->tasklist));
+
+  /* an update is already scheduled, it will pick up this title too */
+  if (child->name_changed_timeout_id != 0)
+    return;
+
+  /* terminals and browsers can change their title many times per
+   * second, update at most once per interval */
+  elapsed = (g_get_monotonic_time () - child->name_changed_time) / 1000;
+  if (elapsed >= NAME_CHANGED_INTERVAL)
+    {
+      child->name_changed_time = g_get_monotonic_time ();
+      xfce_tasklist_button_name_changed (window, child);
+    }
+  else
+    {
+      /* make sure the last title is shown */
+      child->name_changed_timeout_id =
+          gdk_threads_add_timeout_full (G_PRIORITY_LOW, NAME_CHANGED_INTERVAL - elapsed,
+                                        xfce_tasklist_button_name_changed_timeout, child,
+                                        xfce_tasklist_button_name_changed_timeout_destroyed);
+    }
 }
 
 
@@ -3392,7 +3690,7 @@ xfce_tasklist_button_new (WnckWindow   *window,
   g_signal_connect (G_OBJECT (window), "icon-changed",
       G_CALLBACK (xfce_tasklist_button_icon_changed), child);
   g_signal_connect (G_OBJECT (window), "name-changed",
-      G_CALLBACK (xfce_tasklist_button_name_changed), child);
+      G_CALLBACK (xfce_tasklist_button_name_changed_limited), child);
   g_signal_connect (G_OBJECT (window), "state-changed",
       G_CALLBACK (xfce_tasklist_button_state_changed), child);
   g_signal_connect (G_OBJECT (window), "workspace-changed",
@@ -3821,6 +4119,10 @@ xfce_tasklist_group_button_remove (XfceTasklistChild *group_child)
       n = g_signal_handlers_disconnect_matched (G_OBJECT (child->button),
           G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, group_child);
       panel_return_if_fail (n == 2);
+
+      /* the window gets its own button again */
+      if (child->type == CHILD_TYPE_GROUP_MENU)
+        child->type = CHILD_TYPE_WINDOW;
     }
 
   g_slist_free (group_child->windows);
@@ -3905,11 +4207,9 @@ xfce_tasklist_group_button_child_destroyed (XfceTasklistChild *group_child,
     }
 
   if ((group_child->tasklist->grouping == XFCE_TASKLIST_GROUPING_ALWAYS
-       && n_children > 0))
-#if 0
+       && n_children > 0)
       || (group_child->tasklist->grouping == XFCE_TASKLIST_GROUPING_AUTO
           && n_children > 1))
-#endif
     {
       xfce_tasklist_group_button_child_visible_changed (group_child);
       xfce_tasklist_group_button_name_changed (NULL, group_child);
@@ -3990,6 +4290,750 @@ xfce_tasklist_group_button_new (WnckClassGroup *class_group,
 
 
 
+/**
+ * Auto Grouping
+ **/
+static GArray *
+xfce_tasklist_auto_group_collect (XfceTasklist *tasklist)
+{
+  GArray                *groups;
+  GHashTable            *indices;
+  GList                 *li;
+  XfceTasklistChild     *child;
+  XfceTasklistAutoGroup *group;
+  XfceTasklistAutoGroup  new_group;
+  gpointer               idx;
+
+  groups = g_array_new (FALSE, FALSE, sizeof (XfceTasklistAutoGroup));
+  indices = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  /* count the visible windows in each class group */
+  for (li = tasklist->windows; li != NULL; li = li->next)
+    {
+      child = li->data;
+
+      if (child->type == CHILD_TYPE_GROUP
+          || child->class_group == NULL
+          || !gtk_widget_get_visible (child->button))
+        continue;
+
+      if (g_hash_table_lookup_extended (indices, child->class_group, NULL, &idx))
+        {
+          group = &g_array_index (groups, XfceTasklistAutoGroup, GPOINTER_TO_UINT (idx));
+        }
+      else
+        {
+          new_group.class_group = child->class_group;
+          new_group.id = wnck_class_group_get_id (child->class_group);
+          new_group.n_windows = 0;
+          new_group.grouped = g_hash_table_lookup (tasklist->class_groups, child->class_group) != NULL;
+
+          g_hash_table_insert (indices, child->class_group, GUINT_TO_POINTER (groups->len));
+          g_array_append_val (groups, new_group);
+          group = &g_array_index (groups, XfceTasklistAutoGroup, groups->len - 1);
+        }
+
+      group->n_windows++;
+    }
+
+  g_hash_table_destroy (indices);
+
+  xfce_tasklist_layout_auto_group_sort (groups);
+
+  return groups;
+}
+
+
+
+static gboolean
+xfce_tasklist_auto_group_idle (gpointer data)
+{
+  XfceTasklist      *tasklist = XFCE_TASKLIST (data);
+  GSList            *lp;
+  GList             *li;
+  WnckClassGroup    *class_group;
+  XfceTasklistChild *group_child;
+  XfceTasklistChild *child;
+
+  panel_return_val_if_fail (XFCE_IS_TASKLIST (tasklist), FALSE);
+  panel_return_val_if_fail (tasklist->grouping == XFCE_TASKLIST_GROUPING_AUTO, FALSE);
+
+  for (lp = tasklist->auto_group_collapse; lp != NULL; lp = lp->next)
+    {
+      class_group = lp->data;
+
+      /* skip groups that are gone or already have a button */
+      if (!g_hash_table_lookup_extended (tasklist->class_groups, class_group,
+                                         NULL, (gpointer *) &group_child)
+          || group_child != NULL)
+        continue;
+
+      panel_debug (PANEL_DEBUG_TASKLIST, "auto grouping class group %s",
+                   wnck_class_group_get_id (class_group));
+
+      group_child = xfce_tasklist_group_button_new (class_group, tasklist);
+      g_hash_table_insert (tasklist->class_groups,
+                           g_object_ref (class_group),
+                           group_child);
+
+      for (li = tasklist->windows; li != NULL; li = li->next)
+        {
+          child = li->data;
+          if (child->type != CHILD_TYPE_GROUP
+              && child->class_group == class_group)
+            xfce_tasklist_group_button_add_window (group_child, child);
+        }
+    }
+
+  for (lp = tasklist->auto_group_expand; lp != NULL; lp = lp->next)
+    {
+      class_group = lp->data;
+
+      if (!g_hash_table_lookup_extended (tasklist->class_groups, class_group,
+                                         NULL, (gpointer *) &group_child)
+          || group_child == NULL)
+        continue;
+
+      panel_debug (PANEL_DEBUG_TASKLIST, "auto ungrouping class group %s",
+                   wnck_class_group_get_id (class_group));
+
+      /* this destroys the group button */
+      g_object_ref (G_OBJECT (class_group));
+      g_hash_table_replace (tasklist->class_groups, class_group, NULL);
+    }
+
+  return FALSE;
+}
+
+
+
+static void
+xfce_tasklist_auto_group_idle_destroyed (gpointer data)
+{
+  XfceTasklist *tasklist = XFCE_TASKLIST (data);
+
+  g_slist_free_full (tasklist->auto_group_collapse, g_object_unref);
+  tasklist->auto_group_collapse = NULL;
+
+  g_slist_free_full (tasklist->auto_group_expand, g_object_unref);
+  tasklist->auto_group_expand = NULL;
+
+  tasklist->auto_group_id = 0;
+}
+
+
+
+static gboolean
+xfce_tasklist_auto_group_update (XfceTasklist *tasklist,
+                                 gint          n_buttons,
+                                 gint          capacity)
+{
+  GArray *groups;
+  GSList *lp;
+
+  panel_return_val_if_fail (XFCE_IS_TASKLIST (tasklist), FALSE);
+
+  /* wait until the previous decision is applied */
+  if (tasklist->auto_group_id != 0)
+    return TRUE;
+
+  groups = xfce_tasklist_auto_group_collect (tasklist);
+  xfce_tasklist_layout_auto_group_decide (groups, n_buttons, capacity,
+                                          &tasklist->auto_group_collapse,
+                                          &tasklist->auto_group_expand);
+  g_array_free (groups, TRUE);
+
+  for (lp = tasklist->auto_group_collapse; lp != NULL; lp = lp->next)
+    g_object_ref (G_OBJECT (lp->data));
+  for (lp = tasklist->auto_group_expand; lp != NULL; lp = lp->next)
+    g_object_ref (G_OBJECT (lp->data));
+
+  /* we're in the middle of an allocation, so don't add or remove
+   * buttons here */
+  if (tasklist->auto_group_collapse != NULL
+      || tasklist->auto_group_expand != NULL)
+    tasklist->auto_group_id = gdk_threads_add_idle_full (G_PRIORITY_HIGH_IDLE, xfce_tasklist_auto_group_idle,
+                                                         tasklist, xfce_tasklist_auto_group_idle_destroyed);
+
+  return tasklist->auto_group_id != 0;
+}
+
+
+
+/**
+ * Overflow Popup
+ **/
+static gchar *
+xfce_tasklist_overflow_popup_key (const gchar *text)
+{
+  gchar *normalized;
+  gchar *key;
+
+  if (text == NULL)
+    return NULL;
+
+  /* normalize the title so we can do a cheap substring match */
+  normalized = g_utf8_normalize (text, -1, G_NORMALIZE_ALL);
+  if (G_UNLIKELY (normalized == NULL))
+    return NULL;
+
+  key = g_utf8_casefold (normalized, -1);
+  g_free (normalized);
+
+  return key;
+}
+
+
+
+static gboolean
+xfce_tasklist_overflow_popup_visible_func (GtkTreeModel *model,
+                                           GtkTreeIter  *iter,
+                                           gpointer      user_data)
+{
+  XfceTasklist *tasklist = XFCE_TASKLIST (user_data);
+  gchar        *key;
+  gboolean      visible;
+
+  if (panel_str_is_empty (tasklist->overflow_filter_key))
+    return TRUE;
+
+  gtk_tree_model_get (model, iter, OVERFLOW_COLUMN_KEY, &key, -1);
+  visible = (key != NULL && strstr (key, tasklist->overflow_filter_key) != NULL);
+  g_free (key);
+
+  return visible;
+}
+
+
+
+static XfceTasklistChild *
+xfce_tasklist_overflow_popup_get_child (XfceTasklist *tasklist,
+                                        GtkTreePath  *path)
+{
+  GtkTreeIter        iter;
+  XfceTasklistChild *child = NULL;
+
+  if (path != NULL
+      && gtk_tree_model_get_iter (tasklist->overflow_filter, &iter, path))
+    gtk_tree_model_get (tasklist->overflow_filter, &iter,
+                        OVERFLOW_COLUMN_CHILD, &child, -1);
+
+  return child;
+}
+
+
+
+static XfceTasklistChild *
+xfce_tasklist_overflow_popup_get_child_at_pos (XfceTasklist *tasklist,
+                                               gdouble       x,
+                                               gdouble       y)
+{
+  GtkTreePath       *path;
+  XfceTasklistChild *child = NULL;
+
+  if (gtk_tree_view_get_path_at_pos (GTK_TREE_VIEW (tasklist->overflow_view),
+                                     x, y, &path, NULL, NULL, NULL))
+    {
+      child = xfce_tasklist_overflow_popup_get_child (tasklist, path);
+      gtk_tree_path_free (path);
+    }
+
+  return child;
+}
+
+
+
+static void
+xfce_tasklist_overflow_popup_move_cursor (XfceTasklist *tasklist,
+                                          gint          delta)
+{
+  GtkTreePath *path = NULL;
+  gint         n_rows;
+  gint         idx = -1;
+
+  n_rows = gtk_tree_model_iter_n_children (tasklist->overflow_filter, NULL);
+  if (n_rows == 0)
+    return;
+
+  gtk_tree_view_get_cursor (GTK_TREE_VIEW (tasklist->overflow_view), &path, NULL);
+  if (path != NULL)
+    {
+      idx = gtk_tree_path_get_indices (path)[0];
+      gtk_tree_path_free (path);
+    }
+
+  idx = CLAMP (idx + delta, 0, n_rows - 1);
+
+  path = gtk_tree_path_new_from_indices (idx, -1);
+  gtk_tree_view_set_cursor (GTK_TREE_VIEW (tasklist->overflow_view), path, NULL, FALSE);
+  gtk_tree_path_free (path);
+}
+
+
+
+static void
+xfce_tasklist_overflow_popup_entry_changed (GtkEntry     *entry,
+                                            XfceTasklist *tasklist)
+{
+  GtkTreePath *path;
+
+  panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
+
+  g_free (tasklist->overflow_filter_key);
+  tasklist->overflow_filter_key = xfce_tasklist_overflow_popup_key (gtk_entry_get_text (entry));
+
+  gtk_tree_model_filter_refilter (GTK_TREE_MODEL_FILTER (tasklist->overflow_filter));
+
+  /* select the first match */
+  if (gtk_tree_model_iter_n_children (tasklist->overflow_filter, NULL) > 0)
+    {
+      path = gtk_tree_path_new_first ();
+      gtk_tree_view_set_cursor (GTK_TREE_VIEW (tasklist->overflow_view), path, NULL, FALSE);
+      gtk_tree_path_free (path);
+    }
+}
+
+
+
+static void
+xfce_tasklist_overflow_popup_entry_activate (GtkEntry     *entry,
+                                             XfceTasklist *tasklist)
+{
+  GtkTreePath       *path;
+  XfceTasklistChild *child;
+
+  panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
+
+  gtk_tree_view_get_cursor (GTK_TREE_VIEW (tasklist->overflow_view), &path, NULL);
+  child = xfce_tasklist_overflow_popup_get_child (tasklist, path);
+  if (path != NULL)
+    gtk_tree_path_free (path);
+
+  if (child != NULL)
+    {
+      xfce_tasklist_overflow_popup_hide (tasklist);
+      xfce_tasklist_button_activate (child, gtk_get_current_event_time ());
+    }
+}
+
+
+
+static gboolean
+xfce_tasklist_overflow_popup_key_press_event (GtkWidget    *popup,
+                                              GdkEventKey  *event,
+                                              XfceTasklist *tasklist)
+{
+  panel_return_val_if_fail (XFCE_IS_TASKLIST (tasklist), FALSE);
+
+  switch (event->keyval)
+    {
+    case GDK_KEY_Escape:
+      xfce_tasklist_overflow_popup_hide (tasklist);
+      return TRUE;
+
+    case GDK_KEY_Up:
+    case GDK_KEY_KP_Up:
+      xfce_tasklist_overflow_popup_move_cursor (tasklist, -1);
+      return TRUE;
+
+    case GDK_KEY_Down:
+    case GDK_KEY_KP_Down:
+      xfce_tasklist_overflow_popup_move_cursor (tasklist, 1);
+      return TRUE;
+
+    case GDK_KEY_Page_Up:
+    case GDK_KEY_KP_Page_Up:
+      xfce_tasklist_overflow_popup_move_cursor (tasklist, -10);
+      return TRUE;
+
+    case GDK_KEY_Page_Down:
+    case GDK_KEY_KP_Page_Down:
+      xfce_tasklist_overflow_popup_move_cursor (tasklist, 10);
+      return TRUE;
+
+    default:
+      break;
+    }
+
+  return FALSE;
+}
+
+
+
+static gboolean
+xfce_tasklist_overflow_popup_button_press_event (GtkWidget      *popup,
+                                                 GdkEventButton *event,
+                                                 XfceTasklist   *tasklist)
+{
+  gint          window_x, window_y;
+  GtkAllocation allocation;
+
+  panel_return_val_if_fail (XFCE_IS_TASKLIST (tasklist), FALSE);
+
+  if (event->type != GDK_BUTTON_PRESS)
+    return FALSE;
+
+  /* we own the grab, so clicks outside the popup end up here */
+  gdk_window_get_position (gtk_widget_get_window (popup), &window_x, &window_y);
+  gtk_widget_get_allocation (popup, &allocation);
+
+  if (event->x_root < window_x || event->x_root >= window_x + allocation.width
+      || event->y_root < window_y || event->y_root >= window_y + allocation.height)
+    {
+      xfce_tasklist_overflow_popup_hide (tasklist);
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+
+
+static gboolean
+xfce_tasklist_overflow_popup_button_release_event (GtkWidget      *view,
+                                                   GdkEventButton *event,
+                                                   XfceTasklist   *tasklist)
+{
+  XfceTasklistChild *child;
+  GtkWidget         *menu;
+
+  panel_return_val_if_fail (XFCE_IS_TASKLIST (tasklist), FALSE);
+
+  child = xfce_tasklist_overflow_popup_get_child_at_pos (tasklist, event->x, event->y);
+  if (child == NULL)
+    return FALSE;
+
+  panel_return_val_if_fail (WNCK_IS_WINDOW (child->window), FALSE);
+
+  xfce_tasklist_overflow_popup_hide (tasklist);
+
+  if (event->button == 1)
+    {
+      xfce_tasklist_button_activate (child, event->time);
+    }
+  else if (event->button == 2)
+    {
+      /* same as xfce_tasklist_button_button_release_event */
+      if (tasklist->middle_click == XFCE_TASKLIST_MIDDLE_CLICK_CLOSE_WINDOW)
+        wnck_window_close (child->window, event->time);
+      else if (tasklist->middle_click == XFCE_TASKLIST_MIDDLE_CLICK_MINIMIZE_WINDOW
+               && !wnck_window_is_minimized (child->window))
+        wnck_window_minimize (child->window);
+    }
+  else if (event->button == 3)
+    {
+      menu = wnck_action_menu_new (child->window);
+      g_signal_connect (G_OBJECT (menu), "selection-done",
+          G_CALLBACK (xfce_tasklist_button_menu_destroy), child);
+
+      gtk_menu_attach_to_widget (GTK_MENU (menu), tasklist->arrow_button, NULL);
+      gtk_menu_popup_at_widget (GTK_MENU (menu), tasklist->arrow_button,
+                                xfce_tasklist_vertical (tasklist)
+                                ? GDK_GRAVITY_NORTH_EAST : GDK_GRAVITY_SOUTH_WEST,
+                                GDK_GRAVITY_NORTH_WEST,
+                                (GdkEvent *) event);
+    }
+
+  return TRUE;
+}
+
+
+
+static void
+xfce_tasklist_overflow_popup_row_activated (GtkTreeView       *view,
+                                            GtkTreePath       *path,
+                                            GtkTreeViewColumn *column,
+                                            XfceTasklist      *tasklist)
+{
+  XfceTasklistChild *child;
+
+  panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
+
+  child = xfce_tasklist_overflow_popup_get_child (tasklist, path);
+  if (child != NULL)
+    {
+      xfce_tasklist_overflow_popup_hide (tasklist);
+      xfce_tasklist_button_activate (child, gtk_get_current_event_time ());
+    }
+}
+
+
+
+#ifdef GDK_WINDOWING_X11
+static gboolean
+xfce_tasklist_overflow_popup_motion_notify_event (GtkWidget      *view,
+                                                  GdkEventMotion *event,
+                                                  XfceTasklist   *tasklist)
+{
+  XfceTasklistChild *child;
+
+  panel_return_val_if_fail (XFCE_IS_TASKLIST (tasklist), FALSE);
+
+  if (!tasklist->show_wireframes)
+    return FALSE;
+
+  /* only update the wireframe when the hovered row changed */
+  child = xfce_tasklist_overflow_popup_get_child_at_pos (tasklist, event->x, event->y);
+  if (child != tasklist->overflow_hover)
+    {
+      tasklist->overflow_hover = child;
+
+      if (child != NULL)
+        xfce_tasklist_wireframe_update (tasklist, child);
+      else
+        xfce_tasklist_wireframe_hide (tasklist);
+    }
+
+  return FALSE;
+}
+#endif
+
+
+
+static void
+xfce_tasklist_overflow_popup_create (XfceTasklist *tasklist)
+{
+  GtkWidget         *box;
+  GtkWidget         *scroll;
+  GtkTreeViewColumn *column;
+  GtkCellRenderer   *renderer;
+  PangoContext      *context;
+  PangoFontMetrics  *metrics;
+  gint               char_width;
+  gint               icon_width;
+
+  panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
+  panel_return_if_fail (tasklist->overflow_popup == NULL);
+
+  /* in-memory index of the overflowed windows */
+  tasklist->overflow_store = gtk_list_store_new (N_OVERFLOW_COLUMNS,
+                                                 GDK_TYPE_PIXBUF,
+                                                 G_TYPE_STRING,
+                                                 G_TYPE_STRING,
+                                                 G_TYPE_POINTER);
+  tasklist->overflow_filter = gtk_tree_model_filter_new (GTK_TREE_MODEL (tasklist->overflow_store), NULL);
+  gtk_tree_model_filter_set_visible_func (GTK_TREE_MODEL_FILTER (tasklist->overflow_filter),
+                                          xfce_tasklist_overflow_popup_visible_func,
+                                          tasklist, NULL);
+
+  tasklist->overflow_popup = gtk_window_new (GTK_WINDOW_POPUP);
+  gtk_widget_set_name (tasklist->overflow_popup, "panel-tasklist-overflow");
+  gtk_window_set_type_hint (GTK_WINDOW (tasklist->overflow_popup),
+                            GDK_WINDOW_TYPE_HINT_POPUP_MENU);
+  gtk_window_set_screen (GTK_WINDOW (tasklist->overflow_popup),
+                         gtk_widget_get_screen (GTK_WIDGET (tasklist)));
+  gtk_widget_add_events (tasklist->overflow_popup, GDK_BUTTON_PRESS_MASK | GDK_KEY_PRESS_MASK);
+  g_signal_connect (G_OBJECT (tasklist->overflow_popup), "key-press-event",
+      G_CALLBACK (xfce_tasklist_overflow_popup_key_press_event), tasklist);
+  g_signal_connect (G_OBJECT (tasklist->overflow_popup), "button-press-event",
+      G_CALLBACK (xfce_tasklist_overflow_popup_button_press_event), tasklist);
+
+  box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 2);
+  gtk_container_set_border_width (GTK_CONTAINER (box), 2);
+  gtk_container_add (GTK_CONTAINER (tasklist->overflow_popup), box);
+
+  /* type-to-filter entry */
+  tasklist->overflow_entry = gtk_search_entry_new ();
+  gtk_box_pack_start (GTK_BOX (box), tasklist->overflow_entry, FALSE, FALSE, 0);
+  g_signal_connect (G_OBJECT (tasklist->overflow_entry), "changed",
+      G_CALLBACK (xfce_tasklist_overflow_popup_entry_changed), tasklist);
+  g_signal_connect (G_OBJECT (tasklist->overflow_entry), "activate",
+      G_CALLBACK (xfce_tasklist_overflow_popup_entry_activate), tasklist);
+
+  scroll = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scroll),
+                                  GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+  gtk_scrolled_window_set_propagate_natural_height (GTK_SCROLLED_WINDOW (scroll), TRUE);
+  gtk_scrolled_window_set_max_content_height (GTK_SCROLLED_WINDOW (scroll), OVERFLOW_POPUP_MAX_HEIGHT);
+  gtk_box_pack_start (GTK_BOX (box), scroll, TRUE, TRUE, 0);
+
+  tasklist->overflow_view = gtk_tree_view_new_with_model (tasklist->overflow_filter);
+  gtk_tree_view_set_headers_visible (GTK_TREE_VIEW (tasklist->overflow_view), FALSE);
+  gtk_tree_view_set_enable_search (GTK_TREE_VIEW (tasklist->overflow_view), FALSE);
+  gtk_tree_view_set_hover_selection (GTK_TREE_VIEW (tasklist->overflow_view), TRUE);
+  gtk_widget_set_can_focus (tasklist->overflow_view, FALSE);
+  gtk_widget_add_events (tasklist->overflow_view, GDK_POINTER_MOTION_MASK);
+  gtk_container_add (GTK_CONTAINER (scroll), tasklist->overflow_view);
+  g_signal_connect (G_OBJECT (tasklist->overflow_view), "row-activated",
+      G_CALLBACK (xfce_tasklist_overflow_popup_row_activated), tasklist);
+  g_signal_connect (G_OBJECT (tasklist->overflow_view), "button-release-event",
+      G_CALLBACK (xfce_tasklist_overflow_popup_button_release_event), tasklist);
+#ifdef GDK_WINDOWING_X11
+  g_signal_connect (G_OBJECT (tasklist->overflow_view), "motion-notify-event",
+      G_CALLBACK (xfce_tasklist_overflow_popup_motion_notify_event), tasklist);
+#endif
+
+  column = gtk_tree_view_column_new ();
+  gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_FIXED);
+
+  renderer = gtk_cell_renderer_pixbuf_new ();
+  gtk_tree_view_column_pack_start (column, renderer, FALSE);
+  gtk_tree_view_column_set_attributes (column, renderer,
+                                       "pixbuf", OVERFLOW_COLUMN_ICON, NULL);
+
+  renderer = gtk_cell_renderer_text_new ();
+  g_object_set (G_OBJECT (renderer), "ellipsize", tasklist->ellipsize_mode, NULL);
+  gtk_tree_view_column_pack_start (column, renderer, TRUE);
+  gtk_tree_view_column_set_attributes (column, renderer,
+                                       "text", OVERFLOW_COLUMN_TITLE, NULL);
+
+  /* same width as the labels in the overflow menu */
+  context = gtk_widget_get_pango_context (tasklist->overflow_view);
+  metrics = pango_context_get_metrics (context, pango_context_get_font_description (context), NULL);
+  char_width = PANGO_PIXELS (pango_font_metrics_get_approximate_char_width (metrics));
+  pango_font_metrics_unref (metrics);
+  gtk_icon_size_lookup (GTK_ICON_SIZE_MENU, &icon_width, NULL);
+  gtk_tree_view_column_set_fixed_width (column, icon_width + 12
+                                        + char_width * tasklist->menu_max_width_chars);
+
+  gtk_tree_view_append_column (GTK_TREE_VIEW (tasklist->overflow_view), column);
+
+  /* with a fixed row height the view only measures and renders the
+   * rows in the viewport, the cell renderers are reused for each row */
+  gtk_tree_view_set_fixed_height_mode (GTK_TREE_VIEW (tasklist->overflow_view), TRUE);
+
+  gtk_widget_show_all (box);
+}
+
+
+
+static void
+xfce_tasklist_overflow_popup_show (XfceTasklist *tasklist)
+{
+  GList             *li;
+  XfceTasklistChild *child;
+  gchar             *key;
+  GtkWidget         *plugin;
+  GdkSeat           *seat;
+  gint               x, y;
+
+  panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
+
+  plugin = xfce_tasklist_get_panel_plugin (tasklist);
+  panel_return_if_fail (XFCE_IS_PANEL_PLUGIN (plugin));
+
+  if (tasklist->overflow_popup == NULL)
+    xfce_tasklist_overflow_popup_create (tasklist);
+
+  /* reset the filter */
+  gtk_entry_set_text (GTK_ENTRY (tasklist->overflow_entry), "");
+
+  /* rebuild the index without a view attached to avoid
+   * a row-inserted round trip for each window */
+  gtk_tree_view_set_model (GTK_TREE_VIEW (tasklist->overflow_view), NULL);
+  gtk_list_store_clear (tasklist->overflow_store);
+
+  for (li = tasklist->windows; li != NULL; li = li->next)
+    {
+      child = li->data;
+
+      /* skip instead of returning, the view has no model here */
+      if (child->type != CHILD_TYPE_OVERFLOW_MENU
+          || !WNCK_IS_WINDOW (child->window))
+        continue;
+
+      key = xfce_tasklist_overflow_popup_key (wnck_window_get_name (child->window));
+      gtk_list_store_insert_with_values (tasklist->overflow_store, NULL, -1,
+                                         OVERFLOW_COLUMN_ICON, wnck_window_get_mini_icon (child->window),
+                                         OVERFLOW_COLUMN_TITLE, gtk_label_get_text (GTK_LABEL (child->label)),
+                                         OVERFLOW_COLUMN_KEY, key,
+                                         OVERFLOW_COLUMN_CHILD, child,
+                                         -1);
+      g_free (key);
+    }
+
+  gtk_tree_view_set_model (GTK_TREE_VIEW (tasklist->overflow_view), tasklist->overflow_filter);
+  xfce_tasklist_overflow_popup_move_cursor (tasklist, 0);
+
+  xfce_panel_plugin_position_widget (XFCE_PANEL_PLUGIN (plugin),
+                                     tasklist->overflow_popup,
+                                     tasklist->arrow_button, &x, &y);
+  gtk_window_move (GTK_WINDOW (tasklist->overflow_popup), x, y);
+
+  gtk_widget_show (tasklist->overflow_popup);
+  gtk_widget_grab_focus (tasklist->overflow_entry);
+  xfce_panel_plugin_block_autohide (XFCE_PANEL_PLUGIN (plugin), TRUE);
+
+  /* grab keyboard and pointer like a menu does */
+  gtk_grab_add (tasklist->overflow_popup);
+  seat = gdk_display_get_default_seat (gtk_widget_get_display (tasklist->overflow_popup));
+  if (gdk_seat_grab (seat, gtk_widget_get_window (tasklist->overflow_popup),
+                     GDK_SEAT_CAPABILITY_ALL, TRUE, NULL, NULL,
+                     NULL, NULL) != GDK_GRAB_SUCCESS)
+    {
+      g_printerr (PACKAGE_NAME ": Unable to get keyboard and mouse "
+                  "grab. Popup failed.\n");
+      xfce_tasklist_overflow_popup_hide (tasklist);
+    }
+}
+
+
+
+static void
+xfce_tasklist_overflow_popup_hide (XfceTasklist *tasklist)
+{
+  GtkWidget *plugin;
+  GdkSeat   *seat;
+
+  panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
+
+  if (tasklist->overflow_popup == NULL
+      || !gtk_widget_get_visible (tasklist->overflow_popup))
+    return;
+
+  seat = gdk_display_get_default_seat (gtk_widget_get_display (tasklist->overflow_popup));
+  gdk_seat_ungrab (seat);
+  gtk_grab_remove (tasklist->overflow_popup);
+  gtk_widget_hide (tasklist->overflow_popup);
+
+  plugin = xfce_tasklist_get_panel_plugin (tasklist);
+  if (G_LIKELY (plugin != NULL))
+    xfce_panel_plugin_block_autohide (XFCE_PANEL_PLUGIN (plugin), FALSE);
+
+#ifdef GDK_WINDOWING_X11
+  /* make sure the wireframe is hidden */
+  tasklist->overflow_hover = NULL;
+  xfce_tasklist_wireframe_hide (tasklist);
+#endif
+
+  /* drop the child pointers, the index is rebuilt on the next popup */
+  gtk_list_store_clear (tasklist->overflow_store);
+
+  gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (tasklist->arrow_button), FALSE);
+}
+
+
+
+static void
+xfce_tasklist_overflow_popup_remove_child (XfceTasklist *tasklist,
+                                           gpointer      child)
+{
+  GtkTreeModel *model = GTK_TREE_MODEL (tasklist->overflow_store);
+  GtkTreeIter   iter;
+  gpointer      row_child;
+  gboolean      valid;
+
+  panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
+  panel_return_if_fail (GTK_IS_LIST_STORE (tasklist->overflow_store));
+
+  if (tasklist->overflow_hover == child)
+    tasklist->overflow_hover = NULL;
+
+  for (valid = gtk_tree_model_get_iter_first (model, &iter);
+       valid;
+       valid = gtk_tree_model_iter_next (model, &iter))
+    {
+      gtk_tree_model_get (model, &iter, OVERFLOW_COLUMN_CHILD, &row_child, -1);
+      if (row_child == child)
+        {
+          gtk_list_store_remove (tasklist->overflow_store, &iter);
+          break;
+        }
+    }
+}
+
+
+
 /**
  * Potential Public Functions
  **/
@@ -4196,10 +5240,6 @@ xfce_tasklist_set_grouping (XfceTasklist         *tasklist,
 {
   panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
 
-  /* TODO avoid overflow, because we allows + 1 in the object */
-  if (grouping > XFCE_TASKLIST_GROUPING_MAX)
-    grouping = XFCE_TASKLIST_GROUPING_MAX;
-
   if (tasklist->grouping != grouping)
     {
       tasklist->grouping = grouping;
@@ -42,10 +42,10 @@ enum _XfceTasklistGrouping
 {
   XFCE_TASKLIST_GROUPING_NEVER,
   XFCE_TASKLIST_GROUPING_ALWAYS,
-  /*XFCE_TASKLIST_GROUPING_AUTO, *//* when space is limited */
+  XFCE_TASKLIST_GROUPING_AUTO, /* when space is limited */
 
   XFCE_TASKLIST_GROUPING_MIN = XFCE_TASKLIST_GROUPING_NEVER,
-  XFCE_TASKLIST_GROUPING_MAX = XFCE_TASKLIST_GROUPING_ALWAYS,
+  XFCE_TASKLIST_GROUPING_MAX = XFCE_TASKLIST_GROUPING_AUTO,
   XFCE_TASKLIST_GROUPING_DEFAULT = XFCE_TASKLIST_GROUPING_NEVER
 };
 
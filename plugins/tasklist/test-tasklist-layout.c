@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "tasklist-layout.h"
+
+
+
+/* a class group of the layout, the group itself is the opaque pointer */
+typedef struct
+{
+  const gchar *id;
+  gint         n_windows;
+}
+TestGroup;
+
+
+
+static GArray *
+test_groups_new (const TestGroup *test_groups,
+                 guint            n_test_groups,
+                 GHashTable      *grouped)
+{
+  GArray                *groups;
+  XfceTasklistAutoGroup  group;
+  guint                  i;
+
+  groups = g_array_new (FALSE, FALSE, sizeof (XfceTasklistAutoGroup));
+  for (i = 0; i < n_test_groups; i++)
+    {
+      group.class_group = (gpointer) &test_groups[i];
+      group.id = test_groups[i].id;
+      group.n_windows = test_groups[i].n_windows;
+      group.grouped = g_hash_table_contains (grouped, &test_groups[i]);
+      g_array_append_val (groups, group);
+    }
+
+  xfce_tasklist_layout_auto_group_sort (groups);
+
+  return groups;
+}
+
+
+
+static gint
+test_groups_n_buttons (const TestGroup *test_groups,
+                       guint            n_test_groups,
+                       GHashTable      *grouped)
+{
+  guint i;
+  gint  n_buttons = 0;
+
+  for (i = 0; i < n_test_groups; i++)
+    {
+      if (g_hash_table_contains (grouped, &test_groups[i]))
+        n_buttons++;
+      else
+        n_buttons += test_groups[i].n_windows;
+    }
+
+  return n_buttons;
+}
+
+
+
+/* run one layout pass like the tasklist does and apply the decisions,
+ * returns the number of changed groups */
+static guint
+test_layout_pass (const TestGroup *test_groups,
+                  guint            n_test_groups,
+                  GHashTable      *grouped,
+                  gint             capacity)
+{
+  GArray *groups;
+  GSList *collapse = NULL, *expand = NULL, *lp;
+  guint   n_changes;
+
+  groups = test_groups_new (test_groups, n_test_groups, grouped);
+  xfce_tasklist_layout_auto_group_decide (groups,
+                                          test_groups_n_buttons (test_groups, n_test_groups, grouped),
+                                          capacity, &collapse, &expand);
+  g_array_free (groups, TRUE);
+
+  for (lp = collapse; lp != NULL; lp = lp->next)
+    g_hash_table_add (grouped, lp->data);
+  for (lp = expand; lp != NULL; lp = lp->next)
+    g_hash_table_remove (grouped, lp->data);
+
+  n_changes = g_slist_length (collapse) + g_slist_length (expand);
+
+  g_slist_free (collapse);
+  g_slist_free (expand);
+
+  return n_changes;
+}
+
+
+
+static void
+test_capacity (void)
+{
+  /* everything fits, no room for the arrow needed */
+  g_assert_cmpint (xfce_tasklist_layout_capacity (220, 50, 1, 4), ==, 4);
+  g_assert_cmpint (xfce_tasklist_layout_capacity (200, 50, 2, 8), ==, 8);
+
+  /* the arrow button is reserved once the buttons overflow */
+  g_assert_cmpint (xfce_tasklist_layout_capacity (200, 50, 1, 5), ==, 3);
+  g_assert_cmpint (xfce_tasklist_layout_capacity (200, 50, 2, 9), ==, 6);
+  g_assert_cmpint (xfce_tasklist_layout_capacity (ARROW_BUTTON_SIZE + 49, 50, 1, 2), ==, 0);
+
+  /* no division by zero or negative sizes */
+  g_assert_cmpint (xfce_tasklist_layout_capacity (10, 50, 1, 1), ==, 0);
+  g_assert_cmpint (xfce_tasklist_layout_capacity (-10, 50, 1, 1), ==, 0);
+  g_assert_cmpint (xfce_tasklist_layout_capacity (100, 0, 1, 200), ==, 100 - ARROW_BUTTON_SIZE);
+  g_assert_cmpint (xfce_tasklist_layout_capacity (100, 10, 0, 20), ==, 8);
+}
+
+
+
+static void
+test_collapse_largest_first (void)
+{
+  static const TestGroup test_groups[] =
+  {
+    { "dd", 1 }, { "cc", 2 }, { "bb", 3 }, { "aa", 3 }
+  };
+  GHashTable *grouped;
+
+  grouped = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  /* 9 buttons in 7 cells, collapsing one group of 3 saves 2 and
+   * the tie between the two groups of 3 is broken by the id */
+  g_assert_cmpuint (test_layout_pass (test_groups, G_N_ELEMENTS (test_groups), grouped, 7), ==, 1);
+  g_assert_true (g_hash_table_contains (grouped, &test_groups[3]));
+
+  /* 7 buttons in 4 cells, the next largest groups follow */
+  g_assert_cmpuint (test_layout_pass (test_groups, G_N_ELEMENTS (test_groups), grouped, 4), ==, 2);
+  g_assert_true (g_hash_table_contains (grouped, &test_groups[2]));
+  g_assert_true (g_hash_table_contains (grouped, &test_groups[1]));
+  g_assert_false (g_hash_table_contains (grouped, &test_groups[0]));
+
+  g_hash_table_destroy (grouped);
+}
+
+
+
+static void
+test_expand_with_slack (void)
+{
+  static const TestGroup test_groups[] =
+  {
+    { "aa", 3 }, { "bb", 2 }
+  };
+  GHashTable *grouped;
+
+  grouped = g_hash_table_new (g_direct_hash, g_direct_equal);
+  g_hash_table_add (grouped, (gpointer) &test_groups[0]);
+
+  /* 3 buttons, expanding needs 2 more cells plus the slack */
+  g_assert_cmpuint (test_layout_pass (test_groups, G_N_ELEMENTS (test_groups), grouped, 5), ==, 0);
+  g_assert_true (g_hash_table_contains (grouped, &test_groups[0]));
+
+  g_assert_cmpuint (test_layout_pass (test_groups, G_N_ELEMENTS (test_groups), grouped,
+                                      5 + AUTO_GROUP_HYSTERESIS), ==, 1);
+  g_assert_false (g_hash_table_contains (grouped, &test_groups[0]));
+
+  g_hash_table_destroy (grouped);
+}
+
+
+
+/* settle the layout at a panel length, the capacity is computed
+ * again in every pass like during an allocation */
+static void
+test_layout_settle (const TestGroup *test_groups,
+                    guint            n_test_groups,
+                    GHashTable      *grouped,
+                    gint             length)
+{
+  guint pass;
+  gint  capacity;
+
+  for (pass = 0; ; pass++)
+    {
+      g_assert_cmpuint (pass, <=, n_test_groups);
+
+      capacity = xfce_tasklist_layout_capacity (length, 50, 1,
+                                                test_groups_n_buttons (test_groups, n_test_groups, grouped));
+      if (test_layout_pass (test_groups, n_test_groups, grouped, capacity) == 0)
+        break;
+    }
+
+  /* once settled, another allocation does not change anything */
+  capacity = xfce_tasklist_layout_capacity (length, 50, 1,
+                                            test_groups_n_buttons (test_groups, n_test_groups, grouped));
+  g_assert_cmpuint (test_layout_pass (test_groups, n_test_groups, grouped, capacity), ==, 0);
+}
+
+
+
+static void
+test_stable (void)
+{
+  static const TestGroup test_groups[] =
+  {
+    { "aa", 4 }, { "bb", 3 }, { "cc", 3 }, { "dd", 2 }, { "ee", 1 }, { "ff", 1 }
+  };
+  GHashTable *grouped;
+  gint        length;
+
+  grouped = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  /* grow and shrink the panel a few pixels at a time */
+  for (length = 0; length <= 800; length += 5)
+    test_layout_settle (test_groups, G_N_ELEMENTS (test_groups), grouped, length);
+
+  for (length = 800; length >= 0; length -= 5)
+    test_layout_settle (test_groups, G_N_ELEMENTS (test_groups), grouped, length);
+
+  g_hash_table_destroy (grouped);
+}
+
+
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/tasklist/layout/capacity", test_capacity);
+  g_test_add_func ("/tasklist/layout/collapse-largest-first", test_collapse_largest_first);
+  g_test_add_func ("/tasklist/layout/expand-with-slack", test_expand_with_slack);
+  g_test_add_func ("/tasklist/layout/stable", test_stable);
+
+  return g_test_run ();
+}
@@ -0,0 +1,664 @@
+/*
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Replays a stream of window events into an XfceTasklist and reports the
+ * wall time, allocations and tasklist size allocations per event type.
+ *
+ * The driver acts as a minimal window manager on the display (Xvfb in
+ * make check): it creates plain X windows and publishes them with the
+ * EWMH properties libwnck reads, so the tasklist handlers run on real
+ * WnckWindow events. The stream is generated from a fixed seed, or read
+ * from the file in TASKLIST_REPLAY_SCRIPT, one event per line:
+ *
+ *   add <id> <class> <title>
+ *   remove <id>
+ *   name <id> <title>
+ *   icon <id>
+ *   state <id> minimized|normal
+ *   workspace <id> <0|1>
+ *
+ * TASKLIST_REPLAY_EVENTS sets the number of generated events.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <gtk/gtk.h>
+#include <gdk/gdkx.h>
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <libxfce4panel/libxfce4panel.h>
+
+#include "tasklist-widget.h"
+
+
+
+#define TEST_SEED             (20260101)
+#define TEST_N_EVENTS         (500)
+#define TEST_INITIAL_WINDOWS  (20)
+#define TEST_MAX_WINDOWS      (60)
+#define TEST_N_WORKSPACES     (2)
+#define TEST_ICON_SIZE        (16)
+#define TEST_PANEL_SIZE       (32)
+#define TEST_PANEL_LENGTH     (1000)
+
+
+
+typedef enum
+{
+  TEST_EVENT_ADD,
+  TEST_EVENT_REMOVE,
+  TEST_EVENT_NAME,
+  TEST_EVENT_ICON,
+  TEST_EVENT_STATE,
+  TEST_EVENT_WORKSPACE,
+  N_TEST_EVENTS
+}
+TestEventType;
+
+typedef struct
+{
+  guint  n_events;
+  gint64 time;
+  guint  n_allocations;
+  guint  n_resizes;
+}
+TestStats;
+
+typedef struct
+{
+  Window   xwindow;
+  gint     workspace;
+  gboolean minimized;
+  guint    icon_serial;
+}
+TestWindow;
+
+typedef struct
+{
+  Display    *xdisplay;
+  Window      xroot;
+
+  GtkWidget  *window;
+  GtkWidget  *tasklist;
+
+  /* the windows by id and the client list in mapping order */
+  GHashTable *windows;
+  GArray     *client_list;
+
+  /* size allocations of the tasklist */
+  guint       n_resizes;
+
+  TestStats   stats[N_TEST_EVENTS];
+}
+TestReplay;
+
+
+
+static const gchar *test_event_names[] =
+{
+  "add", "remove", "name", "icon", "state", "workspace"
+};
+
+static const gchar *test_classes[] =
+{
+  "Terminal", "Firefox", "Thunar", "Mousepad", "Gimp"
+};
+
+static gint test_n_allocations = 0;
+
+
+
+#ifdef __GLIBC__
+/* count the allocations of the process, glibc exports its allocator
+ * under another name so it can be wrapped */
+extern void *__libc_malloc  (size_t  size);
+extern void *__libc_calloc  (size_t  n_members,
+                             size_t  size);
+extern void *__libc_realloc (void   *ptr,
+                             size_t  size);
+
+
+
+void *
+malloc (size_t size)
+{
+  g_atomic_int_inc (&test_n_allocations);
+  return __libc_malloc (size);
+}
+
+
+
+void *
+calloc (size_t n_members,
+        size_t size)
+{
+  g_atomic_int_inc (&test_n_allocations);
+  return __libc_calloc (n_members, size);
+}
+
+
+
+void *
+realloc (void   *ptr,
+         size_t  size)
+{
+  g_atomic_int_inc (&test_n_allocations);
+  return __libc_realloc (ptr, size);
+}
+#endif
+
+
+
+static Atom
+test_atom (const gchar *name)
+{
+  return gdk_x11_get_xatom_by_name_for_display (gdk_display_get_default (), name);
+}
+
+
+
+static void
+test_set_property (TestReplay  *replay,
+                   Window       xwindow,
+                   const gchar *property,
+                   Atom         type,
+                   const glong *values,
+                   gint         n_values)
+{
+  XChangeProperty (replay->xdisplay, xwindow, test_atom (property), type, 32,
+                   PropModeReplace, (const guchar *) values, n_values);
+}
+
+
+
+static void
+test_set_string (TestReplay  *replay,
+                 Window       xwindow,
+                 const gchar *property,
+                 const gchar *value)
+{
+  XChangeProperty (replay->xdisplay, xwindow, test_atom (property),
+                   test_atom ("UTF8_STRING"), 8, PropModeReplace,
+                   (const guchar *) value, strlen (value));
+}
+
+
+
+static void
+test_replay_update_client_list (TestReplay *replay)
+{
+  glong *values;
+  guint  i;
+
+  values = g_new0 (glong, MAX (replay->client_list->len, 1));
+  for (i = 0; i < replay->client_list->len; i++)
+    values[i] = g_array_index (replay->client_list, Window, i);
+
+  test_set_property (replay, replay->xroot, "_NET_CLIENT_LIST", XA_WINDOW,
+                     values, replay->client_list->len);
+  test_set_property (replay, replay->xroot, "_NET_CLIENT_LIST_STACKING", XA_WINDOW,
+                     values, replay->client_list->len);
+
+  g_free (values);
+}
+
+
+
+static void
+test_window_set_workspace (TestReplay *replay,
+                           TestWindow *window)
+{
+  glong value = window->workspace;
+
+  test_set_property (replay, window->xwindow, "_NET_WM_DESKTOP", XA_CARDINAL, &value, 1);
+}
+
+
+
+static void
+test_window_set_state (TestReplay *replay,
+                       TestWindow *window)
+{
+  glong value = test_atom ("_NET_WM_STATE_HIDDEN");
+
+  test_set_property (replay, window->xwindow, "_NET_WM_STATE", XA_ATOM,
+                     &value, window->minimized ? 1 : 0);
+}
+
+
+
+static void
+test_window_set_icon (TestReplay *replay,
+                      TestWindow *window)
+{
+  glong  icon[2 + TEST_ICON_SIZE * TEST_ICON_SIZE];
+  gulong color;
+  guint  i;
+
+  /* a new opaque color for every icon change */
+  color = 0xff000000 | ((window->icon_serial++ * 0x3f1d27) & 0xffffff);
+
+  icon[0] = icon[1] = TEST_ICON_SIZE;
+  for (i = 2; i < G_N_ELEMENTS (icon); i++)
+    icon[i] = color;
+
+  test_set_property (replay, window->xwindow, "_NET_WM_ICON", XA_CARDINAL,
+                     icon, G_N_ELEMENTS (icon));
+}
+
+
+
+static void
+test_window_free (gpointer data)
+{
+  g_slice_free (TestWindow, data);
+}
+
+
+
+static void
+test_replay_size_allocate (GtkWidget     *tasklist,
+                           GtkAllocation *allocation,
+                           TestReplay    *replay)
+{
+  replay->n_resizes++;
+}
+
+
+
+/* wait until the tasklist handled everything that is pending */
+static void
+test_replay_settle (TestReplay *replay)
+{
+  /* the property notifies are queued once the server handled them */
+  XSync (replay->xdisplay, False);
+
+  /* wnck updates its windows in an idle, then the tasklist relayout
+   * runs like in the layout phase of the frame clock */
+  while (g_main_context_iteration (NULL, FALSE));
+  gtk_container_check_resize (GTK_CONTAINER (replay->window));
+  while (g_main_context_iteration (NULL, FALSE));
+}
+
+
+
+static void
+test_replay_init (TestReplay *replay)
+{
+  glong values[2];
+
+  replay->xdisplay = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
+  replay->xroot = DefaultRootWindow (replay->xdisplay);
+  replay->windows = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, test_window_free);
+  replay->client_list = g_array_new (FALSE, FALSE, sizeof (Window));
+  replay->n_resizes = 0;
+  memset (replay->stats, 0, sizeof (replay->stats));
+
+  /* the workspaces of the window manager */
+  values[0] = TEST_N_WORKSPACES;
+  test_set_property (replay, replay->xroot, "_NET_NUMBER_OF_DESKTOPS", XA_CARDINAL, values, 1);
+  values[0] = 0;
+  test_set_property (replay, replay->xroot, "_NET_CURRENT_DESKTOP", XA_CARDINAL, values, 1);
+  test_replay_update_client_list (replay);
+
+  /* a horizontal panel with the tasklist */
+  replay->tasklist = g_object_new (XFCE_TYPE_TASKLIST, NULL);
+  xfce_tasklist_set_size (XFCE_TASKLIST (replay->tasklist), TEST_PANEL_SIZE);
+  g_signal_connect (G_OBJECT (replay->tasklist), "size-allocate",
+      G_CALLBACK (test_replay_size_allocate), replay);
+
+  replay->window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  gtk_window_set_default_size (GTK_WINDOW (replay->window), TEST_PANEL_LENGTH, TEST_PANEL_SIZE);
+  gtk_container_add (GTK_CONTAINER (replay->window), replay->tasklist);
+  gtk_widget_show_all (replay->window);
+
+  test_replay_settle (replay);
+}
+
+
+
+static void
+test_replay_destroy (TestReplay *replay)
+{
+  GHashTableIter  iter;
+  gpointer        window;
+
+  gtk_widget_destroy (replay->window);
+
+  g_array_set_size (replay->client_list, 0);
+  test_replay_update_client_list (replay);
+
+  g_hash_table_iter_init (&iter, replay->windows);
+  while (g_hash_table_iter_next (&iter, NULL, &window))
+    XDestroyWindow (replay->xdisplay, ((TestWindow *) window)->xwindow);
+  XSync (replay->xdisplay, False);
+
+  g_hash_table_destroy (replay->windows);
+  g_array_free (replay->client_list, TRUE);
+}
+
+
+
+static gboolean
+test_replay_apply (TestReplay     *replay,
+                   const gchar    *line,
+                   TestEventType  *type_return)
+{
+  gchar      **args;
+  TestWindow  *window = NULL;
+  XClassHint   class_hint;
+  guint        n_args, i, type;
+  gboolean     succeed = FALSE;
+
+  args = g_strsplit (line, " ", 4);
+  n_args = g_strv_length (args);
+
+  for (type = 0; type < N_TEST_EVENTS; type++)
+    if (n_args >= 2 && g_strcmp0 (args[0], test_event_names[type]) == 0)
+      break;
+
+  if (type < N_TEST_EVENTS)
+    window = g_hash_table_lookup (replay->windows, args[1]);
+
+  if (type == TEST_EVENT_ADD && n_args == 4 && window == NULL)
+    {
+      window = g_slice_new0 (TestWindow);
+      window->xwindow = XCreateSimpleWindow (replay->xdisplay, replay->xroot,
+                                             0, 0, 400, 300, 0, 0, 0);
+      g_hash_table_insert (replay->windows, g_strdup (args[1]), window);
+
+      class_hint.res_name = args[2];
+      class_hint.res_class = args[2];
+      XSetClassHint (replay->xdisplay, window->xwindow, &class_hint);
+      test_set_string (replay, window->xwindow, "_NET_WM_NAME", args[3]);
+      test_window_set_workspace (replay, window);
+      test_window_set_state (replay, window);
+      test_window_set_icon (replay, window);
+
+      g_array_append_val (replay->client_list, window->xwindow);
+      test_replay_update_client_list (replay);
+
+      succeed = TRUE;
+    }
+  else if (type == TEST_EVENT_REMOVE && n_args == 2 && window != NULL)
+    {
+      for (i = 0; i < replay->client_list->len; i++)
+        if (g_array_index (replay->client_list, Window, i) == window->xwindow)
+          {
+            g_array_remove_index (replay->client_list, i);
+            break;
+          }
+      test_replay_update_client_list (replay);
+
+      /* destroy the window after wnck closed it */
+      test_replay_settle (replay);
+      XDestroyWindow (replay->xdisplay, window->xwindow);
+      g_hash_table_remove (replay->windows, args[1]);
+
+      succeed = TRUE;
+    }
+  else if (type == TEST_EVENT_NAME && n_args >= 3 && window != NULL)
+    {
+      test_set_string (replay, window->xwindow, "_NET_WM_NAME",
+                       strchr (line + strlen (args[0]) + 1, ' ') + 1);
+      succeed = TRUE;
+    }
+  else if (type == TEST_EVENT_ICON && n_args == 2 && window != NULL)
+    {
+      test_window_set_icon (replay, window);
+      succeed = TRUE;
+    }
+  else if (type == TEST_EVENT_STATE && n_args == 3 && window != NULL)
+    {
+      window->minimized = g_strcmp0 (args[2], "minimized") == 0;
+      test_window_set_state (replay, window);
+      succeed = TRUE;
+    }
+  else if (type == TEST_EVENT_WORKSPACE && n_args == 3 && window != NULL)
+    {
+      window->workspace = CLAMP (atoi (args[2]), 0, TEST_N_WORKSPACES - 1);
+      test_window_set_workspace (replay, window);
+      succeed = TRUE;
+    }
+
+  g_strfreev (args);
+
+  *type_return = type;
+
+  return succeed;
+}
+
+
+
+static void
+test_replay_event (TestReplay  *replay,
+                   const gchar *line)
+{
+  TestEventType  type;
+  TestStats     *stats;
+  gint64         start_time;
+  gint           n_allocations;
+  guint          n_resizes;
+
+  if (*line == '\0' || *line == '#')
+    return;
+
+  n_allocations = g_atomic_int_get (&test_n_allocations);
+  n_resizes = replay->n_resizes;
+  start_time = g_get_monotonic_time ();
+
+  if (!test_replay_apply (replay, line, &type))
+    {
+      g_test_message ("skipped invalid event: %s", line);
+      return;
+    }
+
+  test_replay_settle (replay);
+
+  stats = &replay->stats[type];
+  stats->n_events++;
+  stats->time += g_get_monotonic_time () - start_time;
+  stats->n_allocations += g_atomic_int_get (&test_n_allocations) - n_allocations;
+  stats->n_resizes += replay->n_resizes - n_resizes;
+}
+
+
+
+static gchar **
+test_replay_generate (guint n_events)
+{
+  GPtrArray   *lines;
+  GRand       *rand;
+  GArray      *ids;
+  const gchar *klass;
+  guint        next_id = 0, id, i, n;
+  gint         r;
+
+  lines = g_ptr_array_new ();
+  ids = g_array_new (FALSE, FALSE, sizeof (guint));
+  rand = g_rand_new_with_seed (TEST_SEED);
+
+  for (i = 0, n = 0; n < TEST_INITIAL_WINDOWS + n_events; n++)
+    {
+      r = n < TEST_INITIAL_WINDOWS ? 0 : g_rand_int_range (rand, 0, 100);
+
+      /* keep the number of windows in a sane range */
+      if (ids->len == 0 || (r < 5 && ids->len < TEST_MAX_WINDOWS))
+        {
+          klass = test_classes[g_rand_int_range (rand, 0, G_N_ELEMENTS (test_classes))];
+          g_ptr_array_add (lines, g_strdup_printf ("add %u %s %s %u", next_id, klass,
+                                                   klass, g_rand_int (rand)));
+          g_array_append_val (ids, next_id);
+          next_id++;
+          continue;
+        }
+
+      i = g_rand_int_range (rand, 0, ids->len);
+      id = g_array_index (ids, guint, i);
+
+      if (r < 10)
+        {
+          g_ptr_array_add (lines, g_strdup_printf ("remove %u", id));
+          g_array_remove_index (ids, i);
+        }
+      else if (r < 60)
+        {
+          /* terminals and browsers update their title all the time */
+          g_ptr_array_add (lines, g_strdup_printf ("name %u Title %u", id, g_rand_int (rand)));
+        }
+      else if (r < 70)
+        {
+          g_ptr_array_add (lines, g_strdup_printf ("icon %u", id));
+        }
+      else if (r < 85)
+        {
+          g_ptr_array_add (lines, g_strdup_printf ("state %u %s", id,
+                                                   g_rand_boolean (rand) ? "minimized" : "normal"));
+        }
+      else
+        {
+          g_ptr_array_add (lines, g_strdup_printf ("workspace %u %d", id,
+                                                   g_rand_int_range (rand, 0, TEST_N_WORKSPACES)));
+        }
+    }
+
+  g_rand_free (rand);
+  g_array_free (ids, TRUE);
+  g_ptr_array_add (lines, NULL);
+
+  return (gchar **) g_ptr_array_free (lines, FALSE);
+}
+
+
+
+static void
+test_replay_report (TestReplay *replay)
+{
+  TestStats *stats;
+  guint      type;
+
+  g_test_message ("%-10s %8s %12s %12s %12s %10s",
+                  "event", "count", "wall (ms)", "us/event", "allocs/event", "resizes");
+
+  for (type = 0; type < N_TEST_EVENTS; type++)
+    {
+      stats = &replay->stats[type];
+      if (stats->n_events == 0)
+        continue;
+
+      g_test_message ("%-10s %8u %12.2f %12.1f %12.1f %10u",
+                      test_event_names[type], stats->n_events,
+                      stats->time / 1000.0,
+                      (gdouble) stats->time / stats->n_events,
+                      (gdouble) stats->n_allocations / stats->n_events,
+                      stats->n_resizes);
+    }
+
+#ifndef __GLIBC__
+  g_test_message ("allocations are only counted with glibc");
+#endif
+}
+
+
+
+static void
+test_replay (void)
+{
+  TestReplay      replay;
+  gchar         **lines;
+  gchar          *contents;
+  const gchar    *script;
+  const gchar    *n_events;
+  GError         *error = NULL;
+  GList          *children, *li;
+  GHashTableIter  iter;
+  gpointer        window;
+  guint           i, n_visible = 0, n_expected = 0;
+
+  if (!GDK_IS_X11_DISPLAY (gdk_display_get_default ()))
+    {
+      g_test_skip ("the replay needs an X11 display");
+      return;
+    }
+
+  script = g_getenv ("TASKLIST_REPLAY_SCRIPT");
+  if (script != NULL)
+    {
+      if (!g_file_get_contents (script, &contents, NULL, &error))
+        g_error ("failed to read the replay script: %s", error->message);
+      lines = g_strsplit (contents, "\n", -1);
+      g_free (contents);
+    }
+  else
+    {
+      n_events = g_getenv ("TASKLIST_REPLAY_EVENTS");
+      lines = test_replay_generate (n_events != NULL ? (guint) atoi (n_events) : TEST_N_EVENTS);
+    }
+
+  test_replay_init (&replay);
+
+  for (i = 0; lines[i] != NULL; i++)
+    test_replay_event (&replay, lines[i]);
+
+  test_replay_report (&replay);
+
+  /* the visible buttons are the windows on the active workspace */
+  g_hash_table_iter_init (&iter, replay.windows);
+  while (g_hash_table_iter_next (&iter, NULL, &window))
+    if (((TestWindow *) window)->workspace == 0)
+      n_expected++;
+
+  children = gtk_container_get_children (GTK_CONTAINER (replay.tasklist));
+  for (li = children; li != NULL; li = li->next)
+    if (gtk_widget_get_visible (li->data))
+      n_visible++;
+  g_list_free (children);
+
+  g_assert_cmpuint (n_visible, ==, n_expected);
+
+  test_replay_destroy (&replay);
+  g_strfreev (lines);
+}
+
+
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  /* no accessibility bus in the test process */
+  g_setenv ("NO_AT_BRIDGE", "1", TRUE);
+
+  g_test_init (&argc, &argv, NULL);
+
+  /* run with xvfb-run in make check */
+  if (gtk_init_check (&argc, &argv))
+    g_test_add_func ("/tasklist/replay", test_replay);
+
+  return g_test_run ();
+}